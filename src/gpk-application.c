@@ -25,6 +25,7 @@
 #include <gdk/gdkkeysyms.h>
 #include <gdk/gdkx.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <glib.h>
 #include <gtk/gtk.h>
 #include <locale.h>
@@ -36,12 +37,30 @@
 
 #include "gpk-common.h"
 #include "gpk-common.h"
+#include "gpk-details-index.h"
 #include "gpk-dialog.h"
 #include "gpk-enum.h"
 #include "gpk-error.h"
+#include "gpk-name-index.h"
+#include "gpk-package-model.h"
+#include "gpk-query-scheduler.h"
 #include "gpk-task.h"
 #include "gpk-debug.h"
 
+#define GPK_APPLICATION_LOAD_BUDGET		8	/* ms */
+#define GPK_APPLICATION_LOAD_DETACH_ROWS	1000
+#define GPK_APPLICATION_SEARCH_CACHE_SIZE	16
+#define GPK_APPLICATION_NAME_INDEX_DELAY	5	/* s */
+#define GPK_APPLICATION_DETAILS_DELAY		100	/* ms */
+#define GPK_APPLICATION_DETAILS_PREFETCH_ROWS	8
+#define GPK_APPLICATION_DETAILS_BATCH_SIZE	64
+#define GPK_APPLICATION_DETAILS_CACHE_SIZE	4096
+#define GPK_APPLICATION_CATEGORIES_VERSION	1
+#define GPK_APPLICATION_CATEGORIES_TYPE		"(ua(sssss))"
+#define GPK_APPLICATION_QUEUE_VERSION		1
+#define GPK_APPLICATION_QUEUE_TYPE		"(ua(sus))"
+#define GPK_APPLICATION_QUEUE_SAVE_DELAY	500	/* ms */
+
 typedef enum {
 	GPK_SEARCH_NAME,
 	GPK_SEARCH_DETAILS,
@@ -67,30 +86,98 @@ typedef enum {
 typedef struct {
 	gboolean		 has_package;
 	gboolean		 search_in_progress;
-	GCancellable		*cancellable;
+	GCancellable		*search_cancellable;
+	guint			 search_generation;
+	guint			 search_typing_id;
+	GQueue			*search_cache;		/* of GpkApplicationCacheItem, newest first */
+	GHashTable		*search_cache_index;	/* key:GList */
+	guint			 search_cache_epoch;
+	guint			 search_cache_hits;
+	guint			 search_cache_misses;
+	GpkNameIndex		*name_index;
+	GCancellable		*name_index_cancellable;
+	PkClient		*name_index_client;
+	guint			 name_index_id;
+	guint			 name_index_pending;
+	guint			 name_index_changed;	/* s */
+	GpkDetailsIndex		*details_index;
+	guint			 details_index_id;
+	guint			 details_index_pos;
+	GHashTable		*search_package_ids;
+	GHashTable		*search_results;
+	GPtrArray		*search_packages;	/* before the local filters */
+	gchar			*arch_native;
+	GTimer			*search_timer;
+	GPtrArray		*load_queue;
+	GPtrArray		*load_shown;
+	GpkPackageModel		*load_store;
+	gboolean		 load_done;
+	gint64			 load_time;
+	guint			 load_id;
+	guint			 load_rows;
 	gchar			*homepage_url;
 	gchar			*search_group;
 	gchar			*search_text;
 	GHashTable		*repos;
-	GpkActionMode		 action;
 	GpkSearchMode		 search_mode;
 	GpkSearchType		 search_type;
 	GtkApplication		*application;
 	GSettings		*settings;
 	GtkBuilder		*builder;
-	GtkListStore		*packages_store;
+	GpkPackageModel		*packages_store;
 	GtkTreeStore		*groups_store;
 	guint			 details_event_id;
+	guint			 details_fetch_id;
+	gchar			*details_package_id;
+	GQueue			*details_cache;		/* of PkDetails, newest first */
+	GHashTable		*details_cache_index;	/* package-id:GList */
+	GVariant		*categories;		/* as shown in the group tree */
+	GHashTable		*details_pending;	/* package-id */
 	guint			 status_id;
 	PkBitfield		 filters_current;
 	PkBitfield		 groups;
 	PkBitfield		 roles;
 	PkControl		*control;
-	PkPackageSack		*package_sack;
+	GHashTable		*queue;			/* package-id:PkPackage */
+	guint			 queue_save_id;
 	PkStatusEnum		 status_last;
 	PkTask			*task;
+	PkTask			*download_task;
+	GpkQueryScheduler	*scheduler;
 } GpkApplicationPrivate;
 
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	guint			 generation;
+	guint			 cache_epoch;
+	gchar			*cache_key;
+} GpkApplicationSearchHelper;
+
+typedef struct {
+	gchar			*key;
+	GPtrArray		*packages;
+} GpkApplicationCacheItem;
+
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	gchar			**package_ids;
+} GpkApplicationDetailsHelper;
+
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	GCancellable		*cancellable;
+	gchar			**install_ids;
+	gchar			**remove_ids;
+	PkPackageSack		*sack;		/* what the simulations will change */
+	GPtrArray		*changed;	/* of PkPackage, what was actually changed */
+	guint			 pending;
+	gboolean		 simulate;	/* to restore afterwards */
+	gboolean		 failed;
+	gboolean		 removed;
+	gboolean		 installed;
+	PkError			*error_code;	/* the first one */
+} GpkApplicationApplyHelper;
+
 enum {
 	GPK_STATE_INSTALLED,
 	GPK_STATE_IN_LIST,
@@ -99,14 +186,14 @@ enum {
 };
 
 enum {
-	PACKAGES_COLUMN_IMAGE,
-	PACKAGES_COLUMN_STATE,  /* state of the item */
-	PACKAGES_COLUMN_CHECKBOX,  /* what we show in the checkbox */
-	PACKAGES_COLUMN_CHECKBOX_VISIBLE, /* visible */
-	PACKAGES_COLUMN_TEXT,
-	PACKAGES_COLUMN_ID,
-	PACKAGES_COLUMN_SUMMARY,
-	PACKAGES_COLUMN_LAST
+	PACKAGES_COLUMN_IMAGE = GPK_PACKAGE_MODEL_COLUMN_IMAGE,
+	PACKAGES_COLUMN_STATE = GPK_PACKAGE_MODEL_COLUMN_STATE,  /* state of the item */
+	PACKAGES_COLUMN_CHECKBOX = GPK_PACKAGE_MODEL_COLUMN_CHECKBOX,  /* what we show in the checkbox */
+	PACKAGES_COLUMN_CHECKBOX_VISIBLE = GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE, /* visible */
+	PACKAGES_COLUMN_TEXT = GPK_PACKAGE_MODEL_COLUMN_TEXT,  /* generated when drawn */
+	PACKAGES_COLUMN_ID = GPK_PACKAGE_MODEL_COLUMN_ID,
+	PACKAGES_COLUMN_SUMMARY = GPK_PACKAGE_MODEL_COLUMN_SUMMARY,
+	PACKAGES_COLUMN_LAST = GPK_PACKAGE_MODEL_COLUMN_LAST
 };
 
 enum {
@@ -119,9 +206,10 @@ enum {
 };
 
 static void gpk_application_perform_search (GpkApplicationPrivate *priv);
+static void gpk_application_search_add_package (GpkApplicationPrivate *priv, PkPackage *item);
 
-static void gpk_application_get_requires_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv);
-static void gpk_application_get_depends_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv);
+static void gpk_application_get_requires_cb (GpkQueryScheduler *scheduler, PkResults *results, const GError *error, GpkApplicationPrivate *priv);
+static void gpk_application_get_depends_cb (GpkQueryScheduler *scheduler, PkResults *results, const GError *error, GpkApplicationPrivate *priv);
 
 static gboolean
 _g_strzero (const gchar *text)
@@ -211,70 +299,62 @@ gpk_application_allow_remove (GpkApplicationPrivate *priv, gboolean allow)
 }
 
 static void
-gpk_application_packages_checkbox_invert (GpkApplicationPrivate *priv)
+gpk_application_packages_checkbox_invert (GtkTreeModel *model, GtkTreeIter *iter)
 {
-	GtkTreeView *treeview;
-	GtkTreeModel *model;
-	GtkTreeIter iter;
-	GtkTreeSelection *selection;
 	PkBitfield state;
-	gboolean ret;
-	g_autofree gchar *package_id = NULL;
-
-	/* get the selection and add */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	selection = gtk_tree_view_get_selection (treeview);
-	ret = gtk_tree_selection_get_selected (selection, &model, &iter);
-	if (!ret) {
-		g_warning ("no selection");
-		return;
-	}
 
-	gtk_tree_model_get (model, &iter,
+	gtk_tree_model_get (model, iter,
 			    PACKAGES_COLUMN_STATE, &state,
-			    PACKAGES_COLUMN_ID, &package_id,
 			    -1);
 
 	/* do something with the value */
 	pk_bitfield_invert (state, GPK_STATE_IN_LIST);
 
 	/* set new value */
-	gtk_list_store_set (GTK_LIST_STORE (model), &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
-			    PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
-			    -1);
+	gpk_package_model_set (GPK_PACKAGE_MODEL (model), iter,
+			       PACKAGES_COLUMN_STATE, state,
+			       PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
+			       PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
+			       -1);
 }
 
 static gboolean
-gpk_application_get_checkbox_enable (GpkApplicationPrivate *priv, PkBitfield state)
+gpk_application_get_selected_iter (GpkApplicationPrivate *priv, GtkTreeModel **model, GtkTreeIter *iter)
 {
-	gboolean enable_installed = TRUE;
-	gboolean enable_available = TRUE;
-
-	if (priv->action == GPK_ACTION_INSTALL)
-		enable_installed = FALSE;
-	else if (priv->action == GPK_ACTION_REMOVE)
-		enable_available = FALSE;
+	GtkTreeView *treeview;
+	GtkTreeSelection *selection;
+	GtkTreePath *path = NULL;
+	GList *rows;
+	gboolean ret = FALSE;
 
-	if (pk_bitfield_contain (state, GPK_STATE_INSTALLED))
-		return enable_installed;
-	return enable_available;
+	/* the cursor row if it is selected, otherwise the first one */
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	selection = gtk_tree_view_get_selection (treeview);
+	*model = gtk_tree_view_get_model (treeview);
+	gtk_tree_view_get_cursor (treeview, &path, NULL);
+	if (path != NULL && gtk_tree_selection_path_is_selected (selection, path)) {
+		ret = gtk_tree_model_get_iter (*model, iter, path);
+		gtk_tree_path_free (path);
+		return ret;
+	}
+	if (path != NULL)
+		gtk_tree_path_free (path);
+	rows = gtk_tree_selection_get_selected_rows (selection, NULL);
+	if (rows != NULL)
+		ret = gtk_tree_model_get_iter (*model, iter, rows->data);
+	g_list_free_full (rows, (GDestroyNotify) gtk_tree_path_free);
+	return ret;
 }
 
 static gboolean
 gpk_application_get_selected_package (GpkApplicationPrivate *priv, gchar **package_id, gchar **summary)
 {
-	GtkTreeView *treeview;
 	GtkTreeModel *model;
 	GtkTreeIter iter;
-	GtkTreeSelection *selection;
 	gboolean ret;
 
 	/* get the selection and add */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	selection = gtk_tree_view_get_selection (treeview);
-	ret = gtk_tree_selection_get_selected (selection, &model, &iter);
+	ret = gpk_application_get_selected_iter (priv, &model, &iter);
 	if (!ret) {
 		g_warning ("no selection");
 		return FALSE;
@@ -338,26 +418,126 @@ gpk_application_group_remove_selected (GpkApplicationPrivate *priv)
 	gtk_tree_store_remove (priv->groups_store, &iter);
 }
 
+static gchar *
+gpk_application_queue_get_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "gnome-packagekit",
+				 "application-queue.cache",
+				 NULL);
+}
+
+static gboolean
+gpk_application_queue_save (GpkApplicationPrivate *priv, GError **error)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder;
+	gpointer package;
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GVariant) root = NULL;
+
+	/* nothing to come back to */
+	filename = gpk_application_queue_get_filename ();
+	if (g_hash_table_size (priv->queue) == 0) {
+		if (g_unlink (filename) < 0 && errno != ENOENT) {
+			g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+				     "failed to remove %s: %s", filename, g_strerror (errno));
+			return FALSE;
+		}
+		return TRUE;
+	}
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sus)"));
+	g_hash_table_iter_init (&iter, priv->queue);
+	while (g_hash_table_iter_next (&iter, NULL, &package)) {
+		g_variant_builder_add (&builder, "(sus)",
+				       pk_package_get_id (package),
+				       (guint32) pk_package_get_info (package),
+				       pk_package_get_summary (package) != NULL ? pk_package_get_summary (package) : "");
+	}
+	root = g_variant_ref_sink (g_variant_new ("(u@a(sus))",
+						  (guint32) GPK_APPLICATION_QUEUE_VERSION,
+						  g_variant_builder_end (&builder)));
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+			     "failed to create %s: %s", dirname, g_strerror (errno));
+		return FALSE;
+	}
+	return g_file_set_contents (filename,
+				    g_variant_get_data (root),
+				    g_variant_get_size (root),
+				    error);
+}
+
+static gboolean
+gpk_application_queue_load (GpkApplicationPrivate *priv, GError **error)
+{
+	gchar *data = NULL;
+	gsize len = 0;
+	guint32 info;
+	guint32 version;
+	const gchar *package_id;
+	const gchar *summary;
+	GVariantIter iter;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) entries = NULL;
+	g_autoptr(GVariant) root = NULL;
+
+	filename = gpk_application_queue_get_filename ();
+	if (!g_file_get_contents (filename, &data, &len, error))
+		return FALSE;
+	bytes = g_bytes_new_take (data, len);
+	root = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GPK_APPLICATION_QUEUE_TYPE),
+							     bytes, FALSE));
+	g_variant_get_child (root, 0, "u", &version);
+	if (version != GPK_APPLICATION_QUEUE_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "queue version %u is not supported", version);
+		return FALSE;
+	}
+	entries = g_variant_get_child_value (root, 1);
+	g_variant_iter_init (&iter, entries);
+	while (g_variant_iter_next (&iter, "(&su&s)", &package_id, &info, &summary)) {
+		g_autoptr(PkPackage) package = pk_package_new ();
+		if (!pk_package_set_id (package, package_id, NULL))
+			continue;
+		g_object_set (package,
+			      "info", info == PK_INFO_ENUM_INSTALLED ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE,
+			      "summary", summary,
+			      NULL);
+		g_hash_table_insert (priv->queue, g_strdup (package_id), g_steal_pointer (&package));
+	}
+	g_debug ("restored %u queued packages", g_hash_table_size (priv->queue));
+	return TRUE;
+}
+
+static gboolean
+gpk_application_queue_save_cb (GpkApplicationPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+
+	priv->queue_save_id = 0;
+	if (!gpk_application_queue_save (priv, &error))
+		g_warning ("failed to save queue: %s", error->message);
+	return G_SOURCE_REMOVE;
+}
+
 static void
 gpk_application_change_queue_status (GpkApplicationPrivate *priv)
 {
 	GtkWidget *widget;
-	GtkTreeView *treeview;
-	gboolean valid;
-	GtkTreeIter iter;
-	GtkTreeModel *model;
-	PkBitfield state;
-	gboolean enabled;
 
 	/* show and hide the action widgets */
-	if (pk_package_sack_get_size (priv->package_sack) > 0) {
+	if (g_hash_table_size (priv->queue) > 0) {
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
 		gtk_widget_show (widget);
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
 		gtk_widget_show (widget);
 		gpk_application_group_add_selected (priv);
 	} else {
-		priv->action = GPK_ACTION_NONE;
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
 		gtk_widget_hide (widget);
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
@@ -365,92 +545,103 @@ gpk_application_change_queue_status (GpkApplicationPrivate *priv)
 		gpk_application_group_remove_selected (priv);
 	}
 
-	/* correct the enabled state */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	model = gtk_tree_view_get_model (treeview);
-	valid = gtk_tree_model_get_iter_first (model, &iter);
-
-	/* for all current items, reset the state if in the array */
-	while (valid) {
-		g_autofree gchar *package_id = NULL;
-		gtk_tree_model_get (model, &iter,
-				    PACKAGES_COLUMN_STATE, &state,
-				    PACKAGES_COLUMN_ID, &package_id,
-				    -1);
-
-		/* we never show the checkbox for the search helper */
-		if (package_id == NULL) {
-			enabled = FALSE;
-		} else {
-			enabled = gpk_application_get_checkbox_enable (priv, state);
-		}
-
-		/* set visible */
-		gtk_list_store_set (GTK_LIST_STORE (model), &iter, PACKAGES_COLUMN_CHECKBOX_VISIBLE, enabled, -1);
-		valid = gtk_tree_model_iter_next (model, &iter);
+	/* a bulk change only writes the file once */
+	if (priv->queue_save_id == 0) {
+		priv->queue_save_id = g_timeout_add (GPK_APPLICATION_QUEUE_SAVE_DELAY,
+						     (GSourceFunc) gpk_application_queue_save_cb,
+						     priv);
+		g_source_set_name_by_id (priv->queue_save_id, "[GpkApplication] queue-save");
 	}
 }
 
 static gboolean
-gpk_application_install (GpkApplicationPrivate *priv)
+gpk_application_queue_row (GpkApplicationPrivate *priv, GtkTreeModel *model,
+			   GtkTreeIter *iter, GpkActionMode action)
 {
-	gboolean ret;
-	g_autofree gchar *package_id_selected = NULL;
-	g_autofree gchar *summary_selected = NULL;
+	PkBitfield state;
+	PkPackage *queued;
+	gboolean installed;
+	g_autofree gchar *package_id = NULL;
+	g_autofree gchar *summary = NULL;
 	g_autoptr(PkPackage) package = NULL;
 
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, &summary_selected);
-	if (!ret) {
-		g_warning ("no package selected");
-		goto out;
-	}
-
-	/* changed mind, or wrong mode */
-	if (priv->action == GPK_ACTION_REMOVE) {
-		ret = pk_package_sack_remove_package_by_id (priv->package_sack, package_id_selected);
-		if (ret) {
-			g_debug ("removed %s from package array", package_id_selected);
+	gtk_tree_model_get (model, iter,
+			    PACKAGES_COLUMN_STATE, &state,
+			    PACKAGES_COLUMN_ID, &package_id,
+			    PACKAGES_COLUMN_SUMMARY, &summary,
+			    -1);
 
-			/* correct buttons */
-			gpk_application_allow_install (priv, FALSE);
-			gpk_application_allow_remove (priv, TRUE);
-			gpk_application_packages_checkbox_invert (priv);
-			ret = TRUE;
-			goto out;
-		}
-		g_warning ("wrong mode and not in array");
-		ret = FALSE;
-		goto out;
-	}
+	/* check we aren't a help line */
+	if (package_id == NULL)
+		return FALSE;
 
-	/* already added */
-	package = pk_package_sack_find_by_id (priv->package_sack, package_id_selected);
-	if (package != NULL) {
-		g_warning ("already added");
-		goto out;
+	/* changed mind */
+	queued = g_hash_table_lookup (priv->queue, package_id);
+	if (queued != NULL) {
+		if ((pk_package_get_info (queued) == PK_INFO_ENUM_INSTALLED) == (action == GPK_ACTION_REMOVE))
+			return FALSE;
+		g_debug ("removed %s from queue", package_id);
+		g_hash_table_remove (priv->queue, package_id);
+		gpk_application_packages_checkbox_invert (model, iter);
+		return TRUE;
 	}
 
-	/* set mode */
-	priv->action = GPK_ACTION_INSTALL;
+	/* the selection may mix installed and available packages */
+	installed = pk_bitfield_contain (state, GPK_STATE_INSTALLED);
+	if (installed != (action == GPK_ACTION_REMOVE))
+		return FALSE;
 
-	/* add to array */
+	/* add to queue, installs and removals can be mixed */
 	package = pk_package_new ();
-	pk_package_set_id (package, package_id_selected, NULL);
+	pk_package_set_id (package, package_id, NULL);
 	g_object_set (package,
-		      "info", PK_INFO_ENUM_AVAILABLE,
-		      "summary", summary_selected,
+		      "info", installed ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE,
+		      "summary", summary,
 		      NULL);
-	pk_package_sack_add_package (priv->package_sack, package);
+	g_hash_table_insert (priv->queue, g_strdup (package_id), g_steal_pointer (&package));
+	gpk_application_packages_checkbox_invert (model, iter);
+	return TRUE;
+}
+
+static gboolean
+gpk_application_queue_selected (GpkApplicationPrivate *priv, GpkActionMode action)
+{
+	GList *l;
+	GList *rows;
+	GtkTreeIter iter;
+	GtkTreeModel *model;
+	GtkTreeSelection *selection;
+	GtkTreeView *treeview;
+	guint changed = 0;
+
+	/* everything selected is done in one go */
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	selection = gtk_tree_view_get_selection (treeview);
+	rows = gtk_tree_selection_get_selected_rows (selection, &model);
+	for (l = rows; l != NULL; l = l->next) {
+		if (!gtk_tree_model_get_iter (model, &iter, l->data))
+			continue;
+		if (gpk_application_queue_row (priv, model, &iter, action))
+			changed++;
+	}
+	g_debug ("changed %u of %u selected packages", changed, g_list_length (rows));
+	g_list_free_full (rows, (GDestroyNotify) gtk_tree_path_free);
 
 	/* correct buttons */
-	gpk_application_allow_install (priv, FALSE);
-	gpk_application_allow_remove (priv, TRUE);
-	gpk_application_packages_checkbox_invert (priv);
-out:
+	if (changed > 0) {
+		gpk_application_allow_install (priv, action != GPK_ACTION_INSTALL);
+		gpk_application_allow_remove (priv, action == GPK_ACTION_INSTALL);
+	}
+
 	/* add the selected group if there are any packages in the queue */
 	gpk_application_change_queue_status (priv);
-	return ret;
+	return changed > 0;
+}
+
+static gboolean
+gpk_application_install (GpkApplicationPrivate *priv)
+{
+	return gpk_application_queue_selected (priv, GPK_ACTION_INSTALL);
 }
 
 static void
@@ -466,24 +657,21 @@ gpk_application_strcmp_indirect (gchar **a, gchar **b)
 }
 
 static void
-gpk_application_get_files_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_get_files_cb (GpkQueryScheduler *scheduler, PkResults *results,
+				const GError *error, GpkApplicationPrivate *priv)
 {
 	gboolean ret;
 	g_auto(GStrv) files = NULL;
 	g_autofree gchar *package_id_selected = NULL;
 	g_auto(GStrv) split = NULL;
 	g_autofree gchar *title = NULL;
-	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 	g_autoptr(GPtrArray) array_sort = NULL;
 	GtkWidget *dialog;
 	GtkWindow *window;
 	g_autoptr(PkError) error_code = NULL;
 	PkFiles *item;
-	g_autoptr(PkResults) results = NULL;
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
 	if (results == NULL) {
 		g_warning ("failed to get files: %s", error->message);
 		return;
@@ -545,6 +733,16 @@ gpk_application_get_files_cb (PkTask *task, GAsyncResult *res, GpkApplicationPri
 	gtk_widget_destroy (GTK_WIDGET (dialog));
 }
 
+static gboolean
+gpk_application_role_is_search (PkRoleEnum role)
+{
+	return role == PK_ROLE_ENUM_SEARCH_NAME ||
+	       role == PK_ROLE_ENUM_SEARCH_DETAILS ||
+	       role == PK_ROLE_ENUM_SEARCH_FILE ||
+	       role == PK_ROLE_ENUM_SEARCH_GROUP ||
+	       role == PK_ROLE_ENUM_GET_PACKAGES;
+}
+
 static gboolean
 gpk_application_status_changed_timeout_cb (GpkApplicationPrivate *priv)
 {
@@ -641,6 +839,57 @@ gpk_application_progress_cb (PkProgress *progress, PkProgressType type, GpkAppli
 	}
 }
 
+static GpkApplicationSearchHelper *
+gpk_application_search_helper_new (GpkApplicationPrivate *priv, gchar *cache_key)
+{
+	GpkApplicationSearchHelper *helper;
+	helper = g_new0 (GpkApplicationSearchHelper, 1);
+	helper->priv = priv;
+	helper->generation = priv->search_generation;
+	helper->cache_epoch = priv->search_cache_epoch;
+	helper->cache_key = cache_key;
+	return helper;
+}
+
+static void
+gpk_application_search_helper_free (GpkApplicationSearchHelper *helper)
+{
+	g_free (helper->cache_key);
+	g_free (helper);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkApplicationSearchHelper, gpk_application_search_helper_free)
+
+static void
+gpk_application_search_progress_cb (PkProgress *progress, PkProgressType type, GpkApplicationSearchHelper *helper)
+{
+	GpkApplicationPrivate *priv = helper->priv;
+	PkRoleEnum role;
+	g_autoptr(PkPackage) package = NULL;
+
+	/* superseded by a newer search, but let it tidy up the UI if
+	 * nothing else is running */
+	if (helper->generation != priv->search_generation) {
+		if (!priv->search_in_progress && type == PK_PROGRESS_TYPE_STATUS)
+			gpk_application_progress_cb (progress, type, priv);
+		return;
+	}
+
+	if (type != PK_PROGRESS_TYPE_PACKAGE) {
+		gpk_application_progress_cb (progress, type, priv);
+		return;
+	}
+
+	/* show search results as they arrive rather than when finished */
+	g_object_get (progress,
+		      "role", &role,
+		      "package", &package,
+		      NULL);
+	if (package == NULL || !gpk_application_role_is_search (role))
+		return;
+	gpk_application_search_add_package (priv, package);
+}
+
 static void
 gpk_application_menu_files_cb (GtkAction *action, GpkApplicationPrivate *priv)
 {
@@ -655,73 +904,17 @@ gpk_application_menu_files_cb (GtkAction *action, GpkApplicationPrivate *priv)
 		return;
 	}
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
 	/* set correct view */
 	package_ids = pk_package_ids_from_id (package_id_selected);
-	pk_task_get_files_async (PK_TASK (priv->task), package_ids, priv->cancellable,
+	gpk_query_scheduler_query (priv->scheduler, GPK_QUERY_KIND_FILES, package_ids,
 				   (PkProgressCallback) gpk_application_progress_cb, priv,
-				   (GAsyncReadyCallback) gpk_application_get_files_cb, priv);
+				   (GpkQueryFunc) gpk_application_get_files_cb, priv);
 }
 
 static gboolean
 gpk_application_remove (GpkApplicationPrivate *priv)
 {
-	gboolean ret;
-	g_autofree gchar *package_id_selected = NULL;
-	g_autofree gchar *summary_selected = NULL;
-	g_autoptr(PkPackage) package = NULL;
-
-	/* get selection */
-	ret = gpk_application_get_selected_package (priv, &package_id_selected, &summary_selected);
-	if (!ret) {
-		g_warning ("no package selected");
-		goto out;
-	}
-
-	/* changed mind, or wrong mode */
-	if (priv->action == GPK_ACTION_INSTALL) {
-		ret = pk_package_sack_remove_package_by_id (priv->package_sack, package_id_selected);
-		if (ret) {
-			g_debug ("removed %s from package array", package_id_selected);
-
-			/* correct buttons */
-			gpk_application_allow_install (priv, TRUE);
-			gpk_application_allow_remove (priv, FALSE);
-			gpk_application_packages_checkbox_invert (priv);
-			ret = TRUE;
-			goto out;
-		}
-		g_warning ("wrong mode and not in array");
-		ret = FALSE;
-		goto out;
-	}
-
-	/* already added */
-	ret = (pk_package_sack_find_by_id (priv->package_sack, package_id_selected) == NULL);
-	if (!ret) {
-		g_warning ("already added");
-		goto out;
-	}
-
-	priv->action = GPK_ACTION_REMOVE;
-	package = pk_package_new ();
-	pk_package_set_id (package, package_id_selected, NULL);
-	g_object_set (package,
-		      "info", PK_INFO_ENUM_INSTALLED,
-		      "summary", summary_selected,
-		      NULL);
-	pk_package_sack_add_package (priv->package_sack, package);
-
-	/* correct buttons */
-	gpk_application_allow_install (priv, TRUE);
-	gpk_application_allow_remove (priv, FALSE);
-	gpk_application_packages_checkbox_invert (priv);
-out:
-	/* add the selected group if there are any packages in the queue */
-	gpk_application_change_queue_status (priv);
-	return TRUE;
+	return gpk_application_queue_selected (priv, GPK_ACTION_REMOVE);
 }
 
 static void
@@ -737,10 +930,9 @@ gpk_application_menu_remove_cb (GtkAction *action, GpkApplicationPrivate *priv)
 }
 
 static void
-gpk_application_get_requires_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_get_requires_cb (GpkQueryScheduler *scheduler, PkResults *results,
+				const GError *error, GpkApplicationPrivate *priv)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 	GtkWindow *window;
@@ -752,8 +944,6 @@ gpk_application_get_requires_cb (PkTask *task, GAsyncResult *res, GpkApplication
 	g_autofree gchar *package_id_selected = NULL;
 	gboolean ret;
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
 	if (results == NULL) {
 		g_warning ("failed to get requires: %s", error->message);
 		return;
@@ -830,24 +1020,17 @@ gpk_application_menu_requires_cb (GtkAction *action, GpkApplicationPrivate *priv
 		return;
 	}
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
 	/* get the requires */
 	package_ids = pk_package_ids_from_id (package_id_selected);
-
-	pk_task_depends_on_async (PK_TASK (priv->task),
-				    pk_bitfield_value (PK_FILTER_ENUM_NONE),
-				    package_ids, TRUE, priv->cancellable,
-				    (PkProgressCallback) gpk_application_progress_cb, priv,
-				    (GAsyncReadyCallback) gpk_application_get_depends_cb, priv);
+	gpk_query_scheduler_query (priv->scheduler, GPK_QUERY_KIND_DEPENDS_ON, package_ids,
+				   (PkProgressCallback) gpk_application_progress_cb, priv,
+				   (GpkQueryFunc) gpk_application_get_depends_cb, priv);
 }
 
 static void
-gpk_application_get_depends_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_get_depends_cb (GpkQueryScheduler *scheduler, PkResults *results,
+				const GError *error, GpkApplicationPrivate *priv)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 	GtkWindow *window;
@@ -859,8 +1042,6 @@ gpk_application_get_depends_cb (PkTask *task, GAsyncResult *res, GpkApplicationP
 	g_autofree gchar *package_id_selected = NULL;
 	gboolean ret;
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
 	if (results == NULL) {
 		g_warning ("failed to get depends: %s", error->message);
 		return;
@@ -937,17 +1118,11 @@ gpk_application_menu_depends_cb (GtkAction *_action, GpkApplicationPrivate *priv
 		return;
 	}
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
 	/* get the depends */
 	package_ids = pk_package_ids_from_id (package_id_selected);
-
-	pk_task_required_by_async (PK_TASK (priv->task),
-				     pk_bitfield_value (PK_FILTER_ENUM_NONE),
-				     package_ids, TRUE, priv->cancellable,
-				     (PkProgressCallback) gpk_application_progress_cb, priv,
-				     (GAsyncReadyCallback) gpk_application_get_requires_cb, priv);
+	gpk_query_scheduler_query (priv->scheduler, GPK_QUERY_KIND_REQUIRED_BY, package_ids,
+				   (PkProgressCallback) gpk_application_progress_cb, priv,
+				   (GpkQueryFunc) gpk_application_get_requires_cb, priv);
 }
 
 static const gchar *
@@ -1001,41 +1176,61 @@ gpk_application_clear_details (GpkApplicationPrivate *priv)
 				 "[GpkApplication] clear-details");
 }
 
+static GpkPackageModel *
+gpk_application_packages_store_new (GpkApplicationPrivate *priv)
+{
+	GtkWidget *widget;
+
+	/* the row markup uses the window style */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "window_manager"));
+	return gpk_package_model_new (gtk_widget_get_style_context (widget));
+}
+
+static void
+gpk_application_load_cancel (GpkApplicationPrivate *priv)
+{
+	if (priv->load_id > 0) {
+		g_source_remove (priv->load_id);
+		priv->load_id = 0;
+	}
+	g_ptr_array_set_size (priv->load_queue, 0);
+	g_ptr_array_set_size (priv->load_shown, 0);
+	g_clear_object (&priv->load_store);
+	priv->load_done = FALSE;
+	priv->load_time = 0;
+	priv->load_rows = 0;
+}
+
 static void
 gpk_application_clear_packages (GpkApplicationPrivate *priv)
 {
 	/* clear existing array */
 	priv->has_package = FALSE;
-	gtk_list_store_clear (priv->packages_store);
+	gpk_application_load_cancel (priv);
+	g_hash_table_remove_all (priv->search_package_ids);
+	g_clear_pointer (&priv->search_results, g_hash_table_unref);
+	g_clear_pointer (&priv->search_packages, g_ptr_array_unref);
+	gpk_package_model_clear (priv->packages_store);
 }
 
 static void
-gpk_application_add_item_to_results (GpkApplicationPrivate *priv, PkPackage *item)
+gpk_application_add_item_to_results (GpkApplicationPrivate *priv, GpkPackageModel *store, PkPackage *item)
 {
-	GtkTreeIter iter;
-	g_autofree gchar *text = NULL;
 	gboolean in_queue;
 	gboolean installed;
-	gboolean enabled;
 	PkBitfield state = 0;
-	static guint package_cnt = 0;
 	PkInfoEnum info;
-	g_autofree gchar *package_id = NULL;
-	g_autofree gchar *summary = NULL;
-	GtkWidget *widget;
+	const gchar *package_id;
 
 	/* get data */
-	g_object_get (item,
-		      "info", &info,
-		      "package-id", &package_id,
-		      "summary", &summary,
-		      NULL);
+	info = pk_package_get_info (item);
+	package_id = pk_package_get_id (item);
 
 	/* mark as got so we don't warn */
 	priv->has_package = TRUE;
 
 	/* are we in the package array? */
-	in_queue = (pk_package_sack_find_by_id (priv->package_sack, package_id) != NULL);
+	in_queue = g_hash_table_contains (priv->queue, package_id);
 	installed = (info == PK_INFO_ENUM_INSTALLED) || (info == PK_INFO_ENUM_COLLECTION_INSTALLED);
 
 	if (installed)
@@ -1047,40 +1242,319 @@ gpk_application_add_item_to_results (GpkApplicationPrivate *priv, PkPackage *ite
 	if (info == PK_INFO_ENUM_COLLECTION_INSTALLED || info == PK_INFO_ENUM_COLLECTION_AVAILABLE)
 		pk_bitfield_add (state, GPK_STATE_COLLECTION);
 
-	/* use two lines */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "window_manager"));
-	text = gpk_package_id_format_twoline (gtk_widget_get_style_context (widget),
-					      package_id,
-					      summary);
-
-	/* can we modify this? */
-	enabled = gpk_application_get_checkbox_enable (priv, state);
-
-	gtk_list_store_append (priv->packages_store, &iter);
-	gtk_list_store_set (priv->packages_store, &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
-			    PACKAGES_COLUMN_CHECKBOX_VISIBLE, enabled,
-			    PACKAGES_COLUMN_TEXT, text,
-			    PACKAGES_COLUMN_SUMMARY, summary,
-			    PACKAGES_COLUMN_ID, package_id,
-			    PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
-			    -1);
+	/* the two line markup is generated by the model when drawn */
+	gpk_package_model_insert_with_values (store, NULL,
+					      PACKAGES_COLUMN_STATE, state,
+					      PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
+					      PACKAGES_COLUMN_CHECKBOX_VISIBLE, TRUE,
+					      PACKAGES_COLUMN_SUMMARY, pk_package_get_summary (item),
+					      PACKAGES_COLUMN_ID, package_id,
+					      PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
+					      -1);
+}
+
+static void
+gpk_application_load_attach (GpkApplicationPrivate *priv)
+{
+	GtkSortType order;
+	GtkTreeView *treeview;
+	gint sort_column_id;
+	guint i;
+
+	/* rows already shown go across with their current queue state */
+	for (i = 0; i < priv->load_shown->len; i++) {
+		gpk_application_add_item_to_results (priv, priv->load_store,
+						     g_ptr_array_index (priv->load_shown, i));
+	}
+	g_ptr_array_set_size (priv->load_shown, 0);
+
+	/* sort once, keeping whatever order the user chose */
+	if (!gtk_tree_sortable_get_sort_column_id (GTK_TREE_SORTABLE (priv->packages_store),
+						   &sort_column_id, &order)) {
+		sort_column_id = PACKAGES_COLUMN_ID;
+		order = GTK_SORT_ASCENDING;
+	}
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (priv->load_store),
+					      sort_column_id, order);
+
+	/* swap it into the view */
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	gtk_tree_view_set_model (treeview, GTK_TREE_MODEL (priv->load_store));
+	g_object_unref (priv->packages_store);
+	priv->packages_store = g_steal_pointer (&priv->load_store);
+}
 
-	/* only process every n events else we re-order too many times */
-	if (package_cnt++ % 200 == 0) {
-		while (gtk_events_pending ())
-			gtk_main_iteration ();
+static void gpk_application_search_finished (GpkApplicationPrivate *priv);
+
+static gboolean
+gpk_application_load_idle_cb (GpkApplicationPrivate *priv)
+{
+	GpkPackageModel *store;
+	PkPackage *item;
+	gdouble elapsed;
+	gint64 start;
+	gint64 now;
+	guint i;
+
+	/* too many for the view to take row by row, so fill a detached store;
+	 * only the rows of this load can be carried across, so not when the
+	 * view already shows others, e.g. when a filter is turned off */
+	if (priv->load_store == NULL &&
+	    priv->load_queue->len > GPK_APPLICATION_LOAD_DETACH_ROWS &&
+	    gtk_tree_model_iter_n_children (GTK_TREE_MODEL (priv->packages_store),
+					    NULL) == (gint) priv->load_shown->len) {
+		g_debug ("loading %u rows into a detached model", priv->load_queue->len);
+		priv->load_store = gpk_application_packages_store_new (priv);
 	}
+	store = priv->load_store != NULL ? priv->load_store : priv->packages_store;
+
+	/* only use part of the frame so the UI stays responsive, and put
+	 * the rows in order once rather than moving the rest for each one */
+	start = g_get_monotonic_time ();
+	gpk_package_model_freeze_sort (store);
+	for (i = 0; i < priv->load_queue->len; ) {
+		item = g_ptr_array_index (priv->load_queue, i++);
+		gpk_application_add_item_to_results (priv, store, item);
+		if (store == priv->packages_store)
+			g_ptr_array_add (priv->load_shown, g_object_ref (item));
+		if (i % 32 == 0 &&
+		    g_get_monotonic_time () - start > GPK_APPLICATION_LOAD_BUDGET * 1000)
+			break;
+	}
+	gpk_package_model_thaw_sort (store);
+	g_ptr_array_remove_range (priv->load_queue, 0, i);
+	now = g_get_monotonic_time ();
+	priv->load_time += now - start;
+	priv->load_rows += i;
+
+	/* more to do */
+	if (priv->load_queue->len > 0)
+		return G_SOURCE_CONTINUE;
+
+	/* still waiting for the transaction to send more */
+	priv->load_id = 0;
+	if (!priv->load_done)
+		return G_SOURCE_REMOVE;
+
+	if (priv->load_store != NULL)
+		gpk_application_load_attach (priv);
+	elapsed = (gdouble) (priv->load_time + g_get_monotonic_time () - now) / G_USEC_PER_SEC;
+	g_debug ("loaded %u rows in %.0fms (%.0f rows/s)",
+		 priv->load_rows, elapsed * 1000,
+		 elapsed > 0 ? priv->load_rows / elapsed : 0);
+	priv->load_done = FALSE;
+	priv->load_time = 0;
+	priv->load_rows = 0;
+	g_ptr_array_set_size (priv->load_shown, 0);
+	gpk_application_search_finished (priv);
+	return G_SOURCE_REMOVE;
 }
 
 static void
-gpk_application_suggest_better_search (GpkApplicationPrivate *priv)
+gpk_application_load_ensure (GpkApplicationPrivate *priv)
+{
+	if (priv->load_id > 0)
+		return;
+	priv->load_id = g_idle_add ((GSourceFunc) gpk_application_load_idle_cb, priv);
+	g_source_set_name_by_id (priv->load_id, "[GpkApplication] load");
+}
+
+static void
+gpk_application_load_queue (GpkApplicationPrivate *priv, PkPackage *item)
+{
+	g_ptr_array_add (priv->load_queue, g_object_ref (item));
+	gpk_application_load_ensure (priv);
+}
+
+static void
+gpk_application_load_finish (GpkApplicationPrivate *priv)
+{
+	/* the loader finishes the search once the queue is drained */
+	priv->load_done = TRUE;
+	gpk_application_load_ensure (priv);
+}
+
+static PkBitfield
+gpk_application_get_filters_backend (GpkApplicationPrivate *priv)
+{
+	PkBitfield filters = priv->filters_current;
+
+	/* applied to the results locally, so toggling them needs no transaction */
+	pk_bitfield_remove (filters, PK_FILTER_ENUM_NEWEST);
+	pk_bitfield_remove (filters, PK_FILTER_ENUM_ARCH);
+	return filters;
+}
+
+static const gchar *
+gpk_application_arch_normalize (const gchar *arch)
+{
+	/* the distro id uses the kernel name, which not all packages do */
+	if (g_strcmp0 (arch, "amd64") == 0)
+		return "x86_64";
+	if (g_strcmp0 (arch, "arm64") == 0)
+		return "aarch64";
+	if (g_strcmp0 (arch, "armhf") == 0 || g_strcmp0 (arch, "armv7hl") == 0)
+		return "armv7l";
+	if (g_strcmp0 (arch, "ppc64el") == 0)
+		return "ppc64le";
+	return arch;
+}
+
+static gboolean
+gpk_application_filter_arch (GpkApplicationPrivate *priv, PkPackage *item)
+{
+	const gchar *arch;
+
+	if (!pk_bitfield_contain (priv->filters_current, PK_FILTER_ENUM_ARCH))
+		return TRUE;
+	if (priv->arch_native == NULL)
+		return TRUE;
+
+	/* these can be installed anywhere */
+	arch = pk_package_get_arch (item);
+	if (arch == NULL || arch[0] == '\0' ||
+	    g_strcmp0 (arch, "noarch") == 0 ||
+	    g_strcmp0 (arch, "all") == 0 ||
+	    g_strcmp0 (arch, "any") == 0)
+		return TRUE;
+	return g_strcmp0 (gpk_application_arch_normalize (arch), priv->arch_native) == 0;
+}
+
+static gboolean
+gpk_application_package_is_installed (PkPackage *item)
+{
+	PkInfoEnum info = pk_package_get_info (item);
+	return info == PK_INFO_ENUM_INSTALLED || info == PK_INFO_ENUM_COLLECTION_INSTALLED;
+}
+
+static guint
+gpk_application_package_newest_hash (gconstpointer key)
+{
+	PkPackage *item = (PkPackage *) key;
+	const gchar *arch = pk_package_get_arch (item);
+	guint hash;
+
+	hash = g_str_hash (pk_package_get_name (item));
+	if (arch != NULL)
+		hash = hash * 31 + g_str_hash (arch);
+	return hash * 2 + gpk_application_package_is_installed (item);
+}
+
+static gboolean
+gpk_application_package_newest_equal (gconstpointer a, gconstpointer b)
+{
+	PkPackage *item1 = (PkPackage *) a;
+	PkPackage *item2 = (PkPackage *) b;
+
+	return g_strcmp0 (pk_package_get_name (item1), pk_package_get_name (item2)) == 0 &&
+	       g_strcmp0 (pk_package_get_arch (item1), pk_package_get_arch (item2)) == 0 &&
+	       gpk_application_package_is_installed (item1) == gpk_application_package_is_installed (item2);
+}
+
+/**
+ * gpk_application_filter_packages:
+ *
+ * Applies the arch and newest filters to what the backend returned. An
+ * installed package is kept next to the newest available version of it,
+ * so updates still show up.
+ *
+ * Return value: the packages to show, in the same order, owned by @array
+ **/
+static GPtrArray *
+gpk_application_filter_packages (GpkApplicationPrivate *priv, GPtrArray *array)
+{
+	GPtrArray *filtered;
+	PkPackage *item;
+	PkPackage *newest;
+	guint i;
+	g_autoptr(GHashTable) hash = NULL;
+
+	if (!pk_bitfield_contain (priv->filters_current, PK_FILTER_ENUM_NEWEST) &&
+	    !pk_bitfield_contain (priv->filters_current, PK_FILTER_ENUM_ARCH))
+		return g_ptr_array_ref (array);
+
+	/* find the newest of each name and arch */
+	if (pk_bitfield_contain (priv->filters_current, PK_FILTER_ENUM_NEWEST)) {
+		hash = g_hash_table_new (gpk_application_package_newest_hash,
+					 gpk_application_package_newest_equal);
+		for (i = 0; i < array->len; i++) {
+			item = g_ptr_array_index (array, i);
+			if (!gpk_application_filter_arch (priv, item))
+				continue;
+			newest = g_hash_table_lookup (hash, item);
+			if (newest == NULL ||
+			    gpk_package_version_compare (pk_package_get_version (item),
+							 pk_package_get_version (newest)) > 0)
+				g_hash_table_replace (hash, item, item);
+		}
+	}
+
+	filtered = g_ptr_array_sized_new (array->len);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		if (!gpk_application_filter_arch (priv, item))
+			continue;
+		if (hash != NULL && g_hash_table_lookup (hash, item) != item)
+			continue;
+		g_ptr_array_add (filtered, item);
+	}
+	return filtered;
+}
+
+static void
+gpk_application_search_add_package (GpkApplicationPrivate *priv, PkPackage *item)
+{
+	const gchar *package_id = pk_package_get_id (item);
+
+	/* older versions streamed in are removed once all the results are in */
+	if (!gpk_application_filter_arch (priv, item))
+		return;
+
+	/* already shown from a progress event */
+	if (g_hash_table_contains (priv->search_package_ids, package_id))
+		return;
+	if (g_hash_table_size (priv->search_package_ids) == 0) {
+		g_debug ("first search result after %.0fms",
+			 g_timer_elapsed (priv->search_timer, NULL) * 1000);
+	}
+	g_hash_table_add (priv->search_package_ids, g_strdup (package_id));
+	gpk_application_load_queue (priv, item);
+}
+
+typedef struct {
+	GpkApplicationPrivate	*priv;
+	GHashTable		*package_ids;
+} GpkApplicationStaleHelper;
+
+static gboolean
+gpk_application_search_remove_stale_cb (const gchar *package_id, GpkApplicationStaleHelper *helper)
+{
+	if (package_id == NULL || g_hash_table_contains (helper->package_ids, package_id))
+		return TRUE;
+	g_hash_table_remove (helper->priv->search_package_ids, package_id);
+	return FALSE;
+}
+
+static void
+gpk_application_search_remove_stale (GpkApplicationPrivate *priv, GHashTable *package_ids)
+{
+	GpkApplicationStaleHelper helper = { priv, package_ids };
+	guint removed;
+
+	/* remove anything streamed that is not in the final result set */
+	removed = gpk_package_model_remove_by_filter (priv->packages_store,
+						      (GpkPackageModelFilterFunc) gpk_application_search_remove_stale_cb,
+						      &helper);
+	g_debug ("removed %u stale results", removed);
+	priv->has_package = g_hash_table_size (priv->search_package_ids) > 0;
+}
+
+static void
+gpk_application_suggest_better_search (GpkApplicationPrivate *priv)
 {
 	const gchar *message = NULL;
 	/* TRANSLATORS: no results were found for this search */
 	const gchar *title = _("No results were found.");
-	GtkTreeIter iter;
 	g_autofree gchar *text = NULL;
 	PkBitfield state = 0;
 
@@ -1102,22 +1576,14 @@ gpk_application_suggest_better_search (GpkApplicationPrivate *priv)
 	}
 
 	text = g_strdup_printf ("%s\n%s", title, message);
-	gtk_list_store_append (priv->packages_store, &iter);
-	gtk_list_store_set (priv->packages_store, &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, FALSE,
-			    PACKAGES_COLUMN_CHECKBOX_VISIBLE, FALSE,
-			    PACKAGES_COLUMN_TEXT, text,
-			    PACKAGES_COLUMN_IMAGE, "system-search",
-			    PACKAGES_COLUMN_ID, NULL,
-			    -1);
-}
-
-static gboolean
-gpk_application_perform_search_idle_cb (GpkApplicationPrivate *priv)
-{
-	gpk_application_perform_search (priv);
-	return FALSE;
+	gpk_package_model_insert_with_values (priv->packages_store, NULL,
+					      PACKAGES_COLUMN_STATE, state,
+					      PACKAGES_COLUMN_CHECKBOX, FALSE,
+					      PACKAGES_COLUMN_CHECKBOX_VISIBLE, FALSE,
+					      PACKAGES_COLUMN_TEXT, text,
+					      PACKAGES_COLUMN_IMAGE, "system-search",
+					      PACKAGES_COLUMN_ID, NULL,
+					      -1);
 }
 
 /**
@@ -1146,11 +1612,12 @@ gpk_application_select_exact_match (GpkApplicationPrivate *priv, const gchar *te
 		g_autofree gchar *package_id = NULL;
 		gtk_tree_model_get (model, &iter, PACKAGES_COLUMN_ID, &package_id, -1);
 		if (package_id != NULL) {
-			g_auto(GStrv) split = NULL;
+			GpkPackageIdView view;
 			/* exact match, so select and scroll */
-			split = pk_package_id_split (package_id);
-			if (g_strcmp0 (split[PK_PACKAGE_ID_NAME], text) == 0) {
+			if (gpk_package_id_view_init (&view, package_id) &&
+			    gpk_package_id_view_equal (&view, PK_PACKAGE_ID_NAME, text)) {
 				selection = gtk_tree_view_get_selection (treeview);
+				gtk_tree_selection_unselect_all (selection);
 				gtk_tree_selection_select_iter (selection, &iter);
 				path = gtk_tree_model_get_path (model, &iter);
 				gtk_tree_view_scroll_to_cell (treeview, path, NULL, FALSE, 0.5f, 0.5f);
@@ -1165,10 +1632,30 @@ gpk_application_select_exact_match (GpkApplicationPrivate *priv, const gchar *te
 	}
 }
 
+static void
+gpk_application_search_finished (GpkApplicationPrivate *priv)
+{
+	/* failed or cancelled, so just keep what we have */
+	if (priv->search_results == NULL)
+		return;
+
+	if (g_hash_table_size (priv->search_package_ids) > g_hash_table_size (priv->search_results))
+		gpk_application_search_remove_stale (priv, priv->search_results);
+	g_clear_pointer (&priv->search_results, g_hash_table_unref);
+
+	/* were there no entries found? */
+	if (!priv->has_package)
+		gpk_application_suggest_better_search (priv);
+
+	/* if there is an exact match, select it */
+	gpk_application_select_exact_match (priv, priv->search_text);
+}
+
 static void
 gpk_application_cancel_cb (GtkWidget *button_widget, GpkApplicationPrivate *priv)
 {
-	g_cancellable_cancel (priv->cancellable);
+	if (priv->search_cancellable != NULL)
+		g_cancellable_cancel (priv->search_cancellable);
 
 	/* switch buttons around */
 	priv->search_mode = GPK_MODE_UNKNOWN;
@@ -1179,25 +1666,408 @@ gpk_application_set_button_find_sensitivity (GpkApplicationPrivate *priv)
 {
 	GtkWidget *widget;
 
-	/* only sensitive if not in the middle of a search */
+	/* only sensitive if not in the middle of a search, unless typing
+	 * is going to replace the search that is running */
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
-	gtk_widget_set_sensitive (widget, !priv->search_in_progress);
+	gtk_widget_set_sensitive (widget, !priv->search_in_progress ||
+				  g_settings_get_boolean (priv->settings, GPK_SETTINGS_SEARCH_AS_YOU_TYPE));
+}
+
+static void
+gpk_application_search_set_results (GpkApplicationPrivate *priv, GPtrArray *array)
+{
+	PkPackage *item;
+	guint i;
+	g_autoptr(GPtrArray) filtered = NULL;
+
+	/* kept so the local filters can be changed without searching again */
+	if (array != priv->search_packages) {
+		g_clear_pointer (&priv->search_packages, g_ptr_array_unref);
+		priv->search_packages = g_ptr_array_ref (array);
+	}
+
+	/* anything not in here is removed when the loader finishes */
+	filtered = gpk_application_filter_packages (priv, array);
+	g_clear_pointer (&priv->search_results, g_hash_table_unref);
+	priv->search_results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < filtered->len; i++) {
+		item = g_ptr_array_index (filtered, i);
+		g_hash_table_add (priv->search_results, g_strdup (pk_package_get_id (item)));
+		gpk_application_search_add_package (priv, item);
+	}
+}
+
+static void
+gpk_application_search_cache_item_free (GpkApplicationCacheItem *item)
+{
+	g_free (item->key);
+	g_ptr_array_unref (item->packages);
+	g_free (item);
 }
 
 static void
-gpk_application_search_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_search_cache_invalidate (GpkApplicationPrivate *priv, const gchar *reason)
+{
+	g_debug ("invalidating search cache as %s", reason);
+
+	/* searches already running started with the old data */
+	priv->search_cache_epoch++;
+	g_hash_table_remove_all (priv->search_cache_index);
+	g_queue_free_full (priv->search_cache, (GDestroyNotify) gpk_application_search_cache_item_free);
+	priv->search_cache = g_queue_new ();
+}
+
+static void
+gpk_application_details_cache_invalidate (GpkApplicationPrivate *priv, const gchar *reason)
+{
+	g_debug ("invalidating details cache as %s", reason);
+	g_hash_table_remove_all (priv->details_cache_index);
+	g_queue_free_full (priv->details_cache, (GDestroyNotify) g_object_unref);
+	priv->details_cache = g_queue_new ();
+}
+
+static void
+gpk_application_details_cache_add (GpkApplicationPrivate *priv, PkDetails *item)
+{
+	PkDetails *old;
+	GList *link;
+
+	/* the index keys are owned by the objects, so replace both */
+	link = g_hash_table_lookup (priv->details_cache_index, pk_details_get_package_id (item));
+	if (link != NULL) {
+		g_hash_table_remove (priv->details_cache_index, pk_details_get_package_id (item));
+		g_object_unref (link->data);
+		g_queue_delete_link (priv->details_cache, link);
+	}
+
+	/* drop the least recently used */
+	if (g_queue_get_length (priv->details_cache) >= GPK_APPLICATION_DETAILS_CACHE_SIZE) {
+		old = g_queue_pop_tail (priv->details_cache);
+		g_hash_table_remove (priv->details_cache_index, pk_details_get_package_id (old));
+		g_object_unref (old);
+	}
+
+	g_queue_push_head (priv->details_cache, g_object_ref (item));
+	g_hash_table_insert (priv->details_cache_index,
+			     (gpointer) pk_details_get_package_id (item),
+			     priv->details_cache->head);
+}
+
+static PkDetails *
+gpk_application_details_cache_lookup (GpkApplicationPrivate *priv, const gchar *package_id)
+{
+	GList *link;
+
+	link = g_hash_table_lookup (priv->details_cache_index, package_id);
+	if (link == NULL)
+		return NULL;
+
+	/* now the most recently used */
+	g_queue_unlink (priv->details_cache, link);
+	g_queue_push_head_link (priv->details_cache, link);
+	return link->data;
+}
+
+static void
+gpk_application_search_cache_add (GpkApplicationPrivate *priv, const gchar *key, GPtrArray *packages)
+{
+	GpkApplicationCacheItem *item;
+	GList *link;
+
+	link = g_hash_table_lookup (priv->search_cache_index, key);
+	if (link != NULL) {
+		g_hash_table_remove (priv->search_cache_index, key);
+		gpk_application_search_cache_item_free (link->data);
+		g_queue_delete_link (priv->search_cache, link);
+	}
+
+	/* drop the least recently used */
+	if (g_queue_get_length (priv->search_cache) >= GPK_APPLICATION_SEARCH_CACHE_SIZE) {
+		item = g_queue_pop_tail (priv->search_cache);
+		g_hash_table_remove (priv->search_cache_index, item->key);
+		gpk_application_search_cache_item_free (item);
+	}
+
+	item = g_new0 (GpkApplicationCacheItem, 1);
+	item->key = g_strdup (key);
+	item->packages = g_ptr_array_ref (packages);
+	g_queue_push_head (priv->search_cache, item);
+	g_hash_table_insert (priv->search_cache_index, item->key, priv->search_cache->head);
+}
+
+static gboolean
+gpk_application_search_cache_show (GpkApplicationPrivate *priv, const gchar *key)
+{
+	GpkApplicationCacheItem *item;
+	GList *link;
+
+	link = g_hash_table_lookup (priv->search_cache_index, key);
+	if (link == NULL) {
+		priv->search_cache_misses++;
+		g_debug ("search cache miss for %s (%u hits, %u misses)", key,
+			 priv->search_cache_hits, priv->search_cache_misses);
+		return FALSE;
+	}
+	priv->search_cache_hits++;
+	g_debug ("search cache hit for %s (%u hits, %u misses)", key,
+		 priv->search_cache_hits, priv->search_cache_misses);
+
+	/* now the most recently used */
+	g_queue_unlink (priv->search_cache, link);
+	g_queue_push_head_link (priv->search_cache, link);
+
+	item = link->data;
+	gpk_application_search_set_results (priv, item->packages);
+	gpk_application_load_finish (priv);
+
+	/* a search we cancelled may have left the entry insensitive */
+	gpk_application_set_button_find_sensitivity (priv);
+	return TRUE;
+}
+
+static gchar **
+gpk_application_search_terms_new (const gchar *text)
+{
+	GPtrArray *array;
+	guint i;
+	g_auto(GStrv) split = NULL;
+
+	/* the order of the terms does not change the results */
+	array = g_ptr_array_new ();
+	split = g_strsplit_set (text, " \t\n", -1);
+	for (i = 0; split[i] != NULL; i++) {
+		if (split[i][0] != '\0')
+			g_ptr_array_add (array, g_strdup (split[i]));
+	}
+	g_ptr_array_sort (array, (GCompareFunc) gpk_application_strcmp_indirect);
+	g_ptr_array_add (array, NULL);
+	return (gchar **) g_ptr_array_free (array, FALSE);
+}
+
+static gchar *
+gpk_application_search_cache_key (GpkApplicationPrivate *priv, gchar **terms)
+{
+	g_autofree gchar *joined = g_strjoinv (" ", terms);
+	GpkSearchType search_type = GPK_SEARCH_UNKNOWN;
+
+	/* the type only matters when searching for text */
+	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE)
+		search_type = priv->search_type;
+	return g_strdup_printf ("%u:%u:%" G_GUINT64_FORMAT ":%s",
+				priv->search_mode, search_type,
+				gpk_application_get_filters_backend (priv), joined);
+}
+
+static gboolean
+gpk_application_details_index_idle_cb (GpkApplicationPrivate *priv)
+{
+	const gchar *package_id;
+	const gchar *summary;
+	PkInfoEnum info;
+	gint64 start = g_get_monotonic_time ();
+	guint size;
+
+	/* the summaries are already in the name index */
+	size = gpk_name_index_get_size (priv->name_index);
+	while (priv->details_index_pos < size) {
+		gpk_name_index_get_entry (priv->name_index, priv->details_index_pos++,
+					  &package_id, &info, &summary);
+		gpk_details_index_add (priv->details_index, package_id, info, summary);
+
+		/* do not block the UI for more than a frame */
+		if (priv->details_index_pos % 32 == 0 &&
+		    g_get_monotonic_time () - start > GPK_APPLICATION_LOAD_BUDGET * 1000)
+			return G_SOURCE_CONTINUE;
+	}
+	g_debug ("details index has %u packages",
+		 gpk_details_index_get_size (priv->details_index));
+	priv->details_index_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpk_application_details_index_stop (GpkApplicationPrivate *priv)
+{
+	if (priv->details_index_id > 0) {
+		g_source_remove (priv->details_index_id);
+		priv->details_index_id = 0;
+	}
+	gpk_details_index_clear (priv->details_index);
+}
+
+static void
+gpk_application_details_index_fill (GpkApplicationPrivate *priv)
+{
+	gpk_application_details_index_stop (priv);
+	priv->details_index_pos = 0;
+	priv->details_index_id =
+		g_idle_add_full (G_PRIORITY_LOW,
+				 (GSourceFunc) gpk_application_details_index_idle_cb,
+				 priv, NULL);
+	g_source_set_name_by_id (priv->details_index_id, "[GpkApplication] details index");
+}
+
+static void
+gpk_application_name_index_rebuild_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GpkApplicationPrivate *priv = user_data;
+	g_autoptr(GError) error = NULL;
+
+	/* the new file is mapped by the time this returns */
+	if (!gpk_name_index_rebuild_finish (GPK_NAME_INDEX (source), res, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to rebuild name index: %s", error->message);
+		return;
+	}
+	gpk_application_details_index_fill (priv);
+}
+
+static void
+gpk_application_name_index_get_packages_cb (PkClient *client, GAsyncResult *res, GpkApplicationPrivate *priv)
 {
 	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	PkPackage *item;
+
+	/* get the results */
+	results = pk_client_generic_finish (client, res, &error);
+	if (results == NULL) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to get packages for name index: %s", error->message);
+		return;
+	}
+
+	/* check error code */
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_warning ("failed to get packages for name index: %s, %s",
+			   pk_error_enum_to_string (pk_error_get_code (error_code)),
+			   pk_error_get_details (error_code));
+		return;
+	}
+
+	/* any filter change since has cancelled this */
+	array = pk_results_get_package_array (results);
+	g_debug ("rebuilding name index from %u packages", array->len);
+	gpk_name_index_rebuild_async (priv->name_index, array, gpk_application_get_filters_backend (priv),
+				      priv->name_index_cancellable,
+				      gpk_application_name_index_rebuild_cb, priv);
+}
+
+static gboolean
+gpk_application_name_index_rebuild_timeout_cb (GpkApplicationPrivate *priv)
+{
+	priv->name_index_id = 0;
+	pk_client_get_packages_async (priv->name_index_client,
+				      gpk_application_get_filters_backend (priv),
+				      priv->name_index_cancellable,
+				      NULL, NULL,
+				      (GAsyncReadyCallback) gpk_application_name_index_get_packages_cb, priv);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpk_application_name_index_invalidate (GpkApplicationPrivate *priv, const gchar *reason)
+{
+	/* nothing to rebuild it from */
+	if (!pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_PACKAGES))
+		return;
+
+	/* searches go to the backend until the new index is ready */
+	g_debug ("rebuilding name index as %s", reason);
+	gpk_name_index_invalidate (priv->name_index);
+	gpk_application_details_index_stop (priv);
+	g_cancellable_cancel (priv->name_index_cancellable);
+	g_object_unref (priv->name_index_cancellable);
+	priv->name_index_cancellable = g_cancellable_new ();
+
+	/* wait for things to settle, e.g. a transaction emitting several signals */
+	if (priv->name_index_id > 0)
+		g_source_remove (priv->name_index_id);
+	priv->name_index_id = g_timeout_add_seconds (GPK_APPLICATION_NAME_INDEX_DELAY,
+						     (GSourceFunc) gpk_application_name_index_rebuild_timeout_cb,
+						     priv);
+	g_source_set_name_by_id (priv->name_index_id, "[GpkApplication] name index");
+}
+
+static void
+gpk_application_search_details_index (GpkApplicationPrivate *priv, gchar **searches)
+{
 	guint i;
+	g_autoptr(GPtrArray) array = NULL;
+
+	if (priv->search_type != GPK_SEARCH_DETAILS)
+		return;
+	if (gpk_details_index_get_size (priv->details_index) == 0)
+		return;
+
+	/* most descriptions are missing, so the backend still has the
+	 * final say and removes anything it does not match */
+	array = gpk_details_index_search (priv->details_index, searches);
+	g_debug ("found %u packages in the details index after %.3fms", array->len,
+		 g_timer_elapsed (priv->search_timer, NULL) * 1000);
+	for (i = 0; i < array->len; i++)
+		gpk_application_search_add_package (priv, g_ptr_array_index (array, i));
+}
+
+static gboolean
+gpk_application_search_name_index (GpkApplicationPrivate *priv, gchar **searches)
+{
+	g_autoptr(GPtrArray) array = NULL;
+
+	if (priv->search_type != GPK_SEARCH_NAME)
+		return FALSE;
+	if (!gpk_name_index_is_valid (priv->name_index, gpk_application_get_filters_backend (priv))) {
+		g_debug ("name index is not valid, using the backend");
+		return FALSE;
+	}
+	array = gpk_name_index_search (priv->name_index, searches);
+	if (array == NULL)
+		return FALSE;
+	g_debug ("found %u names in the index after %.3fms", array->len,
+		 g_timer_elapsed (priv->search_timer, NULL) * 1000);
+
+	gpk_application_search_set_results (priv, array);
+	gpk_application_load_finish (priv);
+
+	/* a search we cancelled may have left the entry insensitive */
+	gpk_application_set_button_find_sensitivity (priv);
+	return TRUE;
+}
+
+static void
+gpk_application_search_cb (PkTask *task, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GpkApplicationSearchHelper) helper = user_data;
+	GpkApplicationPrivate *priv = helper->priv;
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(GPtrArray) array = NULL;
 	GtkWidget *widget;
 	GtkWindow *window;
 
 	/* get the results */
 	results = pk_task_generic_finish (task, res, &error);
+
+	/* still valid even if the user has moved on */
+	if (results != NULL && helper->cache_key != NULL) {
+		error_code = pk_results_get_error_code (results);
+		if (error_code == NULL && helper->cache_epoch == priv->search_cache_epoch) {
+			array = pk_results_get_package_array (results);
+			gpk_application_search_cache_add (priv, helper->cache_key, array);
+		}
+		g_clear_object (&error_code);
+		g_clear_pointer (&array, g_ptr_array_unref);
+	}
+
+	/* a newer search has already cleared the list */
+	if (helper->generation != priv->search_generation) {
+		g_debug ("ignoring results from search %u", helper->generation);
+		return;
+	}
+
 	if (results == NULL) {
 		g_warning ("failed to search: %s", error->message);
 		goto out;
@@ -1217,19 +2087,11 @@ gpk_application_search_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivat
 		goto out;
 	}
 
-	/* get data */
+	/* reconcile with what was streamed from the progress events */
 	array = pk_results_get_package_array (results);
-	for (i = 0; i < array->len; i++) {
-		item = g_ptr_array_index (array, i);
-		gpk_application_add_item_to_results (priv, item);
-	}
-
-	/* were there no entries found? */
-	if (!priv->has_package)
-		gpk_application_suggest_better_search (priv);
-
-	/* if there is an exact match, select it */
-	gpk_application_select_exact_match (priv, priv->search_text);
+	gpk_application_search_set_results (priv, array);
+	g_debug ("search finished with %u results after %.0fms", array->len,
+		 g_timer_elapsed (priv->search_timer, NULL) * 1000);
 
 	/* focus back to the text extry */
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "entry_text"));
@@ -1245,6 +2107,9 @@ gpk_application_search_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivat
 	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
 	gtk_widget_set_sensitive (widget, TRUE);
 out:
+	/* show whatever is still queued */
+	gpk_application_load_finish (priv);
+
 	/* mark find button sensitive */
 	priv->search_in_progress = FALSE;
 	gpk_application_set_button_find_sensitivity (priv);
@@ -1260,6 +2125,8 @@ gpk_application_perform_search_name_details_file (GpkApplicationPrivate *priv)
 	g_autoptr(GError) error = NULL;
 	gboolean ret;
 	g_auto(GStrv) searches = NULL;
+	g_autofree gchar *cache_key = NULL;
+	GpkApplicationSearchHelper *helper;
 
 	entry = GTK_ENTRY (gtk_builder_get_object (priv->builder, "entry_text"));
 	g_free (priv->search_text);
@@ -1285,35 +2152,53 @@ gpk_application_perform_search_name_details_file (GpkApplicationPrivate *priv)
 	}
 	g_debug ("find %s", priv->search_text);
 
+	/* only whitespace */
+	searches = gpk_application_search_terms_new (priv->search_text);
+	if (searches[0] == NULL) {
+		g_debug ("no search terms");
+		return;
+	}
+
+	/* we've done this before */
+	cache_key = gpk_application_search_cache_key (priv, searches);
+	if (gpk_application_search_cache_show (priv, cache_key))
+		return;
+
+	/* no need to ask the daemon */
+	if (gpk_application_search_name_index (priv, searches))
+		return;
+
+	/* show what we know about while the daemon searches */
+	gpk_application_search_details_index (priv, searches);
+
 	/* mark find button insensitive */
 	priv->search_in_progress = TRUE;
 	gpk_application_set_button_find_sensitivity (priv);
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
-	/* do the search */
-	searches = g_strsplit (priv->search_text, " ", -1);
+	/* do the search, the helper is freed in the finished callback */
+	helper = gpk_application_search_helper_new (priv, g_steal_pointer (&cache_key));
 	if (priv->search_type == GPK_SEARCH_NAME) {
 		pk_task_search_names_async (priv->task,
-					     priv->filters_current,
-					     searches, priv->cancellable,
-					     (PkProgressCallback) gpk_application_progress_cb, priv,
-					     (GAsyncReadyCallback) gpk_application_search_cb, priv);
+					     gpk_application_get_filters_backend (priv),
+					     searches, priv->search_cancellable,
+					     (PkProgressCallback) gpk_application_search_progress_cb, helper,
+					     (GAsyncReadyCallback) gpk_application_search_cb, helper);
 	} else if (priv->search_type == GPK_SEARCH_DETAILS) {
 		pk_task_search_details_async (priv->task,
-					     priv->filters_current,
-					     searches, priv->cancellable,
-					     (PkProgressCallback) gpk_application_progress_cb, priv,
-					     (GAsyncReadyCallback) gpk_application_search_cb, priv);
+					     gpk_application_get_filters_backend (priv),
+					     searches, priv->search_cancellable,
+					     (PkProgressCallback) gpk_application_search_progress_cb, helper,
+					     (GAsyncReadyCallback) gpk_application_search_cb, helper);
 	} else if (priv->search_type == GPK_SEARCH_FILE) {
 		pk_task_search_files_async (priv->task,
-					     priv->filters_current,
-					     searches, priv->cancellable,
-					     (PkProgressCallback) gpk_application_progress_cb, priv,
-					     (GAsyncReadyCallback) gpk_application_search_cb, priv);
+					     gpk_application_get_filters_backend (priv),
+					     searches, priv->search_cancellable,
+					     (PkProgressCallback) gpk_application_search_progress_cb, helper,
+					     (GAsyncReadyCallback) gpk_application_search_cb, helper);
 	} else {
 		g_warning ("invalid search type");
+		gpk_application_search_helper_free (helper);
+		priv->search_in_progress = FALSE;
 		return;
 	}
 
@@ -1331,64 +2216,78 @@ gpk_application_perform_search_name_details_file (GpkApplicationPrivate *priv)
 static void
 gpk_application_perform_search_others (GpkApplicationPrivate *priv)
 {
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
+	GpkApplicationSearchHelper *helper;
+	g_auto(GStrv) search_groups = NULL;
+	g_autofree gchar *cache_key = NULL;
+
+	/* we've done this before */
+	if (priv->search_mode == GPK_MODE_GROUP)
+		search_groups = gpk_application_search_terms_new (priv->search_group);
+	else
+		search_groups = g_new0 (gchar *, 1);
+	cache_key = gpk_application_search_cache_key (priv, search_groups);
+	if (gpk_application_search_cache_show (priv, cache_key))
+		return;
 
 	priv->search_in_progress = TRUE;
 
+	/* the helper is freed in the finished callback */
+	helper = gpk_application_search_helper_new (priv, g_steal_pointer (&cache_key));
 	if (priv->search_mode == GPK_MODE_GROUP) {
-		g_auto(GStrv) search_groups = NULL;
-		search_groups = g_strsplit (priv->search_group, " ", -1);
 		pk_task_search_groups_async (PK_TASK(priv->task),
-					       priv->filters_current, search_groups, priv->cancellable,
-					       (PkProgressCallback) gpk_application_progress_cb, priv,
-					       (GAsyncReadyCallback) gpk_application_search_cb, priv);
+					       gpk_application_get_filters_backend (priv), search_groups, priv->search_cancellable,
+					       (PkProgressCallback) gpk_application_search_progress_cb, helper,
+					       (GAsyncReadyCallback) gpk_application_search_cb, helper);
 	} else {
 		pk_task_get_packages_async (PK_TASK(priv->task),
-					      priv->filters_current, priv->cancellable,
-					      (PkProgressCallback) gpk_application_progress_cb, priv,
-					      (GAsyncReadyCallback) gpk_application_search_cb, priv);
+					      gpk_application_get_filters_backend (priv), priv->search_cancellable,
+					      (PkProgressCallback) gpk_application_search_progress_cb, helper,
+					      (GAsyncReadyCallback) gpk_application_search_cb, helper);
 	}
 }
 
 static gboolean
 gpk_application_populate_selected (GpkApplicationPrivate *priv)
 {
-	guint i;
-	PkPackage *package;
-	g_autoptr(GPtrArray) array = NULL;
-
-	/* get size */
-	array = pk_package_sack_get_array (priv->package_sack);
+	GHashTableIter iter;
+	gpointer package;
 
 	/* nothing in queue */
-	if (array->len == 0) {
+	if (g_hash_table_size (priv->queue) == 0) {
 		gpk_application_suggest_better_search (priv);
 		return TRUE;
 	}
 
 	/* dump queue to package window */
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		gpk_application_add_item_to_results (priv, package);
-	}
+	gpk_package_model_freeze_sort (priv->packages_store);
+	g_hash_table_iter_init (&iter, priv->queue);
+	while (g_hash_table_iter_next (&iter, NULL, &package))
+		gpk_application_add_item_to_results (priv, priv->packages_store, package);
+	gpk_package_model_thaw_sort (priv->packages_store);
 	return TRUE;
 }
 
 static void
 gpk_application_perform_search (GpkApplicationPrivate *priv)
 {
-	/*if we are in the middle of a search, just return*/
-	if (priv->search_in_progress == TRUE)
-		return;
-
 	/* just shown the welcome screen */
 	if (priv->search_mode == GPK_MODE_UNKNOWN)
 		return;
 
+	/* the new search replaces any that is still running */
+	if (priv->search_in_progress) {
+		g_debug ("cancelling search %u", priv->search_generation);
+		g_cancellable_cancel (priv->search_cancellable);
+		priv->search_in_progress = FALSE;
+	}
+	g_clear_object (&priv->search_cancellable);
+	priv->search_cancellable = g_cancellable_new ();
+	priv->search_generation++;
+
 	g_debug ("CLEAR search");
 	gpk_application_clear_details (priv);
 	gpk_application_clear_packages (priv);
+	g_timer_start (priv->search_timer);
 
 	if (priv->search_mode == GPK_MODE_NAME_DETAILS_FILE) {
 		gpk_application_perform_search_name_details_file (priv);
@@ -1405,6 +2304,11 @@ gpk_application_perform_search (GpkApplicationPrivate *priv)
 static void
 gpk_application_find_cb (GtkWidget *button_widget, GpkApplicationPrivate *priv)
 {
+	/* don't search again when the typing timeout fires */
+	if (priv->search_typing_id > 0) {
+		g_source_remove (priv->search_typing_id);
+		priv->search_typing_id = 0;
+	}
 	priv->search_mode = GPK_MODE_NAME_DETAILS_FILE;
 	gpk_application_perform_search (priv);
 }
@@ -1412,43 +2316,56 @@ gpk_application_find_cb (GtkWidget *button_widget, GpkApplicationPrivate *priv)
 static gboolean
 gpk_application_quit (GpkApplicationPrivate *priv)
 {
-	g_autoptr(GPtrArray) array = NULL;
-	gint len;
-	GtkResponseType result;
-	GtkWindow *window;
-	GtkWidget *dialog;
-
-	/* do we have any items queued for removal or installation? */
-	array = pk_package_sack_get_array (priv->package_sack);
-	len = array->len;
-
-	if (len != 0) {
-		window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-		dialog = gtk_message_dialog_new (window, GTK_DIALOG_MODAL,
-						 GTK_MESSAGE_WARNING, GTK_BUTTONS_CANCEL,
-						 /* TRANSLATORS: title: warn the user they are quitting with unapplied changes */
-						 "%s", _("Changes not applied"));
-		gtk_dialog_add_button (GTK_DIALOG (dialog), _("Close _Anyway"), GTK_RESPONSE_OK);
-		gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG(dialog),
-							  "%s\n%s",
-							  /* TRANSLATORS: tell the user the problem */
-							  _("You have made changes that have not yet been applied."),
-							  _("These changes will be lost if you close this window."));
-		gtk_window_set_icon_name (GTK_WINDOW (dialog), GPK_ICON_SOFTWARE_INSTALLER);
-		result = gtk_dialog_run (GTK_DIALOG (dialog));
-		gtk_widget_destroy (dialog);
-
-		/* did not agree */
-		if (result != GTK_RESPONSE_OK)
-			return FALSE;
+	/* the queue is kept for next time, so there is nothing to warn about */
+	if (priv->queue_save_id > 0) {
+		g_source_remove (priv->queue_save_id);
+		gpk_application_queue_save_cb (priv);
 	}
 
 	/* we might have visual stuff running, close them down */
-	g_cancellable_cancel (priv->cancellable);
+	gpk_query_scheduler_cancel_all (priv->scheduler);
+	if (priv->search_cancellable != NULL)
+		g_cancellable_cancel (priv->search_cancellable);
+	g_cancellable_cancel (priv->name_index_cancellable);
 	g_application_release (G_APPLICATION (priv->application));
 	return TRUE;
 }
 
+static gboolean
+gpk_application_search_typing_cb (GpkApplicationPrivate *priv)
+{
+	priv->search_typing_id = 0;
+	priv->search_mode = GPK_MODE_NAME_DETAILS_FILE;
+	gpk_application_perform_search (priv);
+	return FALSE;
+}
+
+static void
+gpk_application_search_typing_queue (GpkApplicationPrivate *priv, GtkEntry *entry)
+{
+	guint length;
+
+	/* restart the timeout on every keystroke */
+	if (priv->search_typing_id > 0) {
+		g_source_remove (priv->search_typing_id);
+		priv->search_typing_id = 0;
+	}
+	if (!g_settings_get_boolean (priv->settings, GPK_SETTINGS_SEARCH_AS_YOU_TYPE))
+		return;
+
+	/* too short to be useful, the user can still press enter */
+	length = gtk_entry_get_text_length (entry);
+	if (length == 0 ||
+	    length < g_settings_get_uint (priv->settings, GPK_SETTINGS_SEARCH_AS_YOU_TYPE_MIN_LENGTH))
+		return;
+
+	priv->search_typing_id =
+		g_timeout_add (g_settings_get_uint (priv->settings, GPK_SETTINGS_SEARCH_AS_YOU_TYPE_DELAY),
+			       (GSourceFunc) gpk_application_search_typing_cb, priv);
+	g_source_set_name_by_id (priv->search_typing_id,
+				 "[GpkApplication] search-as-you-type");
+}
+
 static gboolean
 gpk_application_text_changed_cb (GtkEntry *entry, GpkApplicationPrivate *priv)
 {
@@ -1465,6 +2382,9 @@ gpk_application_text_changed_cb (GtkEntry *entry, GpkApplicationPrivate *priv)
 
 	/* mark find button sensitive */
 	gpk_application_set_button_find_sensitivity (priv);
+
+	/* search once the user stops typing */
+	gpk_application_search_typing_queue (priv, entry);
 	return FALSE;
 }
 
@@ -1488,193 +2408,520 @@ gpk_application_packages_installed_clicked_cb (GtkCellRendererToggle *cell, gcha
 			    PACKAGES_COLUMN_STATE, &state,
 			    -1);
 
-	/* enforce the selection in case we just fire at the checkbox without selecting */
+	/* enforce the selection in case we just fire at the checkbox without
+	 * selecting, but toggle all of the selection if the row is part of it */
 	selection = gtk_tree_view_get_selection (treeview);
-	gtk_tree_selection_select_iter (selection, &iter);
+	if (!gtk_tree_selection_iter_is_selected (selection, &iter)) {
+		gtk_tree_selection_unselect_all (selection);
+		gtk_tree_selection_select_iter (selection, &iter);
+	}
 
 	if (gpk_application_state_get_checkbox (state)) {
 		gpk_application_remove (priv);
 	} else {
 		gpk_application_install (priv);
 	}
-	gtk_tree_path_free (path);
+	gtk_tree_path_free (path);
+}
+
+static void gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkApplicationPrivate *priv);
+
+static void
+gpk_application_packages_unqueue_row (GpkPackageModel *store, const gchar *package_id)
+{
+	GtkTreeIter iter;
+	PkBitfield state;
+
+	if (!gpk_package_model_lookup (store, package_id, &iter))
+		return;
+	gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, PACKAGES_COLUMN_STATE, &state, -1);
+	pk_bitfield_remove (state, GPK_STATE_IN_LIST);
+	gpk_package_model_set (store, &iter,
+			       PACKAGES_COLUMN_STATE, state,
+			       PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
+			       PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
+			       -1);
+}
+
+static void
+gpk_application_button_clear_cb (GtkWidget *widget_button, GpkApplicationPrivate *priv)
+{
+	GtkTreeView *treeview;
+	GtkTreeSelection *selection;
+	GHashTableIter iter;
+	gpointer key;
+
+	/* only the queued rows need changing */
+	g_hash_table_iter_init (&iter, priv->queue);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		gpk_application_packages_unqueue_row (priv->packages_store, key);
+		if (priv->load_store != NULL)
+			gpk_application_packages_unqueue_row (priv->load_store, key);
+	}
+
+	/* clear queue */
+	g_hash_table_remove_all (priv->queue);
+
+	/* force a button refresh */
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	selection = gtk_tree_view_get_selection (treeview);
+	gpk_application_packages_treeview_clicked_cb (selection, priv);
+	gpk_application_change_queue_status (priv);
+}
+
+static void
+gpk_application_apply_helper_free (GpkApplicationApplyHelper *helper)
+{
+	g_object_unref (helper->cancellable);
+	g_strfreev (helper->install_ids);
+	g_strfreev (helper->remove_ids);
+	g_object_unref (helper->sack);
+	g_ptr_array_unref (helper->changed);
+	if (helper->error_code != NULL)
+		g_object_unref (helper->error_code);
+	g_free (helper);
+}
+
+static void
+gpk_application_packages_patch_row (GpkApplicationPrivate *priv,
+				    GpkPackageModel *store,
+				    const gchar *package_id,
+				    const gchar *package_id_new,
+				    gboolean installed)
+{
+	GtkTreeIter iter;
+	PkBitfield state;
+
+	if (!gpk_package_model_lookup (store, package_id, &iter))
+		return;
+
+	/* the row no longer matches the filter it was searched with */
+	if ((installed && pk_bitfield_contain (priv->filters_current, PK_FILTER_ENUM_NOT_INSTALLED)) ||
+	    (!installed && pk_bitfield_contain (priv->filters_current, PK_FILTER_ENUM_INSTALLED))) {
+		g_debug ("removing filtered result %s", package_id);
+		g_hash_table_remove (priv->search_package_ids, package_id);
+		gpk_package_model_remove (store, &iter);
+		return;
+	}
+
+	/* keep the collection flag, and anything queued while applying */
+	gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, PACKAGES_COLUMN_STATE, &state, -1);
+	pk_bitfield_remove (state, GPK_STATE_INSTALLED);
+	pk_bitfield_remove (state, GPK_STATE_IN_LIST);
+	if (installed)
+		pk_bitfield_add (state, GPK_STATE_INSTALLED);
+	if (g_hash_table_contains (priv->queue, package_id))
+		pk_bitfield_add (state, GPK_STATE_IN_LIST);
+	gpk_package_model_set (store, &iter,
+			       PACKAGES_COLUMN_STATE, state,
+			       PACKAGES_COLUMN_CHECKBOX, gpk_application_state_get_checkbox (state),
+			       PACKAGES_COLUMN_IMAGE, gpk_application_state_get_icon (state),
+			       PACKAGES_COLUMN_ID, package_id_new,
+			       -1);
+}
+
+static void
+gpk_application_packages_patch (GpkApplicationPrivate *priv,
+				const gchar *package_id,
+				const gchar *package_id_new,
+				gboolean installed)
+{
+	gpk_application_packages_patch_row (priv, priv->packages_store, package_id, package_id_new, installed);
+	if (priv->load_store != NULL)
+		gpk_application_packages_patch_row (priv, priv->load_store, package_id, package_id_new, installed);
+
+	/* so a later removal does not send the repo id */
+	if (g_strcmp0 (package_id, package_id_new) != 0 &&
+	    g_hash_table_remove (priv->search_package_ids, package_id))
+		g_hash_table_add (priv->search_package_ids, g_strdup (package_id_new));
+}
+
+static gchar *
+gpk_application_package_id_strip_data (const gchar *package_id)
+{
+	GpkPackageIdView view;
+
+	/* the data changes when installed, e.g. from "fedora" to "installed" */
+	if (!gpk_package_id_view_init (&view, package_id))
+		return g_strdup (package_id);
+	return g_strndup (package_id, view.offset[PK_PACKAGE_ID_DATA]);
+}
+
+static void
+gpk_application_apply_patch_results (GpkApplicationApplyHelper *helper)
+{
+	GpkApplicationPrivate *priv = helper->priv;
+	GHashTableIter iter;
+	PkPackage *item;
+	const gchar *package_id;
+	gpointer value;
+	gboolean installed;
+	guint i;
+	g_autoptr(GHashTable) requested = NULL;
+
+	/* what was asked for, by everything but the data */
+	requested = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	if (helper->removed) {
+		for (i = 0; helper->remove_ids[i] != NULL; i++) {
+			g_hash_table_insert (requested,
+					     gpk_application_package_id_strip_data (helper->remove_ids[i]),
+					     helper->remove_ids[i]);
+		}
+	}
+	if (helper->installed) {
+		for (i = 0; helper->install_ids[i] != NULL; i++) {
+			g_hash_table_insert (requested,
+					     gpk_application_package_id_strip_data (helper->install_ids[i]),
+					     helper->install_ids[i]);
+		}
+	}
+
+	/* the kept results have the old installed state */
+	g_clear_pointer (&priv->search_packages, g_ptr_array_unref);
+
+	/* what the backend says it changed, including any dependencies */
+	for (i = 0; i < helper->changed->len; i++) {
+		g_autofree gchar *key = NULL;
+
+		item = g_ptr_array_index (helper->changed, i);
+		switch (pk_package_get_info (item)) {
+		case PK_INFO_ENUM_INSTALLING:
+		case PK_INFO_ENUM_INSTALLED:
+		case PK_INFO_ENUM_UPDATING:
+		case PK_INFO_ENUM_REINSTALLING:
+		case PK_INFO_ENUM_DOWNGRADING:
+			installed = TRUE;
+			break;
+		case PK_INFO_ENUM_REMOVING:
+		case PK_INFO_ENUM_REMOVED:
+		case PK_INFO_ENUM_OBSOLETING:
+			installed = FALSE;
+			break;
+		default:
+			continue;
+		}
+
+		/* the row shows the id it was searched with */
+		package_id = pk_package_get_id (item);
+		key = gpk_application_package_id_strip_data (package_id);
+		value = g_hash_table_lookup (requested, key);
+		if (value != NULL) {
+			gpk_application_packages_patch (priv, value, package_id, installed);
+			g_hash_table_remove (requested, key);
+			continue;
+		}
+		gpk_application_packages_patch (priv, package_id, package_id, installed);
+	}
+
+	/* anything asked for that the backend did not mention */
+	g_hash_table_iter_init (&iter, requested);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		installed = g_strv_contains ((const gchar * const *) helper->install_ids, value);
+		gpk_application_packages_patch (priv, value, value, installed);
+	}
+	priv->has_package = g_hash_table_size (priv->search_package_ids) > 0;
+}
+
+static void
+gpk_application_apply_add_changed (GpkApplicationApplyHelper *helper, PkResults *results)
+{
+	guint i;
+	g_autoptr(GPtrArray) array = NULL;
+
+	/* the rows to patch once everything has finished */
+	array = pk_results_get_package_array (results);
+	for (i = 0; i < array->len; i++)
+		g_ptr_array_add (helper->changed, g_object_ref (g_ptr_array_index (array, i)));
+}
+
+static gboolean
+gpk_application_apply_check (GpkApplicationApplyHelper *helper, PkResults *results, const GError *error)
+{
+	g_autoptr(PkError) error_code = NULL;
+
+	if (results == NULL) {
+		g_warning ("failed to apply changes: %s", error->message);
+		helper->failed = TRUE;
+		return FALSE;
+	}
+
+	/* check error code, only the first is shown */
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_warning ("failed to apply changes: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		if (helper->error_code == NULL)
+			helper->error_code = g_steal_pointer (&error_code);
+		helper->failed = TRUE;
+		return FALSE;
+	}
+	return TRUE;
 }
 
-static void gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkApplicationPrivate *priv);
-
 static void
-gpk_application_button_clear_cb (GtkWidget *widget_button, GpkApplicationPrivate *priv)
+gpk_application_apply_finish (GpkApplicationApplyHelper *helper)
 {
-	GtkTreeView *treeview;
-	gboolean valid;
-	gboolean checkbox;
-	GtkTreeIter iter;
-	GtkTreeModel *model;
+	GpkApplicationPrivate *priv = helper->priv;
+	GtkWidget *widget;
+	GtkWindow *window;
 	GtkTreeSelection *selection;
-	const gchar *icon;
-	PkBitfield state;
-	gboolean ret;
+	PkError *error_code = helper->error_code;
+	guint i;
 
-	/* get the first iter in the array */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
-	model = gtk_tree_view_get_model (treeview);
-	valid = gtk_tree_model_get_iter_first (model, &iter);
+	/* let the next queued write start */
+	pk_task_set_simulate (priv->task, helper->simulate);
+	gpk_query_scheduler_write_finished (priv->scheduler);
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	gtk_widget_set_sensitive (widget, TRUE);
 
-	/* for all current items, reset the state if in the array */
-	while (valid) {
-		gtk_tree_model_get (model, &iter, PACKAGES_COLUMN_STATE, &state, -1);
-		ret = pk_bitfield_contain (state, GPK_STATE_IN_LIST);
-		if (ret) {
-			pk_bitfield_remove (state, GPK_STATE_IN_LIST);
-			/* get the new icon */
-			icon = gpk_application_state_get_icon (state);
-			checkbox = gpk_application_state_get_checkbox (state);
-
-			/* set new value */
-			gtk_list_store_set (GTK_LIST_STORE (model), &iter,
-					    PACKAGES_COLUMN_STATE, state,
-					    PACKAGES_COLUMN_CHECKBOX, checkbox,
-					    PACKAGES_COLUMN_IMAGE, icon,
-					    -1);
-		}
-		valid = gtk_tree_model_iter_next (model, &iter);
+	/* if obvious message, don't tell the user */
+	if (error_code != NULL &&
+	    pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
+		window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
+		gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
+					gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
 	}
 
-	/* clear queue */
-	pk_package_sack_clear (priv->package_sack);
-
-	/* force a button refresh */
-	selection = gtk_tree_view_get_selection (treeview);
-	gpk_application_packages_treeview_clicked_cb (selection, priv);
-
-	priv->action = GPK_ACTION_NONE;
+	/* only forget what was done, anything queued meanwhile stays */
+	if (helper->removed) {
+		for (i = 0; helper->remove_ids[i] != NULL; i++)
+			g_hash_table_remove (priv->queue, helper->remove_ids[i]);
+	}
+	if (helper->installed) {
+		for (i = 0; helper->install_ids[i] != NULL; i++)
+			g_hash_table_remove (priv->queue, helper->install_ids[i]);
+	}
 	gpk_application_change_queue_status (priv);
+
+	/* only the changed rows are updated, so the scroll position and
+	 * selection are kept rather than running the search again */
+	if (helper->removed || helper->installed) {
+		gpk_application_search_cache_invalidate (priv, "packages were changed");
+		gpk_application_details_cache_invalidate (priv, "packages were changed");
+		gpk_application_name_index_invalidate (priv, "packages were changed");
+		gpk_application_apply_patch_results (helper);
+
+		/* the buttons and details depend on the installed state */
+		selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (widget));
+		gpk_application_packages_treeview_clicked_cb (selection, priv);
+	}
+	gpk_application_apply_helper_free (helper);
 }
 
 static void
-gpk_application_install_packages_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_apply_install_cb (PkTask *task, GAsyncResult *res, GpkApplicationApplyHelper *helper)
 {
-	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(PkError) error_code = NULL;
-	GtkWindow *window;
-	guint idle_id;
+	g_autoptr(PkResults) results = NULL;
 
-	/* get the results */
 	results = pk_task_generic_finish (task, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to install packages: %s", error->message);
-		return;
-	}
+	helper->installed = gpk_application_apply_check (helper, results, error);
+	if (helper->installed)
+		gpk_application_apply_add_changed (helper, results);
+	gpk_application_apply_finish (helper);
+}
 
-	/* check error code */
-	error_code = pk_results_get_error_code (results);
-	if (error_code != NULL) {
-		g_warning ("failed to install packages: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+static void
+gpk_application_apply_install (GpkApplicationApplyHelper *helper)
+{
+	GpkApplicationPrivate *priv = helper->priv;
 
-		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
-			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-		}
+	/* not simulated with the removals, as it may only resolve once they
+	 * are done, so let the task ask about dependencies now */
+	if (helper->remove_ids[0] != NULL)
+		pk_task_set_simulate (priv->task, helper->simulate);
+
+	/* anything downloaded already comes from the cache */
+	pk_task_install_packages_async (priv->task, helper->install_ids, helper->cancellable,
+					(PkProgressCallback) gpk_application_progress_cb, priv,
+					(GAsyncReadyCallback) gpk_application_apply_install_cb, helper);
+}
+
+static void
+gpk_application_apply_prepared (GpkApplicationApplyHelper *helper)
+{
+	if (--helper->pending > 0)
+		return;
+	if (helper->failed || helper->install_ids[0] == NULL) {
+		gpk_application_apply_finish (helper);
 		return;
 	}
+	gpk_application_apply_install (helper);
+}
 
-	/* idle add in the background */
-	idle_id = g_idle_add ((GSourceFunc) gpk_application_perform_search_idle_cb, priv);
-	g_source_set_name_by_id (idle_id, "[GpkApplication] search");
+static void
+gpk_application_apply_remove_cb (PkTask *task, GAsyncResult *res, GpkApplicationApplyHelper *helper)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkResults) results = NULL;
 
-	/* clear if success */
-	pk_package_sack_clear (priv->package_sack);
-	priv->action = GPK_ACTION_NONE;
-	gpk_application_change_queue_status (priv);
+	results = pk_task_generic_finish (task, res, &error);
+	helper->removed = gpk_application_apply_check (helper, results, error);
+	if (helper->removed)
+		gpk_application_apply_add_changed (helper, results);
+	gpk_application_apply_prepared (helper);
 }
 
 static void
-gpk_application_remove_packages_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_apply_download_cb (PkTask *task, GAsyncResult *res, GpkApplicationApplyHelper *helper)
 {
-	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(PkError) error_code = NULL;
-	GtkWindow *window;
-	guint idle_id;
+	g_autoptr(PkResults) results = NULL;
 
-	/* get the results */
+	/* not fatal, e.g. the new packages may conflict with the ones
+	 * still being removed, so the install downloads them instead */
 	results = pk_task_generic_finish (task, res, &error);
-	if (results == NULL) {
-		g_warning ("failed to remove packages: %s", error->message);
-		return;
-	}
+	if (results == NULL)
+		g_debug ("failed to download ahead: %s", error->message);
+	gpk_application_apply_prepared (helper);
+}
 
-	/* check error code */
-	error_code = pk_results_get_error_code (results);
-	if (error_code != NULL) {
-		g_warning ("failed to remove packages: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+static void
+gpk_application_apply_prepare (GpkApplicationApplyHelper *helper)
+{
+	GpkApplicationPrivate *priv = helper->priv;
+	gboolean autoremove;
 
-		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
-			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
-			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-		}
+	/* already confirmed, so don't ask again for each transaction */
+	pk_task_set_simulate (priv->task, FALSE);
+
+	/* nothing to overlap the installs with */
+	if (helper->remove_ids[0] == NULL) {
+		gpk_application_apply_install (helper);
 		return;
 	}
 
-	/* idle add in the background */
-	idle_id = g_idle_add ((GSourceFunc) gpk_application_perform_search_idle_cb, priv);
-	g_source_set_name_by_id (idle_id, "[GpkApplication] search");
-
-	/* clear if success */
-	pk_package_sack_clear (priv->package_sack);
-	priv->action = GPK_ACTION_NONE;
-	gpk_application_change_queue_status (priv);
+	/* downloading does not have to wait for the removals */
+	autoremove = g_settings_get_boolean (priv->settings, GPK_SETTINGS_ENABLE_AUTOREMOVE);
+	helper->pending++;
+	pk_task_remove_packages_async (priv->task, helper->remove_ids, TRUE, autoremove,
+				       helper->cancellable,
+				       (PkProgressCallback) gpk_application_progress_cb, priv,
+				       (GAsyncReadyCallback) gpk_application_apply_remove_cb, helper);
+	if (helper->install_ids[0] != NULL) {
+		helper->pending++;
+		pk_task_install_packages_async (priv->download_task, helper->install_ids,
+						helper->cancellable,
+						(PkProgressCallback) gpk_application_progress_cb, priv,
+						(GAsyncReadyCallback) gpk_application_apply_download_cb, helper);
+	}
 }
 
 static void
-gpk_application_button_apply_cb (GtkWidget *widget, GpkApplicationPrivate *priv)
+gpk_application_apply_simulate_cb (PkClient *client, GAsyncResult *res, GpkApplicationApplyHelper *helper)
 {
-	g_auto(GStrv) package_ids = NULL;
-	gboolean autoremove;
-
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
+	GpkApplicationPrivate *priv = helper->priv;
+	guint i;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(PkResults) results = NULL;
 
-	package_ids = pk_package_sack_get_ids (priv->package_sack);
-	if (priv->action == GPK_ACTION_INSTALL) {
-		/* install */
-		pk_task_install_packages_async (priv->task, package_ids, priv->cancellable,
-						(PkProgressCallback) gpk_application_progress_cb, priv,
-						(GAsyncReadyCallback) gpk_application_install_packages_cb, priv);
+	results = pk_client_generic_finish (client, res, &error);
+	if (gpk_application_apply_check (helper, results, error)) {
+		array = pk_results_get_package_array (results);
+		for (i = 0; i < array->len; i++)
+			pk_package_sack_add_package (helper->sack, g_ptr_array_index (array, i));
+	}
+	if (--helper->pending > 0)
+		return;
+	if (helper->failed) {
+		gpk_application_apply_finish (helper);
+		return;
+	}
 
-		/* make package array insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
-		gtk_widget_set_sensitive (widget, FALSE);
+	/* one summary for everything that was simulated */
+	if (!gpk_task_confirm_changes (GPK_TASK (priv->task), helper->sack,
+				       helper->remove_ids[0] != NULL ? helper->remove_ids : helper->install_ids,
+				       helper->remove_ids[0] != NULL)) {
+		g_debug ("changes declined");
+		helper->failed = TRUE;
+		gpk_application_apply_finish (helper);
+		return;
+	}
+	gpk_application_apply_prepare (helper);
+}
 
-		/* make apply button insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
-		gtk_widget_set_visible (widget, FALSE);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
-		gtk_widget_set_visible (widget, FALSE);
+static void
+gpk_application_apply_write_cb (GpkQueryScheduler *scheduler,
+				GCancellable *cancellable,
+				GpkApplicationPrivate *priv)
+{
+	GpkApplicationApplyHelper *helper;
+	GHashTableIter iter;
+	GPtrArray *install_ids;
+	GPtrArray *remove_ids;
+	gpointer key;
+	gpointer package;
+	gboolean autoremove;
 
-	} else if (priv->action == GPK_ACTION_REMOVE) {
+	/* split the queue, the installs may need what is being removed */
+	install_ids = g_ptr_array_new ();
+	remove_ids = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, priv->queue);
+	while (g_hash_table_iter_next (&iter, &key, &package)) {
+		if (pk_package_get_info (package) == PK_INFO_ENUM_INSTALLED)
+			g_ptr_array_add (remove_ids, g_strdup (key));
+		else
+			g_ptr_array_add (install_ids, g_strdup (key));
+	}
+	g_ptr_array_add (install_ids, NULL);
+	g_ptr_array_add (remove_ids, NULL);
+
+	/* the helper is freed when the last transaction finishes */
+	helper = g_new0 (GpkApplicationApplyHelper, 1);
+	helper->priv = priv;
+	helper->cancellable = g_object_ref (cancellable);
+	helper->install_ids = (gchar **) g_ptr_array_free (install_ids, FALSE);
+	helper->remove_ids = (gchar **) g_ptr_array_free (remove_ids, FALSE);
+	helper->sack = pk_package_sack_new ();
+	helper->changed = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	helper->simulate = pk_task_get_simulate (priv->task);
+	g_debug ("applying %u installs and %u removals",
+		 g_strv_length (helper->install_ids),
+		 g_strv_length (helper->remove_ids));
+
+	/* simulate before anything is changed; an install that replaces what
+	 * is being removed would conflict with the current system, so it is
+	 * only simulated when nothing is removed first */
+	if (helper->install_ids[0] != NULL && helper->remove_ids[0] == NULL) {
+		helper->pending++;
+		pk_client_install_packages_async (PK_CLIENT (priv->task),
+						  pk_bitfield_value (PK_TRANSACTION_FLAG_ENUM_SIMULATE),
+						  helper->install_ids, cancellable,
+						  (PkProgressCallback) gpk_application_progress_cb, priv,
+						  (GAsyncReadyCallback) gpk_application_apply_simulate_cb, helper);
+	}
+	if (helper->remove_ids[0] != NULL) {
 		autoremove = g_settings_get_boolean (priv->settings, GPK_SETTINGS_ENABLE_AUTOREMOVE);
+		helper->pending++;
+		pk_client_remove_packages_async (PK_CLIENT (priv->task),
+						 pk_bitfield_value (PK_TRANSACTION_FLAG_ENUM_SIMULATE),
+						 helper->remove_ids, TRUE, autoremove, cancellable,
+						 (PkProgressCallback) gpk_application_progress_cb, priv,
+						 (GAsyncReadyCallback) gpk_application_apply_simulate_cb, helper);
+	}
+	if (helper->pending == 0) {
+		helper->failed = TRUE;
+		gpk_application_apply_finish (helper);
+	}
+}
 
-		/* remove */
-		pk_task_remove_packages_async (priv->task, package_ids, TRUE, autoremove, priv->cancellable,
-					       (PkProgressCallback) gpk_application_progress_cb, priv,
-					       (GAsyncReadyCallback) gpk_application_remove_packages_cb, priv);
+static void
+gpk_application_button_apply_cb (GtkWidget *widget, GpkApplicationPrivate *priv)
+{
+	/* installs and removals go together */
+	gpk_query_scheduler_write (priv->scheduler,
+				   (GpkQueryWriteFunc) gpk_application_apply_write_cb,
+				   priv);
 
-		/* make package array insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
-		gtk_widget_set_sensitive (widget, FALSE);
+	/* make package array insensitive */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	gtk_widget_set_sensitive (widget, FALSE);
 
-		/* make apply button insensitive */
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
-		gtk_widget_set_visible (widget, FALSE);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
-		gtk_widget_set_visible (widget, FALSE);
-	}
+	/* make apply button insensitive */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_apply"));
+	gtk_widget_set_visible (widget, FALSE);
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_clear"));
+	gtk_widget_set_visible (widget, FALSE);
 }
 
 static void
@@ -1787,19 +3034,16 @@ gpk_application_groups_treeview_changed_cb (GtkTreeSelection *selection, GpkAppl
 }
 
 static void
-gpk_application_get_details_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_show_details (GpkApplicationPrivate *priv, PkDetails *item)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(PkError) error_code = NULL;
-	g_autoptr(GPtrArray) array = NULL;
-	PkDetails *item;
 	GtkWidget *widget;
 	gchar *value;
 	const gchar *repo_name;
+	const gchar *data;
 	gboolean installed;
-	g_auto(GStrv) split = NULL;
-	GtkWindow *window;
+	gsize data_len;
+	GpkPackageIdView view;
+	g_autofree gchar *data_id = NULL;
 	g_autofree gchar *package_id = NULL;
 	g_autofree gchar *url = NULL;
 	PkGroupEnum group;
@@ -1807,10 +3051,118 @@ gpk_application_get_details_cb (PkTask *task, GAsyncResult *res, GpkApplicationP
 	g_autofree gchar *description = NULL;
 	guint64 size;
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
+	/* show to start */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "grid_details"));
+	gtk_widget_show (widget);
+
+	/* get data */
+	g_object_get (item,
+		      "package-id", &package_id,
+		      "url", &url,
+		      "group", &group,
+		      "license", &license,
+		      "description", &description,
+		      "size", &size,
+		      NULL);
+
+	if (!gpk_package_id_view_init (&view, package_id)) {
+		g_warning ("could not parse %s", package_id);
+		return;
+	}
+	data = gpk_package_id_view_get (&view, PK_PACKAGE_ID_DATA, &data_len);
+	installed = data_len >= 9 && strncmp (data, "installed", 9) == 0;
+
+	/* homepage */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_homepage"));
+	g_free (priv->homepage_url);
+	priv->homepage_url = g_strdup (url);
+	gtk_widget_set_visible (widget, url != NULL);
+
+	/* licence */
+	if (license != NULL) {
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence_title"));
+		gtk_widget_show (widget);
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence"));
+		gtk_label_set_label (GTK_LABEL (widget), license);
+		gtk_label_set_line_wrap (GTK_LABEL (widget), TRUE);
+		gtk_widget_show (widget);
+	} else {
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence_title"));
+		gtk_widget_hide (widget);
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence"));
+		gtk_widget_hide (widget);
+	}
+
+	/* set the description */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "textview_description"));
+	gpk_application_set_text_buffer (widget, description);
+
+	/* if non-zero, set the size */
+	if (size > 0) {
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size_title"));
+		/* set the size */
+		if (gpk_package_id_view_equal (&view, PK_PACKAGE_ID_DATA, "meta")) {
+			/* TRANSLATORS: the size of the meta package */
+			gtk_label_set_label (GTK_LABEL (widget), _("Size"));
+		} else if (installed) {
+			/* TRANSLATORS: the installed size in bytes of the package */
+			gtk_label_set_label (GTK_LABEL (widget), _("Installed size"));
+		} else {
+			/* TRANSLATORS: the download size of the package */
+			gtk_label_set_label (GTK_LABEL (widget), _("Download size"));
+		}
+		gtk_widget_show (widget);
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size"));
+		value = g_format_size (size);
+		gtk_label_set_label (GTK_LABEL (widget), value);
+		gtk_widget_show (widget);
+		g_free (value);
+	} else {
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size_title"));
+		gtk_widget_hide (widget);
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size"));
+		gtk_widget_hide (widget);
+	}
+
+	/* set the repo text */
+	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_source"));
+	/* get the full name of the repo from the repo_id */
+	data_id = gpk_package_id_view_dup (&view, PK_PACKAGE_ID_DATA);
+	repo_name = gpk_application_get_full_repo_name (priv, data_id);
+	gtk_label_set_label (GTK_LABEL (widget), repo_name);
+}
+
+static void
+gpk_application_details_helper_free (GpkApplicationDetailsHelper *helper)
+{
+	g_strfreev (helper->package_ids);
+	g_free (helper);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (GpkApplicationDetailsHelper, gpk_application_details_helper_free)
+
+static void
+gpk_application_get_details_cb (GpkQueryScheduler *scheduler, PkResults *results,
+				const GError *error, gpointer user_data)
+{
+	g_autoptr(GpkApplicationDetailsHelper) helper = user_data;
+	GpkApplicationPrivate *priv = helper->priv;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	PkDetails *item;
+	GtkWindow *window;
+	gboolean has_selected;
+	guint i;
+
+	/* these can be asked for again */
+	for (i = 0; helper->package_ids[i] != NULL; i++)
+		g_hash_table_remove (priv->details_pending, helper->package_ids[i]);
+	has_selected = priv->details_package_id != NULL &&
+		       g_strv_contains ((const gchar * const *) helper->package_ids,
+					priv->details_package_id);
+
 	if (results == NULL) {
-		g_warning ("failed to get list of categories: %s", error->message);
+		g_warning ("failed to get details: %s", error->message);
 		return;
 	}
 
@@ -1820,7 +3172,8 @@ gpk_application_get_details_cb (PkTask *task, GAsyncResult *res, GpkApplicationP
 		g_warning ("failed to get details: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
 
 		/* if obvious message, don't tell the user */
-		if (pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
+		if (has_selected &&
+		    pk_error_get_code (error_code) != PK_ERROR_ENUM_TRANSACTION_CANCELLED) {
 			window = GTK_WINDOW (gtk_builder_get_object (priv->builder, "window_manager"));
 			gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
 						gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
@@ -1828,90 +3181,122 @@ gpk_application_get_details_cb (PkTask *task, GAsyncResult *res, GpkApplicationP
 		return;
 	}
 
-	/* get data */
+	/* keep everything, the user is probably moving towards it */
 	array = pk_results_get_details_array (results);
-	if (array->len != 1) {
-		g_warning ("not one entry %u", array->len);
-		return;
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		if (pk_details_get_package_id (item) == NULL)
+			continue;
+		gpk_application_details_cache_add (priv, item);
+		gpk_details_index_add_details (priv->details_index, item);
 	}
+	g_debug ("got details for %u packages", array->len);
 
-	/* only choose the first item */
-	item = g_ptr_array_index (array, 0);
-
-	/* show to start */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "grid_details"));
-	gtk_widget_show (widget);
+	/* the selection may have moved on since */
+	if (!has_selected)
+		return;
+	item = gpk_application_details_cache_lookup (priv, priv->details_package_id);
+	if (item == NULL) {
+		g_warning ("no details for %s", priv->details_package_id);
+		return;
+	}
+	gpk_application_show_details (priv, item);
+}
 
-	/* get data */
-	g_object_get (item,
-		      "package-id", &package_id,
-		      "url", &url,
-		      "group", &group,
-		      "license", &license,
-		      "description", &description,
-		      "size", &size,
-		      NULL);
+static void
+gpk_application_details_fetch_add (GpkApplicationPrivate *priv,
+				   GPtrArray *package_ids,
+				   GtkTreeModel *model,
+				   GtkTreeIter *iter)
+{
+	g_autofree gchar *package_id = NULL;
 
-	split = pk_package_id_split (package_id);
-	installed = g_str_has_prefix (split[PK_PACKAGE_ID_DATA], "installed");
+	if (package_ids->len >= GPK_APPLICATION_DETAILS_BATCH_SIZE)
+		return;
 
-	/* homepage */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "button_homepage"));
-	g_free (priv->homepage_url);
-	priv->homepage_url = g_strdup (url);
-	gtk_widget_set_visible (widget, url != NULL);
+	/* help rows have no package-id */
+	gtk_tree_model_get (model, iter,
+			    PACKAGES_COLUMN_ID, &package_id,
+			    -1);
+	if (package_id == NULL)
+		return;
+	if (g_hash_table_contains (priv->details_cache_index, package_id) ||
+	    g_hash_table_contains (priv->details_pending, package_id))
+		return;
+	g_hash_table_add (priv->details_pending, g_strdup (package_id));
+	g_ptr_array_add (package_ids, g_steal_pointer (&package_id));
+}
 
-	/* licence */
-	if (license != NULL) {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence_title"));
-		gtk_widget_show (widget);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence"));
-		gtk_label_set_label (GTK_LABEL (widget), license);
-		gtk_label_set_line_wrap (GTK_LABEL (widget), TRUE);
-		gtk_widget_show (widget);
-	} else {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence_title"));
-		gtk_widget_hide (widget);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_licence"));
-		gtk_widget_hide (widget);
+static void
+gpk_application_details_fetch_add_range (GpkApplicationPrivate *priv,
+					 GPtrArray *package_ids,
+					 GtkTreeModel *model,
+					 gint start,
+					 gint end)
+{
+	GtkTreeIter iter;
+	gint i;
+
+	for (i = MAX (start, 0); i <= end; i++) {
+		if (!gtk_tree_model_iter_nth_child (model, &iter, NULL, i))
+			break;
+		gpk_application_details_fetch_add (priv, package_ids, model, &iter);
 	}
+}
 
-	/* set the description */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "textview_description"));
-	gpk_application_set_text_buffer (widget, description);
+static gboolean
+gpk_application_details_fetch_cb (GpkApplicationPrivate *priv)
+{
+	GpkApplicationDetailsHelper *helper;
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	GtkTreeView *treeview;
+	GPtrArray *package_ids;
+	GtkTreePath *path_start = NULL;
+	GtkTreePath *path_end = NULL;
+	gint idx;
 
-	/* if non-zero, set the size */
-	if (size > 0) {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size_title"));
-		/* set the size */
-		if (g_strcmp0 (split[PK_PACKAGE_ID_DATA], "meta") == 0) {
-			/* TRANSLATORS: the size of the meta package */
-			gtk_label_set_label (GTK_LABEL (widget), _("Size"));
-		} else if (installed) {
-			/* TRANSLATORS: the installed size in bytes of the package */
-			gtk_label_set_label (GTK_LABEL (widget), _("Installed size"));
-		} else {
-			/* TRANSLATORS: the download size of the package */
-			gtk_label_set_label (GTK_LABEL (widget), _("Download size"));
-		}
-		gtk_widget_show (widget);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size"));
-		value = g_format_size (size);
-		gtk_label_set_label (GTK_LABEL (widget), value);
-		gtk_widget_show (widget);
-		g_free (value);
+	priv->details_fetch_id = 0;
+
+	/* the selection first so it never misses out */
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_packages"));
+	if (gpk_application_get_selected_iter (priv, &model, &iter)) {
+		g_autoptr(GtkTreePath) path = gtk_tree_model_get_path (model, &iter);
+		gpk_application_details_fetch_add (priv, package_ids, model, &iter);
+
+		/* then the rows either side, which arrowing will reach next */
+		idx = gtk_tree_path_get_indices (path)[0];
+		gpk_application_details_fetch_add_range (priv, package_ids, model,
+							 idx - GPK_APPLICATION_DETAILS_PREFETCH_ROWS,
+							 idx + GPK_APPLICATION_DETAILS_PREFETCH_ROWS);
 	} else {
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size_title"));
-		gtk_widget_hide (widget);
-		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_size"));
-		gtk_widget_hide (widget);
+		model = gtk_tree_view_get_model (treeview);
 	}
 
-	/* set the repo text */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "label_source"));
-	/* get the full name of the repo from the repo_id */
-	repo_name = gpk_application_get_full_repo_name (priv, split[PK_PACKAGE_ID_DATA]);
-	gtk_label_set_label (GTK_LABEL (widget), repo_name);
+	/* then anything else the user can see */
+	if (gtk_tree_view_get_visible_range (treeview, &path_start, &path_end)) {
+		gpk_application_details_fetch_add_range (priv, package_ids, model,
+							 gtk_tree_path_get_indices (path_start)[0],
+							 gtk_tree_path_get_indices (path_end)[0]);
+		gtk_tree_path_free (path_start);
+		gtk_tree_path_free (path_end);
+	}
+	if (package_ids->len == 0) {
+		g_ptr_array_unref (package_ids);
+		return G_SOURCE_REMOVE;
+	}
+
+	/* one transaction for the lot, the helper is freed in the callback */
+	g_debug ("getting details for %u packages", package_ids->len);
+	g_ptr_array_add (package_ids, NULL);
+	helper = g_new0 (GpkApplicationDetailsHelper, 1);
+	helper->priv = priv;
+	helper->package_ids = (gchar **) g_ptr_array_free (package_ids, FALSE);
+	gpk_query_scheduler_query (priv->scheduler, GPK_QUERY_KIND_DETAILS, helper->package_ids,
+				   (PkProgressCallback) gpk_application_progress_cb, priv,
+				   gpk_application_get_details_cb, helper);
+	return G_SOURCE_REMOVE;
 }
 
 static void
@@ -1923,7 +3308,7 @@ gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkAp
 	gboolean show_install = TRUE;
 	gboolean show_remove = TRUE;
 	PkBitfield state;
-	g_auto(GStrv) package_ids = NULL;
+	PkDetails *details;
 	g_autofree gchar *package_id = NULL;
 	g_autofree gchar *summary = NULL;
 
@@ -1931,9 +3316,10 @@ gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkAp
 	if (!priv->has_package)
 		return;
 
-	/* This will only work in single or browse selection mode! */
-	if (!gtk_tree_selection_get_selected (selection, &model, &iter)) {
+	/* details are shown for the row with the cursor */
+	if (!gpk_application_get_selected_iter (priv, &model, &iter)) {
 		g_debug ("no row selected");
+		g_clear_pointer (&priv->details_package_id, g_free);
 
 		/* we cannot now add it */
 		gpk_application_allow_install (priv, FALSE);
@@ -1954,6 +3340,7 @@ gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkAp
 			    -1);
 	if (package_id == NULL) {
 		g_debug ("ignoring help click");
+		g_clear_pointer (&priv->details_package_id, g_free);
 		return;
 	}
 
@@ -1966,27 +3353,29 @@ gpk_application_packages_treeview_clicked_cb (GtkTreeSelection *selection, GpkAp
 	show_remove = (state == pk_bitfield_value (GPK_STATE_INSTALLED) ||
 		       state == pk_bitfield_value (GPK_STATE_IN_LIST));
 
-	if (priv->action == GPK_ACTION_INSTALL && !pk_bitfield_contain (state, GPK_STATE_IN_LIST))
-		show_remove = FALSE;
-	if (priv->action == GPK_ACTION_REMOVE && !pk_bitfield_contain (state, GPK_STATE_IN_LIST))
-		show_install = FALSE;
-
 	/* only show buttons if we are in the correct mode */
 	gpk_application_allow_install (priv, show_install);
 	gpk_application_allow_remove (priv, show_remove);
 
-	/* clear the description text */
-	widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "textview_description"));
-	gpk_application_set_text_buffer (widget, NULL);
-
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
+	/* show straight away if we already have it */
+	g_free (priv->details_package_id);
+	priv->details_package_id = g_strdup (package_id);
+	details = gpk_application_details_cache_lookup (priv, package_id);
+	if (details != NULL) {
+		gpk_application_show_details (priv, details);
+	} else {
+		/* clear the description text */
+		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "textview_description"));
+		gpk_application_set_text_buffer (widget, NULL);
+	}
 
-	/* get the details */
-	package_ids = pk_package_ids_from_id (package_id);
-	pk_task_get_details_async (PK_TASK(priv->task), package_ids, priv->cancellable,
-				     (PkProgressCallback) gpk_application_progress_cb, priv,
-				     (GAsyncReadyCallback) gpk_application_get_details_cb, priv);
+	/* only fetch once the selection has stopped moving */
+	if (priv->details_fetch_id > 0)
+		g_source_remove (priv->details_fetch_id);
+	priv->details_fetch_id = g_timeout_add (GPK_APPLICATION_DETAILS_DELAY,
+						(GSourceFunc) gpk_application_details_fetch_cb,
+						priv);
+	g_source_set_name_by_id (priv->details_fetch_id, "[GpkApplication] details fetch");
 }
 
 static void
@@ -2001,6 +3390,84 @@ gpk_application_notify_network_state_cb (PkControl *_control, GParamSpec *pspec,
 	g_debug ("state=%u", state);
 }
 
+static void
+gpk_application_updates_changed_cb (PkControl *_control, GpkApplicationPrivate *priv)
+{
+	gpk_application_search_cache_invalidate (priv, "updates changed");
+	gpk_application_details_cache_invalidate (priv, "updates changed");
+	gpk_application_name_index_invalidate (priv, "updates changed");
+}
+
+static void
+gpk_application_repo_list_changed_cb (PkControl *_control, GpkApplicationPrivate *priv)
+{
+	gpk_application_search_cache_invalidate (priv, "the repo list changed");
+	gpk_application_details_cache_invalidate (priv, "the repo list changed");
+	gpk_application_name_index_invalidate (priv, "the repo list changed");
+}
+
+static const PkRoleEnum gpk_application_name_index_roles[] = {
+	PK_ROLE_ENUM_REFRESH_CACHE,
+	PK_ROLE_ENUM_INSTALL_PACKAGES,
+	PK_ROLE_ENUM_REMOVE_PACKAGES,
+	PK_ROLE_ENUM_UPDATE_PACKAGES,
+};
+
+static void
+gpk_application_name_index_time_since_cb (PkControl *control, GAsyncResult *res, GpkApplicationPrivate *priv)
+{
+	guint seconds;
+	gint64 changed;
+	g_autoptr(GError) error = NULL;
+
+	/* the most recent of the actions that change the package list */
+	seconds = pk_control_get_time_since_action_finish (control, res, &error);
+	if (error != NULL) {
+		/* assume the worst, which also covers being cancelled by a rebuild */
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to get time since action: %s", error->message);
+		seconds = 0;
+		g_clear_error (&error);
+	}
+	priv->name_index_changed = MIN (priv->name_index_changed, seconds);
+	if (--priv->name_index_pending > 0)
+		return;
+
+	/* first run, or the format changed */
+	if (!gpk_name_index_load (priv->name_index, &error)) {
+		g_debug ("failed to load name index: %s", error->message);
+		gpk_application_name_index_invalidate (priv, "there is no usable index");
+		return;
+	}
+	changed = g_get_real_time () / G_USEC_PER_SEC - priv->name_index_changed;
+	if (gpk_name_index_get_built (priv->name_index) < changed) {
+		gpk_application_name_index_invalidate (priv, "packages changed since it was built");
+		return;
+	}
+	if (!gpk_name_index_is_valid (priv->name_index, gpk_application_get_filters_backend (priv))) {
+		gpk_application_name_index_invalidate (priv, "it was built with other filters");
+		return;
+	}
+	gpk_application_details_index_fill (priv);
+}
+
+static void
+gpk_application_name_index_check (GpkApplicationPrivate *priv)
+{
+	guint i;
+
+	/* only load the index if nothing has happened since it was written */
+	priv->name_index_changed = G_MAXUINT;
+	priv->name_index_pending = G_N_ELEMENTS (gpk_application_name_index_roles);
+	for (i = 0; i < G_N_ELEMENTS (gpk_application_name_index_roles); i++) {
+		pk_control_get_time_since_action_async (priv->control,
+							gpk_application_name_index_roles[i],
+							priv->name_index_cancellable,
+							(GAsyncReadyCallback) gpk_application_name_index_time_since_cb,
+							priv);
+	}
+}
+
 static void
 gpk_application_group_add_data (GpkApplicationPrivate *priv, PkGroupEnum group)
 {
@@ -2243,6 +3710,9 @@ gpk_application_refresh_cache_cb (PkTask *task, GAsyncResult *res, GpkApplicatio
 	g_autoptr(PkError) error_code = NULL;
 	GtkWindow *window;
 
+	/* let the next queued write start */
+	gpk_query_scheduler_write_finished (priv->scheduler);
+
 	/* get the results */
 	results = pk_task_generic_finish (task, res, &error);
 	if (results == NULL) {
@@ -2265,6 +3735,16 @@ gpk_application_refresh_cache_cb (PkTask *task, GAsyncResult *res, GpkApplicatio
 	}
 }
 
+static void
+gpk_application_refresh_write_cb (GpkQueryScheduler *scheduler,
+				  GCancellable *cancellable,
+				  GpkApplicationPrivate *priv)
+{
+	pk_task_refresh_cache_async (priv->task, TRUE, cancellable,
+				     (PkProgressCallback) gpk_application_progress_cb, priv,
+				     (GAsyncReadyCallback) gpk_application_refresh_cache_cb, priv);
+}
+
 static void
 gpk_application_activate_refresh_cb (GSimpleAction *action,
 				     GVariant *parameter,
@@ -2272,12 +3752,10 @@ gpk_application_activate_refresh_cb (GSimpleAction *action,
 {
 	GpkApplicationPrivate *priv = user_data;
 
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
-
-	pk_task_refresh_cache_async (priv->task, TRUE, priv->cancellable,
-				     (PkProgressCallback) gpk_application_progress_cb, priv,
-				     (GAsyncReadyCallback) gpk_application_refresh_cache_cb, priv);
+	/* waits for any install or remove to finish */
+	gpk_query_scheduler_write (priv->scheduler,
+				   (GpkQueryWriteFunc) gpk_application_refresh_write_cb,
+				   priv);
 }
 
 static void
@@ -2327,13 +3805,11 @@ gpk_application_group_row_separator_func (GtkTreeModel *model, GtkTreeIter *iter
 static void
 gpk_application_add_welcome (GpkApplicationPrivate *priv)
 {
-	GtkTreeIter iter;
 	const gchar *welcome;
 	PkBitfield state = 0;
 
 	g_debug ("CLEAR welcome");
 	gpk_application_clear_packages (priv);
-	gtk_list_store_append (priv->packages_store, &iter);
 
 	/* enter something nice */
 	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_SEARCH_GROUP)) {
@@ -2343,15 +3819,15 @@ gpk_application_add_welcome (GpkApplicationPrivate *priv)
 		/* TRANSLATORS: welcome text if we have to search by name */
 		welcome = _("Enter a search word to get started.");
 	}
-	gtk_list_store_set (priv->packages_store, &iter,
-			    PACKAGES_COLUMN_STATE, state,
-			    PACKAGES_COLUMN_CHECKBOX, FALSE,
-			    PACKAGES_COLUMN_CHECKBOX_VISIBLE, FALSE,
-			    PACKAGES_COLUMN_TEXT, welcome,
-			    PACKAGES_COLUMN_IMAGE, "system-search",
-			    PACKAGES_COLUMN_SUMMARY, NULL,
-			    PACKAGES_COLUMN_ID, NULL,
-			    -1);
+	gpk_package_model_insert_with_values (priv->packages_store, NULL,
+					      PACKAGES_COLUMN_STATE, state,
+					      PACKAGES_COLUMN_CHECKBOX, FALSE,
+					      PACKAGES_COLUMN_CHECKBOX_VISIBLE, FALSE,
+					      PACKAGES_COLUMN_TEXT, welcome,
+					      PACKAGES_COLUMN_IMAGE, "system-search",
+					      PACKAGES_COLUMN_SUMMARY, NULL,
+					      PACKAGES_COLUMN_ID, NULL,
+					      -1);
 }
 
 static void
@@ -2376,23 +3852,239 @@ gpk_application_create_group_array_enum (GpkApplicationPrivate *priv)
 	}
 }
 
+static gchar *
+gpk_application_categories_get_filename (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "gnome-packagekit",
+				 "application-categories.cache",
+				 NULL);
+}
+
+static GVariant *
+gpk_application_categories_load (GError **error)
+{
+	gchar *data = NULL;
+	gsize len = 0;
+	guint32 version;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) categories = NULL;
+
+	filename = gpk_application_categories_get_filename ();
+	if (!g_file_get_contents (filename, &data, &len, error))
+		return NULL;
+	bytes = g_bytes_new_take (data, len);
+	categories = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GPK_APPLICATION_CATEGORIES_TYPE),
+								   bytes, FALSE));
+	g_variant_get_child (categories, 0, "u", &version);
+	if (version != GPK_APPLICATION_CATEGORIES_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "cache version %u is not supported", version);
+		return NULL;
+	}
+	return g_steal_pointer (&categories);
+}
+
+static gboolean
+gpk_application_categories_save (GVariant *categories, GError **error)
+{
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *filename = NULL;
+
+	filename = gpk_application_categories_get_filename ();
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+			     "failed to create %s: %s", dirname, g_strerror (errno));
+		return FALSE;
+	}
+	return g_file_set_contents (filename,
+				    g_variant_get_data (categories),
+				    g_variant_get_size (categories),
+				    error);
+}
+
+static GVariant *
+gpk_application_categories_to_variant (GPtrArray *array)
+{
+	GVariantBuilder builder;
+	PkCategory *item;
+	guint i;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sssss)"));
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		if (pk_category_get_id (item) == NULL)
+			continue;
+		g_variant_builder_add (&builder, "(sssss)",
+				       pk_category_get_parent_id (item) != NULL ? pk_category_get_parent_id (item) : "",
+				       pk_category_get_id (item),
+				       pk_category_get_name (item) != NULL ? pk_category_get_name (item) : "",
+				       pk_category_get_summary (item) != NULL ? pk_category_get_summary (item) : "",
+				       pk_category_get_icon (item) != NULL ? pk_category_get_icon (item) : "");
+	}
+	return g_variant_ref_sink (g_variant_new ("(u@a(sssss))",
+						  (guint32) GPK_APPLICATION_CATEGORIES_VERSION,
+						  g_variant_builder_end (&builder)));
+}
+
+static void
+gpk_application_categories_insert (GpkApplicationPrivate *priv,
+				   GVariant *entries,
+				   guint idx,
+				   GtkTreeIter *parent,
+				   GHashTable *iters,
+				   GHashTable *pending)
+{
+	const gchar *cat_id;
+	const gchar *icon;
+	const gchar *name;
+	const gchar *summary;
+	GPtrArray *children;
+	GtkTreeIter iter;
+	GtkTreeIter *tmp;
+	guint i;
+
+	g_variant_get_child (entries, idx, "(&s&s&s&s&s)",
+			     NULL, &cat_id, &name, &summary, &icon);
+
+	/* top level rows are just headings */
+	gtk_tree_store_append (priv->groups_store, &iter, parent);
+	gtk_tree_store_set (priv->groups_store, &iter,
+			    GROUPS_COLUMN_NAME, name,
+			    GROUPS_COLUMN_SUMMARY, summary,
+			    GROUPS_COLUMN_ID, cat_id,
+			    GROUPS_COLUMN_ICON, icon,
+			    GROUPS_COLUMN_ACTIVE, parent != NULL,
+			    -1);
+	tmp = g_new (GtkTreeIter, 1);
+	*tmp = iter;
+	g_hash_table_insert (iters, (gpointer) cat_id, tmp);
+
+	/* children that were listed before us */
+	children = g_hash_table_lookup (pending, cat_id);
+	if (children == NULL)
+		return;
+	g_hash_table_steal (pending, cat_id);
+	for (i = 0; i < children->len; i++) {
+		gpk_application_categories_insert (priv, entries,
+						   GPOINTER_TO_UINT (g_ptr_array_index (children, i)),
+						   &iter, iters, pending);
+	}
+	g_ptr_array_unref (children);
+}
+
+static void
+gpk_application_groups_clear (GpkApplicationPrivate *priv)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL (priv->groups_store);
+	GtkTreeIter iter;
+	gboolean found = FALSE;
+	gboolean valid;
+
+	/* groups and categories always come after the separator */
+	valid = gtk_tree_model_get_iter_first (model, &iter);
+	while (valid) {
+		g_autofree gchar *id = NULL;
+		if (found) {
+			valid = gtk_tree_store_remove (priv->groups_store, &iter);
+			continue;
+		}
+		gtk_tree_model_get (model, &iter, GROUPS_COLUMN_ID, &id, -1);
+		found = g_strcmp0 (id, "separator") == 0;
+		valid = gtk_tree_model_iter_next (model, &iter);
+	}
+}
+
 static void
-gpk_application_get_categories_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_categories_set (GpkApplicationPrivate *priv, GVariant *categories)
+{
+	const gchar *parent_id;
+	gpointer key;
+	gpointer value;
+	GHashTableIter hiter;
+	GPtrArray *children;
+	GtkTreeIter *parent;
+	GtkTreeIter parent_iter;
+	GtkTreeView *treeview;
+	guint i;
+	guint len;
+	g_autoptr(GHashTable) iters = NULL;
+	g_autoptr(GHashTable) pending = NULL;
+	g_autoptr(GVariant) entries = NULL;
+
+	/* keep the strings the hash tables point into */
+	if (priv->categories != categories) {
+		g_clear_pointer (&priv->categories, g_variant_unref);
+		priv->categories = g_variant_ref (categories);
+	}
+	gpk_application_groups_clear (priv);
+
+	/* set to expanders with indent */
+	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_groups"));
+	gtk_tree_view_set_show_expanders (treeview, TRUE);
+	gtk_tree_view_set_level_indentation  (treeview, 3);
+
+	/* any depth, in one pass, whatever order the parents come in */
+	iters = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	pending = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+					 (GDestroyNotify) g_ptr_array_unref);
+	entries = g_variant_get_child_value (priv->categories, 1);
+	len = g_variant_n_children (entries);
+	for (i = 0; i < len; i++) {
+		g_variant_get_child (entries, i, "(&sssss)", &parent_id,
+				     NULL, NULL, NULL, NULL);
+		if (parent_id[0] == '\0') {
+			gpk_application_categories_insert (priv, entries, i, NULL,
+							   iters, pending);
+			continue;
+		}
+		parent = g_hash_table_lookup (iters, parent_id);
+		if (parent != NULL) {
+			parent_iter = *parent;
+			gpk_application_categories_insert (priv, entries, i, &parent_iter,
+							   iters, pending);
+			continue;
+		}
+		children = g_hash_table_lookup (pending, parent_id);
+		if (children == NULL) {
+			children = g_ptr_array_new ();
+			g_hash_table_insert (pending, (gpointer) parent_id, children);
+		}
+		g_ptr_array_add (children, GUINT_TO_POINTER (i));
+	}
+
+	/* the parent never turned up, so show these at the top */
+	while (g_hash_table_size (pending) > 0) {
+		g_hash_table_iter_init (&hiter, pending);
+		g_hash_table_iter_next (&hiter, &key, &value);
+		g_hash_table_iter_steal (&hiter);
+		children = value;
+		g_debug ("no parent category %s", (const gchar *) key);
+		for (i = 0; i < children->len; i++) {
+			gpk_application_categories_insert (priv, entries,
+							   GPOINTER_TO_UINT (g_ptr_array_index (children, i)),
+							   NULL, iters, pending);
+		}
+		g_ptr_array_unref (children);
+	}
+	g_debug ("added %u categories", len);
+
+	/* open all expanders */
+	gtk_tree_view_collapse_all (treeview);
+}
+
+static void
+gpk_application_get_categories_cb (GpkQueryScheduler *scheduler, PkResults *results,
+				const GError *error, GpkApplicationPrivate *priv)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
-	GtkTreeIter iter;
-	GtkTreeIter iter2;
-	guint i, j;
-	GtkTreeView *treeview;
-	PkCategory *item;
-	PkCategory *item2;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GVariant) categories = NULL;
 	GtkWindow *window;
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
 	if (results == NULL) {
 		g_warning ("failed to get list of categories: %s", error->message);
 		return;
@@ -2412,82 +4104,62 @@ gpk_application_get_categories_cb (PkTask *task, GAsyncResult *res, GpkApplicati
 		return;
 	}
 
-	/* set to expanders with indent */
-	treeview = GTK_TREE_VIEW (gtk_builder_get_object (priv->builder, "treeview_groups"));
-	gtk_tree_view_set_show_expanders (treeview, TRUE);
-	gtk_tree_view_set_level_indentation  (treeview, 3);
+	/* the user may have switched back to groups meanwhile */
+	if (!g_settings_get_boolean (priv->settings, GPK_SETTINGS_CATEGORY_GROUPS))
+		return;
 
-	/* add repos with descriptions */
+	/* nothing to do if the cached tree was right */
 	array = pk_results_get_category_array (results);
-	for (i = 0; i < array->len; i++) {
-		g_autofree gchar *package_id = NULL;
-		g_autofree gchar *name = NULL;
-		g_autofree gchar *summary = NULL;
-		g_autofree gchar *cat_id = NULL;
-		g_autofree gchar *icon = NULL;
+	categories = gpk_application_categories_to_variant (array);
+	if (priv->categories != NULL && g_variant_equal (priv->categories, categories)) {
+		g_debug ("cached categories are still valid");
+		return;
+	}
+	gpk_application_categories_set (priv, categories);
+	if (!gpk_application_categories_save (categories, &error_local))
+		g_warning ("failed to save categories: %s", error_local->message);
+}
 
-		item = g_ptr_array_index (array, i);
-		g_object_get (item,
-			      "name", &name,
-			      "summary", &summary,
-			      "cat-id", &cat_id,
-			      "icon", &icon,
-			      NULL);
+static void
+gpk_application_create_group_array_categories (GpkApplicationPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) categories = NULL;
 
-		gtk_tree_store_append (priv->groups_store, &iter, NULL);
-		gtk_tree_store_set (priv->groups_store, &iter,
-				    GROUPS_COLUMN_NAME, name,
-				    GROUPS_COLUMN_SUMMARY, summary,
-				    GROUPS_COLUMN_ID, cat_id,
-				    GROUPS_COLUMN_ICON, icon,
-				    GROUPS_COLUMN_ACTIVE, FALSE,
-				    -1);
-		j = 0;
-		do {
-			g_autofree gchar *cat_id_tmp = NULL;
-			g_autofree gchar *icon_tmp = NULL;
-			g_autofree gchar *name_tmp = NULL;
-			g_autofree gchar *parent_id_tmp = NULL;
-			g_autofree gchar *summary_tmp = NULL;
-
-			/* only allows groups two layers deep */
-			item2 = g_ptr_array_index (array, j);
-			g_object_get (item2,
-				      "parent-id", &parent_id_tmp,
-				      "cat-id", &cat_id_tmp,
-				      "name", &name_tmp,
-				      "summary", &summary_tmp,
-				      "icon", &icon_tmp,
-				      NULL);
-			if (g_strcmp0 (parent_id_tmp, cat_id) == 0) {
-				gtk_tree_store_append (priv->groups_store, &iter2, &iter);
-				gtk_tree_store_set (priv->groups_store, &iter2,
-						    GROUPS_COLUMN_NAME, name_tmp,
-						    GROUPS_COLUMN_SUMMARY, summary_tmp,
-						    GROUPS_COLUMN_ID, cat_id_tmp,
-						    GROUPS_COLUMN_ICON, icon_tmp,
-						    GROUPS_COLUMN_ACTIVE, TRUE,
-						    -1);
-				g_ptr_array_remove (array, item2);
-			} else
-				j++;
-		} while (j < array->len);
-	}
+	/* show what we had last time straight away */
+	if (priv->categories != NULL)
+		categories = g_variant_ref (priv->categories);
+	else
+		categories = gpk_application_categories_load (&error);
+	if (categories != NULL)
+		gpk_application_categories_set (priv, categories);
+	else
+		g_debug ("no cached categories: %s", error->message);
 
-	/* open all expanders */
-	gtk_tree_view_collapse_all (treeview);
+	/* get categories supported, to check the cache */
+	gpk_query_scheduler_query (priv->scheduler, GPK_QUERY_KIND_CATEGORIES, NULL,
+				   (PkProgressCallback) gpk_application_progress_cb, priv,
+				   (GpkQueryFunc) gpk_application_get_categories_cb, priv);
 }
 
 static void
-gpk_application_create_group_array_categories (GpkApplicationPrivate *priv)
+gpk_application_refilter (GpkApplicationPrivate *priv)
 {
-	/* ensure new action succeeds */
-	g_cancellable_reset (priv->cancellable);
+	g_autoptr(GPtrArray) array = NULL;
+
+	/* nothing to refilter yet, or not all of the results are in */
+	if (priv->search_packages == NULL || priv->search_in_progress) {
+		gpk_application_perform_search (priv);
+		return;
+	}
 
-	/* get categories supported */
-	pk_task_get_categories_async (PK_TASK(priv->task), priv->cancellable,
-				        (PkProgressCallback) gpk_application_progress_cb, priv,
-				        (GAsyncReadyCallback) gpk_application_get_categories_cb, priv);
+	/* only the rows that appear or disappear are changed */
+	g_timer_start (priv->search_timer);
+	array = g_ptr_array_ref (priv->search_packages);
+	gpk_application_search_set_results (priv, array);
+	gpk_application_load_finish (priv);
+	g_debug ("refiltered %u results in %.3fms", array->len,
+		 g_timer_elapsed (priv->search_timer, NULL) * 1000);
 }
 
 static void
@@ -2497,25 +4169,25 @@ gpk_application_key_changed_cb (GSettings *settings, const gchar *key, GpkApplic
 
 	if (g_strcmp0 (key, GPK_SETTINGS_CATEGORY_GROUPS) == 0) {
 		ret = g_settings_get_boolean (priv->settings, key);
-		gtk_tree_store_clear (priv->groups_store);
+		gpk_application_groups_clear (priv);
 		if (ret)
 			gpk_application_create_group_array_categories (priv);
 		else
 			gpk_application_create_group_array_enum (priv);
 	} else if (g_strcmp0 (key, "filter-newest") == 0) {
-		/* refresh the search results */
+		/* refilter the search results */
 		if (g_settings_get_boolean (priv->settings, key))
 			pk_bitfield_add (priv->filters_current, PK_FILTER_ENUM_NEWEST);
 		else
 			pk_bitfield_remove (priv->filters_current, PK_FILTER_ENUM_NEWEST);
-		gpk_application_perform_search (priv);
+		gpk_application_refilter (priv);
 	} else if (g_strcmp0 (key, "filter-arch") == 0) {
-		/* refresh the search results */
+		/* refilter the search results */
 		if (g_settings_get_boolean (priv->settings, key))
 			pk_bitfield_add (priv->filters_current, PK_FILTER_ENUM_ARCH);
 		else
 			pk_bitfield_remove (priv->filters_current, PK_FILTER_ENUM_ARCH);
-		gpk_application_perform_search (priv);
+		gpk_application_refilter (priv);
 	}
 }
 
@@ -2527,6 +4199,7 @@ pk_backend_status_get_properties_cb (GObject *object, GAsyncResult *res, GpkAppl
 	PkControl *control = PK_CONTROL(object);
 	gboolean ret;
 	PkBitfield filters;
+	g_autofree gchar *distro_id = NULL;
 	GtkTreeIter iter;
 	const gchar *icon_name;
 
@@ -2543,8 +4216,16 @@ pk_backend_status_get_properties_cb (GObject *object, GAsyncResult *res, GpkAppl
 		      "roles", &priv->roles,
 		      "filters", &filters,
 		      "groups", &priv->groups,
+		      "distro-id", &distro_id,
 		      NULL);
 
+	/* the arch filter is applied locally, e.g. "fedora;40;x86_64" */
+	if (distro_id != NULL) {
+		g_auto(GStrv) split = g_strsplit (distro_id, ";", -1);
+		if (g_strv_length (split) == 3)
+			priv->arch_native = g_strdup (gpk_application_arch_normalize (split[2]));
+	}
+
 	/* Remove description/file array if needed. */
 	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_DETAILS) == FALSE) {
 		widget = GTK_WIDGET (gtk_builder_get_object (priv->builder, "scrolledwindow2"));
@@ -2639,21 +4320,22 @@ pk_backend_status_get_properties_cb (GObject *object, GAsyncResult *res, GpkAppl
 
 	/* welcome */
 	gpk_application_add_welcome (priv);
+
+	/* answer name searches locally if we can */
+	if (pk_bitfield_contain (priv->roles, PK_ROLE_ENUM_GET_PACKAGES))
+		gpk_application_name_index_check (priv);
 }
 
 static void
-gpk_application_get_repo_list_cb (PkTask *task, GAsyncResult *res, GpkApplicationPrivate *priv)
+gpk_application_get_repo_list_cb (GpkQueryScheduler *scheduler, PkResults *results,
+				const GError *error, GpkApplicationPrivate *priv)
 {
-	g_autoptr(PkResults) results = NULL;
-	g_autoptr(GError) error = NULL;
 	g_autoptr(PkError) error_code = NULL;
 	g_autoptr(GPtrArray) array = NULL;
 	PkRepoDetail *item;
 	guint i;
 	GtkWindow *window;
 
-	/* get the results */
-	results = pk_task_generic_finish (task, res, &error);
 	if (results == NULL) {
 		g_warning ("failed to get list of repos: %s", error->message);
 		return;
@@ -2704,29 +4386,32 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 {
 	GAction *action;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_local = NULL;
 	GMenuModel *menu;
 	GtkTreeSelection *selection;
 	GtkWidget *main_window;
 	GtkWidget *widget;
 	guint retval;
 
-	priv->package_sack = pk_package_sack_new ();
+	priv->queue = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
 	priv->settings = g_settings_new (GPK_SETTINGS_SCHEMA);
-	priv->cancellable = g_cancellable_new ();
+	priv->scheduler = gpk_query_scheduler_new ();
 	priv->repos = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->search_package_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->search_timer = g_timer_new ();
+	priv->load_queue = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->load_shown = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->search_cache = g_queue_new ();
+	priv->search_cache_index = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->details_cache = g_queue_new ();
+	priv->details_cache_index = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->details_pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, NULL);
 
 	/* watch gnome-packagekit keys */
 	g_signal_connect (priv->settings, "changed", G_CALLBACK (gpk_application_key_changed_cb), priv);
 
 	/* create array stores */
-	priv->packages_store = gtk_list_store_new (PACKAGES_COLUMN_LAST,
-					      G_TYPE_STRING,
-					      G_TYPE_UINT64,
-					      G_TYPE_BOOLEAN,
-					      G_TYPE_BOOLEAN,
-					      G_TYPE_STRING,
-					      G_TYPE_STRING,
-					      G_TYPE_STRING);
 	priv->groups_store = gtk_tree_store_new (GROUPS_COLUMN_LAST,
 					   G_TYPE_STRING,
 					   G_TYPE_STRING,
@@ -2742,16 +4427,37 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 
 	priv->control = pk_control_new ();
 
+	/* used to build the name index without blocking other transactions */
+	priv->name_index = gpk_name_index_new (NULL);
+	priv->details_index = gpk_details_index_new ();
+	priv->name_index_cancellable = g_cancellable_new ();
+	priv->name_index_client = pk_client_new ();
+	g_object_set (priv->name_index_client,
+		      "background", TRUE,
+		      NULL);
+
 	/* this is what we use mainly */
 	priv->task = PK_TASK (gpk_task_new ());
 	g_object_set (priv->task,
 		      "background", FALSE,
 		      NULL);
 
+	/* fetches packages while others are being removed */
+	priv->download_task = PK_TASK (gpk_task_new ());
+	g_object_set (priv->download_task,
+		      "background", FALSE,
+		      "only-download", TRUE,
+		      "simulate", FALSE,
+		      NULL);
+
 	/* get properties */
 	pk_control_get_properties_async (priv->control, NULL, (GAsyncReadyCallback) pk_backend_status_get_properties_cb, priv);
 	g_signal_connect (priv->control, "notify::network-state",
 			  G_CALLBACK (gpk_application_notify_network_state_cb), priv);
+	g_signal_connect (priv->control, "updates-changed",
+			  G_CALLBACK (gpk_application_updates_changed_cb), priv);
+	g_signal_connect (priv->control, "repo-list-changed",
+			  G_CALLBACK (gpk_application_repo_list_changed_cb), priv);
 
 	/* get UI */
 	priv->builder = gtk_builder_new ();
@@ -2765,6 +4471,7 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 
 	main_window = GTK_WIDGET (gtk_builder_get_object (priv->builder, "window_manager"));
 	gtk_application_add_window (application, GTK_WINDOW (main_window));
+	priv->packages_store = gpk_application_packages_store_new (priv);
 	gtk_window_set_application (GTK_WINDOW (main_window), application);
 
 	/* setup the application menu */
@@ -2886,14 +4593,13 @@ gpk_application_startup_cb (GtkApplication *application, GpkApplicationPrivate *
 			  G_CALLBACK (gpk_application_groups_treeview_changed_cb), priv);
 
 	/* get repos, so we can show the full name in the package source box */
-	pk_task_get_repo_list_async (PK_TASK (priv->task),
-				       pk_bitfield_value (PK_FILTER_ENUM_NONE),
-				       priv->cancellable,
-				       (PkProgressCallback) gpk_application_progress_cb, priv,
-				       (GAsyncReadyCallback) gpk_application_get_repo_list_cb, priv);
+	gpk_query_scheduler_query (priv->scheduler, GPK_QUERY_KIND_REPO_LIST, NULL,
+				   (PkProgressCallback) gpk_application_progress_cb, priv,
+				   (GpkQueryFunc) gpk_application_get_repo_list_cb, priv);
 
-	/* set current action */
-	priv->action = GPK_ACTION_NONE;
+	/* carry on from where we left off */
+	if (!gpk_application_queue_load (priv, &error_local))
+		g_debug ("no saved queue: %s", error_local->message);
 	gpk_application_change_queue_status (priv);
 
 	/* sync toggles */
@@ -3010,6 +4716,19 @@ main (int argc, char *argv[])
 
 	if (priv->details_event_id > 0)
 		g_source_remove (priv->details_event_id);
+	if (priv->queue_save_id > 0)
+		g_source_remove (priv->queue_save_id);
+	if (priv->details_fetch_id > 0)
+		g_source_remove (priv->details_fetch_id);
+	if (priv->details_cache != NULL)
+		g_queue_free_full (priv->details_cache, (GDestroyNotify) g_object_unref);
+	if (priv->details_cache_index != NULL)
+		g_hash_table_unref (priv->details_cache_index);
+	if (priv->details_pending != NULL)
+		g_hash_table_unref (priv->details_pending);
+	g_free (priv->details_package_id);
+	if (priv->categories != NULL)
+		g_variant_unref (priv->categories);
 
 	if (priv->packages_store != NULL)
 		g_object_unref (priv->packages_store);
@@ -3017,21 +4736,59 @@ main (int argc, char *argv[])
 		g_object_unref (priv->control);
 	if (priv->task != NULL)
 		g_object_unref (priv->task);
+	if (priv->download_task != NULL)
+		g_object_unref (priv->download_task);
 	if (priv->settings != NULL)
 		g_object_unref (priv->settings);
 	if (priv->builder != NULL)
 		g_object_unref (priv->builder);
-	if (priv->cancellable != NULL)
-		g_object_unref (priv->cancellable);
-	if (priv->package_sack != NULL)
-		g_object_unref (priv->package_sack);
+	if (priv->scheduler != NULL)
+		g_object_unref (priv->scheduler);
+	if (priv->search_cancellable != NULL)
+		g_object_unref (priv->search_cancellable);
+	if (priv->search_typing_id > 0)
+		g_source_remove (priv->search_typing_id);
+	if (priv->name_index_id > 0)
+		g_source_remove (priv->name_index_id);
+	if (priv->name_index_cancellable != NULL)
+		g_object_unref (priv->name_index_cancellable);
+	if (priv->name_index_client != NULL)
+		g_object_unref (priv->name_index_client);
+	if (priv->name_index != NULL)
+		g_object_unref (priv->name_index);
+	if (priv->details_index_id > 0)
+		g_source_remove (priv->details_index_id);
+	if (priv->details_index != NULL)
+		g_object_unref (priv->details_index);
+	if (priv->queue != NULL)
+		g_hash_table_unref (priv->queue);
 	if (priv->repos != NULL)
 		g_hash_table_destroy (priv->repos);
+	if (priv->search_package_ids != NULL)
+		g_hash_table_destroy (priv->search_package_ids);
+	if (priv->load_queue != NULL) {
+		gpk_application_load_cancel (priv);
+		g_ptr_array_unref (priv->load_queue);
+		g_ptr_array_unref (priv->load_shown);
+	}
+	if (priv->search_results != NULL)
+		g_hash_table_unref (priv->search_results);
+	if (priv->search_cache != NULL) {
+		g_debug ("search cache: %u hits, %u misses",
+			 priv->search_cache_hits, priv->search_cache_misses);
+		g_hash_table_unref (priv->search_cache_index);
+		g_queue_free_full (priv->search_cache, (GDestroyNotify) gpk_application_search_cache_item_free);
+	}
+	if (priv->search_packages != NULL)
+		g_ptr_array_unref (priv->search_packages);
+	if (priv->search_timer != NULL)
+		g_timer_destroy (priv->search_timer);
 	if (priv->status_id > 0)
 		g_source_remove (priv->status_id);
 	g_free (priv->homepage_url);
 	g_free (priv->search_group);
 	g_free (priv->search_text);
+	g_free (priv->arch_native);
 	g_free (priv);
 
 	return status;
@@ -137,23 +137,108 @@ gpk_window_set_parent_xid (GtkWindow *window, guint32 xid)
 	return TRUE;
 }
 
+/**
+ * gpk_package_id_view_init:
+ * @view: (out): the view to set up
+ * @package_id: a package-id, e.g. "hal;0.0.1;i386;fedora"
+ *
+ * Finds the four fields of @package_id without copying them, so unlike
+ * pk_package_id_split() this can be used for every row of a large list.
+ * @package_id has to outlive @view.
+ *
+ * Return value: %TRUE if @package_id is valid
+ **/
+gboolean
+gpk_package_id_view_init (GpkPackageIdView *view, const gchar *package_id)
+{
+	const gchar *field = package_id;
+	const gchar *end;
+	guint i;
+
+	g_return_val_if_fail (view != NULL, FALSE);
+
+	if (package_id == NULL)
+		return FALSE;
+	view->package_id = package_id;
+	for (i = 0; i < 4; i++) {
+		end = strchr (field, ';');
+
+		/* exactly three separators */
+		if ((i < 3) == (end == NULL))
+			return FALSE;
+		if (end == NULL)
+			end = field + strlen (field);
+		view->offset[i] = field - package_id;
+		view->len[i] = end - field;
+		field = end + 1;
+	}
+
+	/* the name is the only field that is required */
+	return view->len[PK_PACKAGE_ID_NAME] > 0;
+}
+
+/**
+ * gpk_package_id_view_get:
+ * @field: e.g. %PK_PACKAGE_ID_NAME
+ * @len: (out) (allow-none): the length of the field
+ *
+ * Return value: the start of the field, which is not nul terminated
+ **/
+const gchar *
+gpk_package_id_view_get (const GpkPackageIdView *view, guint field, gsize *len)
+{
+	g_return_val_if_fail (field < 4, NULL);
+	if (len != NULL)
+		*len = view->len[field];
+	return view->package_id + view->offset[field];
+}
+
+gboolean
+gpk_package_id_view_equal (const GpkPackageIdView *view, guint field, const gchar *str)
+{
+	g_return_val_if_fail (field < 4, FALSE);
+	if (str == NULL)
+		return FALSE;
+	return strncmp (view->package_id + view->offset[field], str, view->len[field]) == 0 &&
+	       str[view->len[field]] == '\0';
+}
+
+gboolean
+gpk_package_id_view_contains (const GpkPackageIdView *view, guint field, const gchar *str)
+{
+	g_return_val_if_fail (field < 4, FALSE);
+	if (str == NULL)
+		return FALSE;
+	return g_strstr_len (view->package_id + view->offset[field], view->len[field], str) != NULL;
+}
+
+gchar *
+gpk_package_id_view_dup (const GpkPackageIdView *view, guint field)
+{
+	g_return_val_if_fail (field < 4, NULL);
+	return g_strndup (view->package_id + view->offset[field], view->len[field]);
+}
+
 static const gchar *
-gpk_get_pretty_arch (const gchar *arch)
+gpk_get_pretty_arch (const GpkPackageIdView *view)
 {
+	const gchar *arch;
 	const gchar *id = NULL;
+	gsize len;
 
-	if (arch[0] == '\0')
+	arch = gpk_package_id_view_get (view, PK_PACKAGE_ID_ARCH, &len);
+	if (len == 0)
 		goto out;
 
 	/* 32 bit */
-	if (g_str_has_prefix (arch, "i")) {
+	if (arch[0] == 'i') {
 		/* TRANSLATORS: a 32 bit package */
 		id = _("32-bit");
 		goto out;
 	}
 
 	/* 64 bit */
-	if (g_str_has_suffix (arch, "64")) {
+	if (len >= 2 && strncmp (arch + len - 2, "64", 2) == 0) {
 		/* TRANSLATORS: a 64 bit package */
 		id = _("64-bit");
 		goto out;
@@ -162,6 +247,25 @@ out:
 	return id;
 }
 
+static void
+gpk_package_id_view_append_nevra (const GpkPackageIdView *view, GString *string)
+{
+	const gchar *arch;
+	const gchar *tmp;
+	gsize len;
+
+	tmp = gpk_package_id_view_get (view, PK_PACKAGE_ID_NAME, &len);
+	g_string_append_len (string, tmp, len);
+	tmp = gpk_package_id_view_get (view, PK_PACKAGE_ID_VERSION, &len);
+	if (len > 0) {
+		g_string_append_c (string, '-');
+		g_string_append_len (string, tmp, len);
+	}
+	arch = gpk_get_pretty_arch (view);
+	if (arch != NULL)
+		g_string_append_printf (string, " (%s)", arch);
+}
+
 gchar *
 gpk_package_id_format_twoline (GtkStyleContext *style,
 			       const gchar *package_id,
@@ -169,41 +273,21 @@ gpk_package_id_format_twoline (GtkStyleContext *style,
 {
 	g_autofree gchar *summary_safe = NULL;
 	GString *string;
-	g_auto(GStrv) split = NULL;
-	g_autofree gchar *color = NULL;
-	const gchar *arch;
+	GpkPackageIdView view;
 	GdkRGBA inactive;
 
 	g_return_val_if_fail (package_id != NULL, NULL);
 
-	/* get style color */
-	if (style != NULL) {
-		gtk_style_context_get_color (style,
-					     GTK_STATE_FLAG_INSENSITIVE,
-					     &inactive);
-		color = g_strdup_printf ("#%02x%02x%02x",
-					 (guint) (inactive.red * 255.0f),
-					 (guint) (inactive.green * 255.0f),
-					 (guint) (inactive.blue * 255.0f));
-	} else {
-		color = g_strdup ("gray");
-	}
-
 	/* optional */
-	split = pk_package_id_split (package_id);
-	if (split == NULL) {
+	if (!gpk_package_id_view_init (&view, package_id)) {
 		g_warning ("could not parse %s", package_id);
 		return NULL;
 	}
 
 	/* no summary */
 	if (summary == NULL || summary[0] == '\0') {
-		string = g_string_new (split[PK_PACKAGE_ID_NAME]);
-		if (split[PK_PACKAGE_ID_VERSION][0] != '\0')
-			g_string_append_printf (string, "-%s", split[PK_PACKAGE_ID_VERSION]);
-		arch = gpk_get_pretty_arch (split[PK_PACKAGE_ID_ARCH]);
-		if (arch != NULL)
-			g_string_append_printf (string, " (%s)", arch);
+		string = g_string_new (NULL);
+		gpk_package_id_view_append_nevra (&view, string);
 		return g_string_free (string, FALSE);
 	}
 
@@ -211,13 +295,20 @@ gpk_package_id_format_twoline (GtkStyleContext *style,
 	string = g_string_new ("");
 	summary_safe = g_markup_escape_text (summary, -1);
 	g_string_append_printf (string, "%s\n", summary_safe);
-	g_string_append_printf (string, "<span color=\"%s\">", color);
-	g_string_append (string, split[PK_PACKAGE_ID_NAME]);
-	if (split[PK_PACKAGE_ID_VERSION][0] != '\0')
-		g_string_append_printf (string, "-%s", split[PK_PACKAGE_ID_VERSION]);
-	arch = gpk_get_pretty_arch (split[PK_PACKAGE_ID_ARCH]);
-	if (arch != NULL)
-		g_string_append_printf (string, " (%s)", arch);
+
+	/* get style color */
+	if (style != NULL) {
+		gtk_style_context_get_color (style,
+					     GTK_STATE_FLAG_INSENSITIVE,
+					     &inactive);
+		g_string_append_printf (string, "<span color=\"#%02x%02x%02x\">",
+					(guint) (inactive.red * 255.0f),
+					(guint) (inactive.green * 255.0f),
+					(guint) (inactive.blue * 255.0f));
+	} else {
+		g_string_append (string, "<span color=\"gray\">");
+	}
+	gpk_package_id_view_append_nevra (&view, string);
 	g_string_append (string, "</span>");
 	return g_string_free (string, FALSE);
 }
@@ -226,17 +317,130 @@ gchar *
 gpk_package_id_format_oneline (const gchar *package_id, const gchar *summary)
 {
 	g_autofree gchar *summary_safe = NULL;
-	g_auto(GStrv) split = NULL;
+	GpkPackageIdView view;
+	const gchar *name;
+	gsize len;
 
 	g_return_val_if_fail (package_id != NULL, NULL);
 
-	split = pk_package_id_split (package_id);
+	if (!gpk_package_id_view_init (&view, package_id)) {
+		g_warning ("could not parse %s", package_id);
+		return NULL;
+	}
+	name = gpk_package_id_view_get (&view, PK_PACKAGE_ID_NAME, &len);
 	if (summary == NULL || summary[0] == '\0') {
 		/* just have name */
-		return g_strdup (split[PK_PACKAGE_ID_NAME]);
+		return g_strndup (name, len);
 	}
 	summary_safe = g_markup_escape_text (summary, -1);
-	return g_strdup_printf ("<b>%s</b> (%s)", summary_safe, split[PK_PACKAGE_ID_NAME]);
+	return g_strdup_printf ("<b>%s</b> (%.*s)", summary_safe, (gint) len, name);
+}
+
+static guint64
+gpk_package_version_get_epoch (const gchar **version)
+{
+	const gchar *tmp = *version;
+	guint64 epoch = 0;
+
+	/* only an epoch if the digits are followed by a colon */
+	while (g_ascii_isdigit (*tmp))
+		epoch = epoch * 10 + (*tmp++ - '0');
+	if (*tmp != ':')
+		return 0;
+	*version = tmp + 1;
+	return epoch;
+}
+
+/**
+ * gpk_package_version_compare:
+ * @version1: a version, e.g. "1:2.0.1-3.fc40"
+ * @version2: another version
+ *
+ * Compares versions the way rpm and dpkg mostly agree on: the epoch first,
+ * then runs of digits numerically and runs of letters alphabetically, with
+ * digits newer than letters and a tilde older than anything, even the end
+ * of the version. Nothing is allocated, so this can be used on every
+ * package of a large result set.
+ *
+ * Return value: negative if @version1 is older, 0 if the same, positive if newer
+ **/
+gint
+gpk_package_version_compare (const gchar *version1, const gchar *version2)
+{
+	const gchar *a = version1;
+	const gchar *b = version2;
+	guint64 epoch_a;
+	guint64 epoch_b;
+	gsize len_a;
+	gsize len_b;
+	gint rc;
+
+	if (a == NULL || b == NULL)
+		return (a != NULL) - (b != NULL);
+
+	epoch_a = gpk_package_version_get_epoch (&a);
+	epoch_b = gpk_package_version_get_epoch (&b);
+	if (epoch_a != epoch_b)
+		return epoch_a < epoch_b ? -1 : 1;
+
+	while (*a != '\0' || *b != '\0') {
+		/* separators only split the runs */
+		while (*a != '\0' && *a != '~' && !g_ascii_isalnum (*a))
+			a++;
+		while (*b != '\0' && *b != '~' && !g_ascii_isalnum (*b))
+			b++;
+
+		/* pre-releases, e.g. 1.0~rc1 is older than 1.0 */
+		if (*a == '~' || *b == '~') {
+			if (*a != '~')
+				return 1;
+			if (*b != '~')
+				return -1;
+			a++;
+			b++;
+			continue;
+		}
+		if (*a == '\0' || *b == '\0')
+			break;
+
+		len_a = 0;
+		len_b = 0;
+		if (g_ascii_isdigit (*a)) {
+			if (!g_ascii_isdigit (*b))
+				return 1;
+
+			/* without leading zeros the longer number is bigger */
+			while (*a == '0')
+				a++;
+			while (*b == '0')
+				b++;
+			while (g_ascii_isdigit (a[len_a]))
+				len_a++;
+			while (g_ascii_isdigit (b[len_b]))
+				len_b++;
+			if (len_a != len_b)
+				return len_a < len_b ? -1 : 1;
+		} else {
+			if (g_ascii_isdigit (*b))
+				return -1;
+			while (g_ascii_isalpha (a[len_a]))
+				len_a++;
+			while (g_ascii_isalpha (b[len_b]))
+				len_b++;
+		}
+		rc = strncmp (a, b, MIN (len_a, len_b));
+		if (rc != 0)
+			return rc < 0 ? -1 : 1;
+		if (len_a != len_b)
+			return len_a < len_b ? -1 : 1;
+		a += len_a;
+		b += len_b;
+	}
+
+	/* whichever has something left is newer */
+	if (*a == '\0' && *b == '\0')
+		return 0;
+	return *a == '\0' ? -1 : 1;
 }
 
 gboolean
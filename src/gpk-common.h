@@ -34,6 +34,7 @@ G_BEGIN_DECLS
 #define GPK_SETTINGS_CATEGORY_GROUPS			"category-groups"
 #define GPK_SETTINGS_DBUS_DEFAULT_INTERACTION		"dbus-default-interaction"
 #define GPK_SETTINGS_DBUS_ENFORCED_INTERACTION		"dbus-enforced-interaction"
+#define GPK_SETTINGS_DOWNLOAD_IN_BACKGROUND		"download-updates-in-background"
 #define GPK_SETTINGS_ENABLE_AUTOREMOVE			"enable-autoremove"
 #define GPK_SETTINGS_ENABLE_CODEC_HELPER		"enable-codec-helper"
 #define GPK_SETTINGS_ENABLE_FONT_HELPER			"enable-font-helper"
@@ -44,11 +45,16 @@ G_BEGIN_DECLS
 #define GPK_SETTINGS_FILTER_SUPPORTED			"filter-supported"
 #define GPK_SETTINGS_IGNORED_DBUS_REQUESTS		"ignored-dbus-requests"
 #define GPK_SETTINGS_ONLY_NEWEST			"only-newest"
+#define GPK_SETTINGS_PROGRESS_UPDATE_INTERVAL		"progress-update-interval"
 #define GPK_SETTINGS_REPO_SHOW_DETAILS			"repo-show-details"
 #define GPK_SETTINGS_SCROLL_ACTIVE			"scroll-active"
+#define GPK_SETTINGS_SEARCH_AS_YOU_TYPE			"search-as-you-type"
+#define GPK_SETTINGS_SEARCH_AS_YOU_TYPE_DELAY		"search-as-you-type-delay"
+#define GPK_SETTINGS_SEARCH_AS_YOU_TYPE_MIN_LENGTH	"search-as-you-type-min-length"
 #define GPK_SETTINGS_SEARCH_MODE			"search-mode"
 #define GPK_SETTINGS_SHOW_ALL_PACKAGES			"show-all-packages"
 #define GPK_SETTINGS_SHOW_DEPENDS			"show-depends"
+#define GPK_SETTINGS_STAGED_UPDATES			"staged-updates"
 
 #define GPK_ICON_SOFTWARE_UPDATE		"system-software-update"
 #define GPK_ICON_SOFTWARE_SOURCES		"gpk-repo"
@@ -59,11 +65,33 @@ G_BEGIN_DECLS
 /* any status that is slower than this will not be shown in the UI */
 #define GPK_UI_STATUS_SHOW_DELAY		750 /* ms */
 
+/* the fields of a package-id, which is not copied */
+typedef struct {
+	const gchar	*package_id;
+	guint		 offset[4];	/* indexed by PK_PACKAGE_ID_NAME etc. */
+	guint		 len[4];
+} GpkPackageIdView;
+
 gchar		*gpk_package_id_format_twoline		(GtkStyleContext *style,
 							 const gchar 	*package_id,
 							 const gchar	*summary);
 gchar		*gpk_package_id_format_oneline		(const gchar 	*package_id,
 							 const gchar	*summary);
+gint		 gpk_package_version_compare		(const gchar	*version1,
+							 const gchar	*version2);
+gboolean	 gpk_package_id_view_init		(GpkPackageIdView *view,
+							 const gchar	*package_id);
+const gchar	*gpk_package_id_view_get		(const GpkPackageIdView *view,
+							 guint		 field,
+							 gsize		*len);
+gboolean	 gpk_package_id_view_equal		(const GpkPackageIdView *view,
+							 guint		 field,
+							 const gchar	*str);
+gboolean	 gpk_package_id_view_contains		(const GpkPackageIdView *view,
+							 guint		 field,
+							 const gchar	*str);
+gchar		*gpk_package_id_view_dup		(const GpkPackageIdView *view,
+							 guint		 field);
 gboolean	 gpk_check_privileged_user		(const gchar	*application_name,
 							 gboolean	 show_ui);
 gchar		*gpk_strv_join_locale			(gchar		**array);
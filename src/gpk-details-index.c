@@ -0,0 +1,451 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "gpk-details-index.h"
+
+/* how much a term matching each part of a package is worth */
+#define GPK_DETAILS_INDEX_SCORE_NAME_EXACT	10
+#define GPK_DETAILS_INDEX_SCORE_NAME		3
+#define GPK_DETAILS_INDEX_SCORE_SUMMARY		2
+#define GPK_DETAILS_INDEX_SCORE_DESCRIPTION	1
+
+/* only compact once this many documents have been replaced */
+#define GPK_DETAILS_INDEX_COMPACT_MIN		1024
+
+typedef struct {
+	gchar			*package_id;
+	gchar			*summary;
+	gchar			*text;		/* lowercase name, summary, description */
+	gsize			 name_end;
+	gsize			 summary_end;
+	PkInfoEnum		 info;
+} GpkDetailsIndexDoc;
+
+typedef struct {
+	GpkDetailsIndexDoc	*doc;
+	guint			 score;
+} GpkDetailsIndexMatch;
+
+struct _GpkDetailsIndex
+{
+	GObject			 parent_instance;
+	GPtrArray		*docs;		/* of GpkDetailsIndexDoc, NULL when replaced */
+	GHashTable		*doc_ids;	/* package-id:doc-id+1 */
+	GHashTable		*postings;	/* trigram:GArray of sorted doc-ids */
+	GHashTable		*descriptions;	/* package-id:description */
+	guint			 n_dead;
+};
+
+G_DEFINE_TYPE (GpkDetailsIndex, gpk_details_index, G_TYPE_OBJECT)
+
+static void
+gpk_details_index_doc_free (GpkDetailsIndexDoc *doc)
+{
+	if (doc == NULL)
+		return;
+	g_free (doc->package_id);
+	g_free (doc->summary);
+	g_free (doc->text);
+	g_free (doc);
+}
+
+static guint32
+gpk_details_index_trigram (const gchar *text)
+{
+	return ((guint32) (guchar) text[0] << 16) |
+	       ((guint32) (guchar) text[1] << 8) |
+	       (guint32) (guchar) text[2];
+}
+
+static gint
+gpk_details_index_guint32_cmp (gconstpointer a, gconstpointer b)
+{
+	guint32 value_a = *((const guint32 *) a);
+	guint32 value_b = *((const guint32 *) b);
+	if (value_a < value_b)
+		return -1;
+	if (value_a > value_b)
+		return 1;
+	return 0;
+}
+
+static void
+gpk_details_index_post (GpkDetailsIndex *index, guint32 doc_id, GpkDetailsIndexDoc *doc)
+{
+	GArray *posting;
+	gsize len;
+	gsize i;
+	guint32 last = 0;
+	g_autoptr(GArray) trigrams = NULL;
+
+	/* each trigram only once per document */
+	len = strlen (doc->text);
+	if (len < 3)
+		return;
+	trigrams = g_array_sized_new (FALSE, FALSE, sizeof (guint32), len - 2);
+	for (i = 0; i + 2 < len; i++) {
+		guint32 trigram = gpk_details_index_trigram (doc->text + i);
+		g_array_append_val (trigrams, trigram);
+	}
+	g_array_sort (trigrams, gpk_details_index_guint32_cmp);
+	for (i = 0; i < trigrams->len; i++) {
+		guint32 trigram = g_array_index (trigrams, guint32, i);
+		if (i > 0 && trigram == last)
+			continue;
+		last = trigram;
+		posting = g_hash_table_lookup (index->postings, GUINT_TO_POINTER (trigram));
+		if (posting == NULL) {
+			posting = g_array_new (FALSE, FALSE, sizeof (guint32));
+			g_hash_table_insert (index->postings, GUINT_TO_POINTER (trigram), posting);
+		}
+
+		/* doc-ids only ever grow, so the list stays sorted */
+		g_array_append_val (posting, doc_id);
+	}
+}
+
+static gboolean
+gpk_details_index_description_is_stale_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	GpkDetailsIndex *index = GPK_DETAILS_INDEX (user_data);
+	return !g_hash_table_contains (index->doc_ids, key);
+}
+
+static void
+gpk_details_index_prune_descriptions (GpkDetailsIndex *index)
+{
+	guint removed;
+
+	/* old versions would otherwise be kept forever */
+	removed = g_hash_table_foreach_remove (index->descriptions,
+					       gpk_details_index_description_is_stale_cb,
+					       index);
+	if (removed > 0)
+		g_debug ("dropped %u descriptions no longer indexed", removed);
+}
+
+static void
+gpk_details_index_compact (GpkDetailsIndex *index)
+{
+	GPtrArray *docs;
+	guint i;
+
+	g_debug ("compacting details index, %u of %u documents replaced",
+		 index->n_dead, index->docs->len);
+	docs = index->docs;
+	index->docs = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_details_index_doc_free);
+	g_hash_table_remove_all (index->doc_ids);
+	g_hash_table_remove_all (index->postings);
+	for (i = 0; i < docs->len; i++) {
+		GpkDetailsIndexDoc *doc = g_ptr_array_index (docs, i);
+		if (doc == NULL)
+			continue;
+		docs->pdata[i] = NULL;
+		g_ptr_array_add (index->docs, doc);
+		g_hash_table_insert (index->doc_ids, doc->package_id,
+				     GUINT_TO_POINTER (index->docs->len));
+		gpk_details_index_post (index, index->docs->len - 1, doc);
+	}
+	g_ptr_array_unref (docs);
+	index->n_dead = 0;
+	gpk_details_index_prune_descriptions (index);
+}
+
+/**
+ * gpk_details_index_add:
+ * @summary: (allow-none): the package summary
+ *
+ * Adds a package, or replaces it if it is already in the index. Any
+ * description already seen for @package_id is indexed too.
+ **/
+void
+gpk_details_index_add (GpkDetailsIndex *index,
+		       const gchar *package_id,
+		       PkInfoEnum info,
+		       const gchar *summary)
+{
+	GpkDetailsIndexDoc *doc;
+	GString *text;
+	const gchar *description;
+	const gchar *tmp;
+	gpointer doc_id;
+	g_autofree gchar *name = NULL;
+	g_autofree gchar *summary_down = NULL;
+	g_autofree gchar *description_down = NULL;
+
+	g_return_if_fail (GPK_IS_DETAILS_INDEX (index));
+	g_return_if_fail (package_id != NULL);
+
+	/* the name is the first section of the package-id */
+	tmp = strchr (package_id, ';');
+	name = g_utf8_strdown (package_id, tmp != NULL ? tmp - package_id : -1);
+	if (summary == NULL)
+		summary = "";
+	summary_down = g_utf8_strdown (summary, -1);
+	description = g_hash_table_lookup (index->descriptions, package_id);
+	if (description != NULL)
+		description_down = g_utf8_strdown (description, -1);
+
+	doc = g_new0 (GpkDetailsIndexDoc, 1);
+	doc->package_id = g_strdup (package_id);
+	doc->summary = g_strdup (summary);
+	doc->info = info;
+	text = g_string_new (name);
+	doc->name_end = text->len;
+	g_string_append_c (text, '\n');
+	g_string_append (text, summary_down);
+	doc->summary_end = text->len;
+	if (description_down != NULL) {
+		g_string_append_c (text, '\n');
+		g_string_append (text, description_down);
+	}
+	doc->text = g_string_free (text, FALSE);
+
+	/* the old postings are left behind and skipped when searching */
+	doc_id = g_hash_table_lookup (index->doc_ids, package_id);
+	if (doc_id != NULL) {
+		guint i = GPOINTER_TO_UINT (doc_id) - 1;
+		g_hash_table_remove (index->doc_ids, package_id);
+		gpk_details_index_doc_free (index->docs->pdata[i]);
+		index->docs->pdata[i] = NULL;
+		index->n_dead++;
+	}
+	g_ptr_array_add (index->docs, doc);
+	g_hash_table_insert (index->doc_ids, doc->package_id,
+			     GUINT_TO_POINTER (index->docs->len));
+	gpk_details_index_post (index, index->docs->len - 1, doc);
+
+	if (index->n_dead > GPK_DETAILS_INDEX_COMPACT_MIN &&
+	    index->n_dead > index->docs->len / 2)
+		gpk_details_index_compact (index);
+}
+
+/**
+ * gpk_details_index_add_details:
+ *
+ * Remembers the description of a package, e.g. from GetDetails, and
+ * re-indexes the package if it has already been added.
+ **/
+void
+gpk_details_index_add_details (GpkDetailsIndex *index, PkDetails *item)
+{
+	GpkDetailsIndexDoc *doc;
+	const gchar *package_id;
+	const gchar *description;
+	gpointer doc_id;
+
+	g_return_if_fail (GPK_IS_DETAILS_INDEX (index));
+	g_return_if_fail (PK_IS_DETAILS (item));
+
+	package_id = pk_details_get_package_id (item);
+	description = pk_details_get_description (item);
+	if (package_id == NULL || description == NULL)
+		return;
+	if (g_strcmp0 (g_hash_table_lookup (index->descriptions, package_id), description) == 0)
+		return;
+	g_hash_table_insert (index->descriptions, g_strdup (package_id), g_strdup (description));
+
+	doc_id = g_hash_table_lookup (index->doc_ids, package_id);
+	if (doc_id == NULL)
+		return;
+	doc = g_ptr_array_index (index->docs, GPOINTER_TO_UINT (doc_id) - 1);
+	gpk_details_index_add (index, package_id, doc->info, doc->summary);
+}
+
+/**
+ * gpk_details_index_clear:
+ *
+ * Removes all the packages, e.g. when the repo metadata has changed.
+ * The descriptions of the packages that were indexed are kept, as they
+ * are keyed by the full package-id and most will be added again.
+ **/
+void
+gpk_details_index_clear (GpkDetailsIndex *index)
+{
+	g_return_if_fail (GPK_IS_DETAILS_INDEX (index));
+
+	gpk_details_index_prune_descriptions (index);
+	g_hash_table_remove_all (index->doc_ids);
+	g_hash_table_remove_all (index->postings);
+	g_ptr_array_set_size (index->docs, 0);
+	index->n_dead = 0;
+}
+
+guint
+gpk_details_index_get_size (GpkDetailsIndex *index)
+{
+	g_return_val_if_fail (GPK_IS_DETAILS_INDEX (index), 0);
+	return g_hash_table_size (index->doc_ids);
+}
+
+static guint
+gpk_details_index_score (GpkDetailsIndexDoc *doc, gchar **terms)
+{
+	const gchar *match;
+	guint score = 0;
+	guint i;
+
+	for (i = 0; terms[i] != NULL; i++) {
+		match = strstr (doc->text, terms[i]);
+		if (match == NULL)
+			return 0;
+
+		/* the first match is always in the best section */
+		if ((gsize) (match - doc->text) < doc->name_end) {
+			if (doc->name_end == strlen (terms[i]))
+				score += GPK_DETAILS_INDEX_SCORE_NAME_EXACT;
+			else
+				score += GPK_DETAILS_INDEX_SCORE_NAME;
+		} else if ((gsize) (match - doc->text) < doc->summary_end) {
+			score += GPK_DETAILS_INDEX_SCORE_SUMMARY;
+		} else {
+			score += GPK_DETAILS_INDEX_SCORE_DESCRIPTION;
+		}
+	}
+	return score;
+}
+
+static gint
+gpk_details_index_match_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const GpkDetailsIndexMatch *match_a = a;
+	const GpkDetailsIndexMatch *match_b = b;
+	if (match_a->score != match_b->score)
+		return match_a->score > match_b->score ? -1 : 1;
+	return g_strcmp0 (match_a->doc->package_id, match_b->doc->package_id);
+}
+
+/**
+ * gpk_details_index_search:
+ * @values: the search terms
+ *
+ * Finds the packages where every one of @values appears in the name,
+ * summary or description, ignoring case. The rarest trigram of all the
+ * terms picks the candidates, which are then checked with strstr().
+ *
+ * Return value: (transfer container) (element-type PkPackage): the
+ * matching packages, best match first
+ **/
+GPtrArray *
+gpk_details_index_search (GpkDetailsIndex *index, gchar **values)
+{
+	GArray *posting;
+	GArray *candidates = NULL;
+	GPtrArray *array;
+	guint i;
+	guint j;
+	g_auto(GStrv) terms = NULL;
+	g_autoptr(GArray) matches = NULL;
+
+	g_return_val_if_fail (GPK_IS_DETAILS_INDEX (index), NULL);
+	g_return_val_if_fail (values != NULL, NULL);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	terms = g_new0 (gchar *, g_strv_length (values) + 1);
+	for (i = 0; values[i] != NULL; i++)
+		terms[i] = g_utf8_strdown (values[i], -1);
+	if (terms[0] == NULL)
+		return array;
+
+	/* a trigram nothing has means there are no results */
+	for (i = 0; terms[i] != NULL; i++) {
+		gsize len = strlen (terms[i]);
+		for (j = 0; j + 2 < len; j++) {
+			guint32 trigram = gpk_details_index_trigram (terms[i] + j);
+			posting = g_hash_table_lookup (index->postings, GUINT_TO_POINTER (trigram));
+			if (posting == NULL)
+				return array;
+			if (candidates == NULL || posting->len < candidates->len)
+				candidates = posting;
+		}
+	}
+
+	/* every term is too short, so check everything */
+	matches = g_array_new (FALSE, FALSE, sizeof (GpkDetailsIndexMatch));
+	for (i = 0; i < (candidates != NULL ? candidates->len : index->docs->len); i++) {
+		GpkDetailsIndexMatch match;
+		guint32 doc_id = candidates != NULL ? g_array_index (candidates, guint32, i) : i;
+
+		match.doc = g_ptr_array_index (index->docs, doc_id);
+		if (match.doc == NULL)
+			continue;
+		match.score = gpk_details_index_score (match.doc, terms);
+		if (match.score == 0)
+			continue;
+		g_array_append_val (matches, match);
+	}
+	g_array_sort (matches, gpk_details_index_match_sort_cb);
+
+	for (i = 0; i < matches->len; i++) {
+		GpkDetailsIndexMatch *match = &g_array_index (matches, GpkDetailsIndexMatch, i);
+		PkPackage *package = pk_package_new ();
+		if (!pk_package_set_id (package, match->doc->package_id, NULL)) {
+			g_object_unref (package);
+			continue;
+		}
+		pk_package_set_info (package, match->doc->info);
+		pk_package_set_summary (package, match->doc->summary);
+		g_ptr_array_add (array, package);
+	}
+	return array;
+}
+
+static void
+gpk_details_index_finalize (GObject *object)
+{
+	GpkDetailsIndex *index = GPK_DETAILS_INDEX (object);
+
+	g_hash_table_unref (index->doc_ids);
+	g_hash_table_unref (index->postings);
+	g_hash_table_unref (index->descriptions);
+	g_ptr_array_unref (index->docs);
+
+	G_OBJECT_CLASS (gpk_details_index_parent_class)->finalize (object);
+}
+
+static void
+gpk_details_index_class_init (GpkDetailsIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_details_index_finalize;
+}
+
+static void
+gpk_details_index_init (GpkDetailsIndex *index)
+{
+	index->docs = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_details_index_doc_free);
+	index->doc_ids = g_hash_table_new (g_str_hash, g_str_equal);
+	index->postings = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+						 NULL, (GDestroyNotify) g_array_unref);
+	index->descriptions = g_hash_table_new_full (g_str_hash, g_str_equal,
+						     g_free, g_free);
+}
+
+GpkDetailsIndex *
+gpk_details_index_new (void)
+{
+	return g_object_new (GPK_TYPE_DETAILS_INDEX, NULL);
+}
@@ -0,0 +1,47 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GPK_DETAILS_INDEX_H
+#define GPK_DETAILS_INDEX_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_DETAILS_INDEX (gpk_details_index_get_type())
+G_DECLARE_FINAL_TYPE (GpkDetailsIndex, gpk_details_index, GPK, DETAILS_INDEX, GObject)
+
+GpkDetailsIndex	*gpk_details_index_new			(void);
+void		 gpk_details_index_add			(GpkDetailsIndex	*index,
+							 const gchar		*package_id,
+							 PkInfoEnum		 info,
+							 const gchar		*summary);
+void		 gpk_details_index_add_details		(GpkDetailsIndex	*index,
+							 PkDetails		*item);
+void		 gpk_details_index_clear		(GpkDetailsIndex	*index);
+guint		 gpk_details_index_get_size		(GpkDetailsIndex	*index);
+GPtrArray	*gpk_details_index_search		(GpkDetailsIndex	*index,
+							 gchar			**values);
+
+G_END_DECLS
+
+#endif /* GPK_DETAILS_INDEX_H */
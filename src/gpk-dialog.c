@@ -49,13 +49,12 @@ gpk_dialog_package_id_name_join_locale (gchar **package_ids)
 	length = g_strv_length (package_ids);
 	array = g_ptr_array_new_with_free_func (g_free);
 	for (i = 0; i < length; i++) {
-		g_auto(GStrv) split = NULL;
-		split = pk_package_id_split (package_ids[i]);
-		if (split == NULL) {
+		GpkPackageIdView view;
+		if (!gpk_package_id_view_init (&view, package_ids[i])) {
 			g_warning ("failed to split %s", package_ids[i]);
 			continue;
 		}
-		g_ptr_array_add (array, g_strdup (split[0]));
+		g_ptr_array_add (array, gpk_package_id_view_dup (&view, PK_PACKAGE_ID_NAME));
 	}
 	array_strv = pk_ptr_array_to_strv (array);
 	text = gpk_strv_join_locale (array_strv);
@@ -73,28 +72,21 @@ gpk_dialog_package_array_to_list_store (GPtrArray *array)
 	GtkTreeIter iter;
 	PkPackage *item;
 	const gchar *icon;
+	const gchar *package_id;
 	guint i;
-	PkInfoEnum info;
 
 	store = gtk_list_store_new (GPK_DIALOG_STORE_LAST, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
 
 	/* add each well */
 	for (i = 0; i < array->len; i++) {
-		g_auto(GStrv) split = NULL;
 		g_autofree gchar *text = NULL;
-		g_autofree gchar *package_id = NULL;
-		g_autofree gchar *summary = NULL;
 		item = g_ptr_array_index (array, i);
-		g_object_get (item,
-			      "info", &info,
-			      "package-id", &package_id,
-			      "summary", &summary,
-			      NULL);
-		text = gpk_package_id_format_twoline (NULL, package_id, summary);
+		package_id = pk_package_get_id (item);
+		text = gpk_package_id_format_twoline (NULL, package_id,
+						      pk_package_get_summary (item));
 
 		/* get the icon */
-		split = pk_package_id_split (package_id);
-		icon = gpk_info_enum_to_icon_name (info);
+		icon = gpk_info_enum_to_icon_name (pk_package_get_info (item));
 
 		gtk_list_store_append (store, &iter);
 		gtk_list_store_set (store, &iter,
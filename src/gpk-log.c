@@ -332,7 +332,7 @@ gpk_log_filter (PkTransactionPast *item)
 	packages = g_strsplit (data, "\n", 0);
 	length = g_strv_length (packages);
 	for (i = 0; i < length; i++) {
-		g_auto(GStrv) split = NULL;
+		GpkPackageIdView view;
 		g_auto(GStrv) sections = NULL;
 		sections = g_strsplit (packages[i], "\t", 0);
 
@@ -341,12 +341,10 @@ gpk_log_filter (PkTransactionPast *item)
 			ret = TRUE;
 
 		/* check to see if package name, version or arch matches */
-		split = pk_package_id_split (sections[1]);
-		if (g_strrstr (split[0], filter) != NULL)
-			ret = TRUE;
-		if (split[1] != NULL && g_strrstr (split[1], filter) != NULL)
-			ret = TRUE;
-		if (split[2] != NULL && g_strrstr (split[2], filter) != NULL)
+		if (gpk_package_id_view_init (&view, sections[1]) &&
+		    (gpk_package_id_view_contains (&view, PK_PACKAGE_ID_NAME, filter) ||
+		     gpk_package_id_view_contains (&view, PK_PACKAGE_ID_VERSION, filter) ||
+		     gpk_package_id_view_contains (&view, PK_PACKAGE_ID_ARCH, filter)))
 			ret = TRUE;
 
 		/* shortcut for speed */
@@ -0,0 +1,511 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "gpk-name-index.h"
+
+/* bump this if the layout below changes */
+#define GPK_NAME_INDEX_VERSION	1
+
+/* package-id, info, summary */
+#define GPK_NAME_INDEX_ENTRY_TYPE	"(sus)"
+
+/* version, built, filters, entries, names, offsets
+ *
+ * The names are the lowercase package names in the same order as the
+ * entries, each one terminated by a newline, so that a single strstr()
+ * over the mapped data finds every match. The offsets have one extra
+ * element holding the length of the names so that entry i always spans
+ * offsets[i] to offsets[i+1]. */
+#define GPK_NAME_INDEX_TYPE	"(uxt"						\
+				"a" GPK_NAME_INDEX_ENTRY_TYPE			\
+				"ay"						\
+				"au"						\
+				")"
+
+struct _GpkNameIndex
+{
+	GObject			 parent_instance;
+	gchar			*filename;
+	GVariant		*root;
+	GVariant		*entries;
+	const gchar		*names;
+	const guint32		*offsets;
+	gsize			 n_entries;
+	gint64			 built;
+	PkBitfield		 filters;
+	gboolean		 stale;
+};
+
+G_DEFINE_TYPE (GpkNameIndex, gpk_name_index, G_TYPE_OBJECT)
+
+static void
+gpk_name_index_clear (GpkNameIndex *index)
+{
+	g_clear_pointer (&index->entries, g_variant_unref);
+	g_clear_pointer (&index->root, g_variant_unref);
+	index->names = NULL;
+	index->offsets = NULL;
+	index->n_entries = 0;
+	index->built = 0;
+	index->filters = 0;
+	index->stale = FALSE;
+}
+
+/**
+ * gpk_name_index_load:
+ *
+ * Maps the index file into memory. Nothing is copied; searches run
+ * directly over the mapped data.
+ **/
+gboolean
+gpk_name_index_load (GpkNameIndex *index, GError **error)
+{
+	const gchar *names;
+	const guint32 *offsets;
+	gsize n_offsets;
+	gsize names_len;
+	gsize i;
+	gint64 built;
+	guint32 version;
+	guint64 filters;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+	g_autoptr(GVariant) root = NULL;
+	g_autoptr(GVariant) entries = NULL;
+	g_autoptr(GVariant) names_value = NULL;
+	g_autoptr(GVariant) offsets_value = NULL;
+
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), FALSE);
+
+	mapped_file = g_mapped_file_new (index->filename, FALSE, error);
+	if (mapped_file == NULL)
+		return FALSE;
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	root = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GPK_NAME_INDEX_TYPE),
+							     bytes, FALSE));
+	g_variant_get_child (root, 0, "u", &version);
+	if (version != GPK_NAME_INDEX_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "index version %u is not supported", version);
+		return FALSE;
+	}
+	g_variant_get_child (root, 1, "x", &built);
+	g_variant_get_child (root, 2, "t", &filters);
+	entries = g_variant_get_child_value (root, 3);
+	names_value = g_variant_get_child_value (root, 4);
+	offsets_value = g_variant_get_child_value (root, 5);
+
+	/* the search trusts these, so check them once here */
+	names = g_variant_get_bytestring (names_value);
+	names_len = strlen (names);
+	offsets = g_variant_get_fixed_array (offsets_value, &n_offsets, sizeof (guint32));
+	if (n_offsets != g_variant_n_children (entries) + 1 ||
+	    offsets[0] != 0 || offsets[n_offsets - 1] != names_len) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "index %s is corrupt", index->filename);
+		return FALSE;
+	}
+	for (i = 1; i < n_offsets; i++) {
+		if (offsets[i] <= offsets[i - 1] || names[offsets[i] - 1] != '\n') {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+				     "index %s is corrupt at entry %" G_GSIZE_FORMAT,
+				     index->filename, i - 1);
+			return FALSE;
+		}
+	}
+
+	gpk_name_index_clear (index);
+	index->root = g_steal_pointer (&root);
+	index->entries = g_steal_pointer (&entries);
+	index->names = names;
+	index->offsets = offsets;
+	index->n_entries = n_offsets - 1;
+	index->built = built;
+	index->filters = filters;
+	g_debug ("loaded %" G_GSIZE_FORMAT " names from %s",
+		 index->n_entries, index->filename);
+	return TRUE;
+}
+
+typedef struct {
+	gchar			*name;
+	PkPackage		*package;
+} GpkNameIndexRow;
+
+typedef struct {
+	gchar			*filename;
+	GPtrArray		*packages;
+	PkBitfield		 filters;
+} GpkNameIndexRebuildHelper;
+
+static void
+gpk_name_index_rebuild_helper_free (GpkNameIndexRebuildHelper *helper)
+{
+	g_free (helper->filename);
+	g_ptr_array_unref (helper->packages);
+	g_free (helper);
+}
+
+static gint
+gpk_name_index_row_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const GpkNameIndexRow *row_a = a;
+	const GpkNameIndexRow *row_b = b;
+	return g_strcmp0 (row_a->name, row_b->name);
+}
+
+static void
+gpk_name_index_rebuild_thread_cb (GTask *task,
+				  gpointer source_object,
+				  gpointer task_data,
+				  GCancellable *cancellable)
+{
+	GpkNameIndexRebuildHelper *helper = task_data;
+	GVariantBuilder builder_entries;
+	GError *error = NULL;
+	guint32 names_len;
+	guint i;
+	g_autoptr(GArray) rows = NULL;
+	g_autoptr(GArray) offsets = NULL;
+	g_autoptr(GString) names = NULL;
+	g_autoptr(GVariant) root = NULL;
+	g_autofree gchar *dirname = NULL;
+
+	/* sorted so equal names end up next to each other in the file */
+	rows = g_array_sized_new (FALSE, FALSE, sizeof (GpkNameIndexRow),
+				  helper->packages->len);
+	for (i = 0; i < helper->packages->len; i++) {
+		GpkNameIndexRow row;
+		const gchar *name;
+
+		row.package = g_ptr_array_index (helper->packages, i);
+		name = pk_package_get_name (row.package);
+		if (name == NULL || name[0] == '\0' || strchr (name, '\n') != NULL)
+			continue;
+		row.name = g_ascii_strdown (name, -1);
+		g_array_append_val (rows, row);
+	}
+	g_array_sort (rows, gpk_name_index_row_sort_cb);
+
+	g_variant_builder_init (&builder_entries, G_VARIANT_TYPE ("a" GPK_NAME_INDEX_ENTRY_TYPE));
+	names = g_string_sized_new (rows->len * 16);
+	offsets = g_array_sized_new (FALSE, FALSE, sizeof (guint32), rows->len + 1);
+	for (i = 0; i < rows->len; i++) {
+		GpkNameIndexRow *row = &g_array_index (rows, GpkNameIndexRow, i);
+		const gchar *summary = pk_package_get_summary (row->package);
+		guint32 offset = names->len;
+
+		g_variant_builder_add (&builder_entries, GPK_NAME_INDEX_ENTRY_TYPE,
+				       pk_package_get_id (row->package),
+				       (guint32) pk_package_get_info (row->package),
+				       summary != NULL ? summary : "");
+		g_array_append_val (offsets, offset);
+		g_string_append (names, row->name);
+		g_string_append_c (names, '\n');
+		g_free (row->name);
+	}
+	names_len = names->len;
+	g_array_append_val (offsets, names_len);
+
+	root = g_variant_ref_sink (g_variant_new ("(uxt@*@*@*)",
+						  (guint32) GPK_NAME_INDEX_VERSION,
+						  g_get_real_time () / G_USEC_PER_SEC,
+						  (guint64) helper->filters,
+						  g_variant_builder_end (&builder_entries),
+						  g_variant_new_bytestring (names->str),
+						  g_variant_new_fixed_array (G_VARIANT_TYPE_UINT32,
+									     offsets->data,
+									     offsets->len,
+									     sizeof (guint32))));
+	if (g_task_return_error_if_cancelled (task))
+		return;
+
+	/* write the serialized data as-is so it can be mapped back */
+	dirname = g_path_get_dirname (helper->filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (errno),
+					 "failed to create %s: %s", dirname, g_strerror (errno));
+		return;
+	}
+	if (!g_file_set_contents (helper->filename,
+				  g_variant_get_data (root),
+				  g_variant_get_size (root),
+				  &error)) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * gpk_name_index_rebuild_async:
+ * @packages: (element-type PkPackage): every package, e.g. from GetPackages
+ * @filters: the filters @packages was fetched with
+ *
+ * Writes a new index file from a thread. The new file is only mapped
+ * when gpk_name_index_rebuild_finish() is called.
+ **/
+void
+gpk_name_index_rebuild_async (GpkNameIndex *index,
+			      GPtrArray *packages,
+			      PkBitfield filters,
+			      GCancellable *cancellable,
+			      GAsyncReadyCallback callback,
+			      gpointer user_data)
+{
+	GpkNameIndexRebuildHelper *helper;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (GPK_IS_NAME_INDEX (index));
+	g_return_if_fail (packages != NULL);
+
+	helper = g_new0 (GpkNameIndexRebuildHelper, 1);
+	helper->filename = g_strdup (index->filename);
+	helper->packages = g_ptr_array_ref (packages);
+	helper->filters = filters;
+
+	task = g_task_new (index, cancellable, callback, user_data);
+	g_task_set_source_tag (task, gpk_name_index_rebuild_async);
+	g_task_set_task_data (task, helper, (GDestroyNotify) gpk_name_index_rebuild_helper_free);
+	g_task_run_in_thread (task, gpk_name_index_rebuild_thread_cb);
+}
+
+gboolean
+gpk_name_index_rebuild_finish (GpkNameIndex *index, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, index), FALSE);
+
+	if (!g_task_propagate_boolean (G_TASK (res), error))
+		return FALSE;
+	return gpk_name_index_load (index, error);
+}
+
+/**
+ * gpk_name_index_invalidate:
+ *
+ * Marks the index as out of date, e.g. when the repo metadata or the
+ * installed packages have changed. The file is kept until it is rebuilt.
+ **/
+void
+gpk_name_index_invalidate (GpkNameIndex *index)
+{
+	g_return_if_fail (GPK_IS_NAME_INDEX (index));
+	index->stale = TRUE;
+}
+
+/**
+ * gpk_name_index_is_valid:
+ * @filters: the filters the search would be done with
+ *
+ * Return value: %TRUE if the index can answer a search with @filters
+ **/
+gboolean
+gpk_name_index_is_valid (GpkNameIndex *index, PkBitfield filters)
+{
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), FALSE);
+	return index->root != NULL && !index->stale && index->filters == filters;
+}
+
+/**
+ * gpk_name_index_get_built:
+ *
+ * Return value: when the loaded index was written, in seconds since the
+ * epoch, or 0 if nothing is loaded
+ **/
+gint64
+gpk_name_index_get_built (GpkNameIndex *index)
+{
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), 0);
+	return index->built;
+}
+
+guint
+gpk_name_index_get_size (GpkNameIndex *index)
+{
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), 0);
+	return index->n_entries;
+}
+
+/**
+ * gpk_name_index_get_entry:
+ * @package_id: (out): the package-id, valid until the index is reloaded
+ * @info: (out): the package info
+ * @summary: (out): the summary, valid until the index is reloaded
+ *
+ * Gets an entry without creating a #PkPackage, e.g. to index it again.
+ **/
+void
+gpk_name_index_get_entry (GpkNameIndex *index,
+			  guint idx,
+			  const gchar **package_id,
+			  PkInfoEnum *info,
+			  const gchar **summary)
+{
+	guint32 tmp;
+
+	g_return_if_fail (GPK_IS_NAME_INDEX (index));
+	g_return_if_fail (idx < index->n_entries);
+
+	g_variant_get_child (index->entries, idx, "(&su&s)",
+			     package_id, &tmp, summary);
+	*info = tmp;
+}
+
+static gsize
+gpk_name_index_find_entry (GpkNameIndex *index, guint32 offset)
+{
+	gsize lower = 0;
+	gsize upper = index->n_entries;
+
+	/* the last entry starting at or before offset */
+	while (upper - lower > 1) {
+		gsize mid = lower + (upper - lower) / 2;
+		if (index->offsets[mid] <= offset)
+			lower = mid;
+		else
+			upper = mid;
+	}
+	return lower;
+}
+
+/**
+ * gpk_name_index_search:
+ * @values: the search terms
+ *
+ * Finds the packages whose name contains all of @values, ignoring case,
+ * which is what the backends do for SearchNames.
+ *
+ * Return value: (transfer container) (element-type PkPackage): the
+ * matching packages, or %NULL if there is no index loaded
+ **/
+GPtrArray *
+gpk_name_index_search (GpkNameIndex *index, gchar **values)
+{
+	const gchar *needle = NULL;
+	const gchar *match;
+	GPtrArray *array;
+	guint i;
+	g_auto(GStrv) terms = NULL;
+
+	g_return_val_if_fail (GPK_IS_NAME_INDEX (index), NULL);
+	g_return_val_if_fail (values != NULL, NULL);
+
+	if (index->root == NULL)
+		return NULL;
+
+	/* scan for the longest term as it matches the fewest names */
+	terms = g_new0 (gchar *, g_strv_length (values) + 1);
+	for (i = 0; values[i] != NULL; i++) {
+		terms[i] = g_ascii_strdown (values[i], -1);
+		if (needle == NULL || strlen (terms[i]) > strlen (needle))
+			needle = terms[i];
+	}
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	if (needle == NULL || needle[0] == '\0')
+		return array;
+
+	match = index->names;
+	while ((match = strstr (match, needle)) != NULL) {
+		const gchar *package_id;
+		const gchar *summary;
+		const gchar *name;
+		gsize entry;
+		gsize name_len;
+		guint32 info;
+		gboolean ret = TRUE;
+		PkPackage *package;
+
+		/* terms never contain a newline so the match is inside one name */
+		entry = gpk_name_index_find_entry (index, match - index->names);
+		name = index->names + index->offsets[entry];
+		name_len = index->offsets[entry + 1] - index->offsets[entry] - 1;
+		match = index->names + index->offsets[entry + 1];
+		for (i = 0; terms[i] != NULL && ret; i++) {
+			if (terms[i] != needle)
+				ret = g_strstr_len (name, name_len, terms[i]) != NULL;
+		}
+		if (!ret)
+			continue;
+
+		g_variant_get_child (index->entries, entry, "(&su&s)",
+				     &package_id, &info, &summary);
+		package = pk_package_new ();
+		if (!pk_package_set_id (package, package_id, NULL)) {
+			g_object_unref (package);
+			continue;
+		}
+		pk_package_set_info (package, info);
+		pk_package_set_summary (package, summary);
+		g_ptr_array_add (array, package);
+	}
+	return array;
+}
+
+static void
+gpk_name_index_finalize (GObject *object)
+{
+	GpkNameIndex *index = GPK_NAME_INDEX (object);
+
+	g_free (index->filename);
+	gpk_name_index_clear (index);
+
+	G_OBJECT_CLASS (gpk_name_index_parent_class)->finalize (object);
+}
+
+static void
+gpk_name_index_class_init (GpkNameIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_name_index_finalize;
+}
+
+static void
+gpk_name_index_init (GpkNameIndex *index)
+{
+}
+
+/**
+ * gpk_name_index_new:
+ * @filename: (allow-none): the index file, or %NULL for the default
+ **/
+GpkNameIndex *
+gpk_name_index_new (const gchar *filename)
+{
+	GpkNameIndex *index;
+	index = g_object_new (GPK_TYPE_NAME_INDEX, NULL);
+	if (filename != NULL)
+		index->filename = g_strdup (filename);
+	else
+		index->filename = g_build_filename (g_get_user_cache_dir (),
+						    "gnome-packagekit",
+						    "application-names.index",
+						    NULL);
+	return index;
+}
@@ -0,0 +1,60 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GPK_NAME_INDEX_H
+#define GPK_NAME_INDEX_H
+
+#include <gio/gio.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_NAME_INDEX (gpk_name_index_get_type())
+G_DECLARE_FINAL_TYPE (GpkNameIndex, gpk_name_index, GPK, NAME_INDEX, GObject)
+
+GpkNameIndex	*gpk_name_index_new			(const gchar	*filename);
+gboolean	 gpk_name_index_load			(GpkNameIndex	*index,
+							 GError		**error);
+void		 gpk_name_index_rebuild_async		(GpkNameIndex	*index,
+							 GPtrArray	*packages,
+							 PkBitfield	 filters,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 gpk_name_index_rebuild_finish		(GpkNameIndex	*index,
+							 GAsyncResult	*res,
+							 GError		**error);
+void		 gpk_name_index_invalidate		(GpkNameIndex	*index);
+gboolean	 gpk_name_index_is_valid		(GpkNameIndex	*index,
+							 PkBitfield	 filters);
+gint64		 gpk_name_index_get_built		(GpkNameIndex	*index);
+guint		 gpk_name_index_get_size		(GpkNameIndex	*index);
+void		 gpk_name_index_get_entry		(GpkNameIndex	*index,
+							 guint		 idx,
+							 const gchar	**package_id,
+							 PkInfoEnum	*info,
+							 const gchar	**summary);
+GPtrArray	*gpk_name_index_search			(GpkNameIndex	*index,
+							 gchar		**values);
+
+G_END_DECLS
+
+#endif /* GPK_NAME_INDEX_H */
@@ -0,0 +1,863 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "gpk-common.h"
+#include "gpk-package-model.h"
+
+/* keep this small, there is one per result row */
+typedef struct {
+	const gchar	*package_id;	/* in strings */
+	const gchar	*summary;	/* in strings, shared between rows */
+	const gchar	*text;		/* in strings, only set for help rows */
+	const gchar	*icon;		/* interned */
+	guint32		 state;
+	guint		 checkbox:1;
+	guint		 checkbox_visible:1;
+} GpkPackageModelItem;
+
+struct _GpkPackageModel
+{
+	GObject			 parent_instance;
+	GArray			*items;		/* of GpkPackageModelItem */
+	GStringChunk		*strings;
+	guint			 rows_dead;	/* removed, strings still in the chunk */
+	GHashTable		*index;		/* package-id:row+1 */
+	gboolean		 index_valid;
+	GtkStyleContext		*style;
+	gint			 sort_column_id;
+	GtkSortType		 sort_order;
+	guint			 sort_frozen;	/* rows are appended until thawed */
+	gint			 stamp;
+};
+
+static void gpk_package_model_tree_model_init (GtkTreeModelIface *iface);
+static void gpk_package_model_tree_sortable_init (GtkTreeSortableIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (GpkPackageModel, gpk_package_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						gpk_package_model_tree_model_init)
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_SORTABLE,
+						gpk_package_model_tree_sortable_init))
+
+#define GPK_PACKAGE_MODEL_ITEM(model,idx)	(&g_array_index ((model)->items, GpkPackageModelItem, (idx)))
+
+static void
+gpk_package_model_iter_set (GpkPackageModel *model, GtkTreeIter *iter, guint idx)
+{
+	iter->stamp = model->stamp;
+	iter->user_data = GUINT_TO_POINTER (idx);
+	iter->user_data2 = NULL;
+	iter->user_data3 = NULL;
+}
+
+static void
+gpk_package_model_index_add (GpkPackageModel *model, guint idx)
+{
+	GpkPackageModelItem *item = GPK_PACKAGE_MODEL_ITEM (model, idx);
+
+	/* the first row wins if a package is shown twice */
+	if (item->package_id == NULL || g_hash_table_contains (model->index, item->package_id))
+		return;
+	g_hash_table_insert (model->index, (gpointer) item->package_id,
+			     GUINT_TO_POINTER (idx + 1));
+}
+
+static void
+gpk_package_model_index_invalidate (GpkPackageModel *model)
+{
+	if (!model->index_valid)
+		return;
+	g_hash_table_remove_all (model->index);
+	model->index_valid = FALSE;
+}
+
+static gboolean
+gpk_package_model_iter_is_valid (GpkPackageModel *model, GtkTreeIter *iter)
+{
+	if (iter == NULL || iter->stamp != model->stamp)
+		return FALSE;
+	return GPOINTER_TO_UINT (iter->user_data) < model->items->len;
+}
+
+static GtkTreeModelFlags
+gpk_package_model_get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint
+gpk_package_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return GPK_PACKAGE_MODEL_COLUMN_LAST;
+}
+
+static GType
+gpk_package_model_get_column_type (GtkTreeModel *tree_model, gint column)
+{
+	switch (column) {
+	case GPK_PACKAGE_MODEL_COLUMN_STATE:
+		return G_TYPE_UINT64;
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX:
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE:
+		return G_TYPE_BOOLEAN;
+	case GPK_PACKAGE_MODEL_COLUMN_IMAGE:
+	case GPK_PACKAGE_MODEL_COLUMN_TEXT:
+	case GPK_PACKAGE_MODEL_COLUMN_ID:
+	case GPK_PACKAGE_MODEL_COLUMN_SUMMARY:
+		return G_TYPE_STRING;
+	default:
+		break;
+	}
+	return G_TYPE_INVALID;
+}
+
+static gboolean
+gpk_package_model_get_iter (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	gint idx;
+
+	if (gtk_tree_path_get_depth (path) != 1)
+		return FALSE;
+	idx = gtk_tree_path_get_indices (path)[0];
+	if (idx < 0 || (guint) idx >= model->items->len)
+		return FALSE;
+	gpk_package_model_iter_set (model, iter, idx);
+	return TRUE;
+}
+
+static GtkTreePath *
+gpk_package_model_get_path (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	g_return_val_if_fail (gpk_package_model_iter_is_valid (model, iter), NULL);
+	return gtk_tree_path_new_from_indices (GPOINTER_TO_INT (iter->user_data), -1);
+}
+
+static void
+gpk_package_model_get_value (GtkTreeModel *tree_model, GtkTreeIter *iter,
+			     gint column, GValue *value)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	GpkPackageModelItem *item;
+
+	g_return_if_fail (gpk_package_model_iter_is_valid (model, iter));
+
+	item = GPK_PACKAGE_MODEL_ITEM (model, GPOINTER_TO_UINT (iter->user_data));
+	g_value_init (value, gpk_package_model_get_column_type (tree_model, column));
+	switch (column) {
+	case GPK_PACKAGE_MODEL_COLUMN_IMAGE:
+		g_value_set_static_string (value, item->icon);
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_STATE:
+		g_value_set_uint64 (value, item->state);
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX:
+		g_value_set_boolean (value, item->checkbox);
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE:
+		g_value_set_boolean (value, item->checkbox_visible);
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_TEXT:
+		if (item->text != NULL || item->package_id == NULL) {
+			g_value_set_string (value, item->text);
+			break;
+		}
+		/* only build the markup when the row is actually drawn */
+		g_value_take_string (value, gpk_package_id_format_twoline (model->style,
+									   item->package_id,
+									   item->summary));
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_ID:
+		g_value_set_string (value, item->package_id);
+		break;
+	case GPK_PACKAGE_MODEL_COLUMN_SUMMARY:
+		g_value_set_string (value, item->summary);
+		break;
+	default:
+		g_warning ("invalid column %i", column);
+		break;
+	}
+}
+
+static gboolean
+gpk_package_model_iter_next (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	guint idx = GPOINTER_TO_UINT (iter->user_data) + 1;
+
+	if (idx >= model->items->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_package_model_iter_set (model, iter, idx);
+	return TRUE;
+}
+
+static gboolean
+gpk_package_model_iter_previous (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	guint idx = GPOINTER_TO_UINT (iter->user_data);
+
+	if (idx == 0) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_package_model_iter_set (model, iter, idx - 1);
+	return TRUE;
+}
+
+static gboolean
+gpk_package_model_iter_nth_child (GtkTreeModel *tree_model, GtkTreeIter *iter,
+				  GtkTreeIter *parent, gint n)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+
+	/* a flat list */
+	if (parent != NULL || n < 0 || (guint) n >= model->items->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_package_model_iter_set (model, iter, n);
+	return TRUE;
+}
+
+static gboolean
+gpk_package_model_iter_children (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return gpk_package_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gboolean
+gpk_package_model_iter_has_child (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	return FALSE;
+}
+
+static gint
+gpk_package_model_iter_n_children (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (tree_model);
+	if (iter != NULL)
+		return 0;
+	return model->items->len;
+}
+
+static gboolean
+gpk_package_model_iter_parent (GtkTreeModel *tree_model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	iter->stamp = 0;
+	return FALSE;
+}
+
+static gint
+gpk_package_model_compare (GpkPackageModel *model,
+			   const GpkPackageModelItem *a,
+			   const GpkPackageModelItem *b)
+{
+	gint rc = 0;
+
+	/* the markup starts with the summary, so sort on that */
+	if (model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_TEXT)
+		rc = g_strcmp0 (a->summary, b->summary);
+	if (rc == 0)
+		rc = g_strcmp0 (a->package_id, b->package_id);
+	if (model->sort_order == GTK_SORT_DESCENDING)
+		return -rc;
+	return rc;
+}
+
+static gint
+gpk_package_model_compare_index_cb (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (user_data);
+	return gpk_package_model_compare (model,
+					  GPK_PACKAGE_MODEL_ITEM (model, *((const gint *) a)),
+					  GPK_PACKAGE_MODEL_ITEM (model, *((const gint *) b)));
+}
+
+static gboolean
+gpk_package_model_is_sorted (GpkPackageModel *model)
+{
+	return model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_ID ||
+	       model->sort_column_id == GPK_PACKAGE_MODEL_COLUMN_TEXT;
+}
+
+static void
+gpk_package_model_sort_tail (GpkPackageModel *model, guint sorted)
+{
+	GArray *items;
+	GtkTreePath *path;
+	guint i;
+	guint j;
+	guint len = model->items->len;
+	g_autofree gint *new_order = NULL;
+	g_autofree gint *tail = NULL;
+
+	if (len < 2 || sorted >= len || !gpk_package_model_is_sorted (model))
+		return;
+
+	/* sort a permutation of the unsorted rows, then merge it with the
+	 * sorted ones, so the view can be told where each row went */
+	tail = g_new (gint, len - sorted);
+	for (i = sorted; i < len; i++)
+		tail[i - sorted] = i;
+	g_qsort_with_data (tail, len - sorted, sizeof (gint),
+			   gpk_package_model_compare_index_cb, model);
+	new_order = g_new (gint, len);
+	for (i = 0, j = 0; i + j < len; ) {
+		if (j == len - sorted ||
+		    (i < sorted && gpk_package_model_compare (model,
+							       GPK_PACKAGE_MODEL_ITEM (model, i),
+							       GPK_PACKAGE_MODEL_ITEM (model, tail[j])) <= 0)) {
+			new_order[i + j] = i;
+			i++;
+		} else {
+			new_order[i + j] = tail[j];
+			j++;
+		}
+	}
+
+	/* already in order */
+	for (i = 0; i < len; i++) {
+		if (new_order[i] != (gint) i)
+			break;
+	}
+	if (i == len)
+		return;
+
+	items = g_array_sized_new (FALSE, FALSE, sizeof (GpkPackageModelItem), len);
+	for (i = 0; i < len; i++)
+		g_array_append_vals (items, GPK_PACKAGE_MODEL_ITEM (model, new_order[i]), 1);
+	g_array_unref (model->items);
+	model->items = items;
+	model->stamp++;
+	gpk_package_model_index_invalidate (model);
+
+	path = gtk_tree_path_new ();
+	gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path, NULL, new_order);
+	gtk_tree_path_free (path);
+}
+
+static void
+gpk_package_model_sort (GpkPackageModel *model)
+{
+	gpk_package_model_sort_tail (model, 0);
+}
+
+static guint
+gpk_package_model_get_insert_position (GpkPackageModel *model, const GpkPackageModelItem *item)
+{
+	guint lower = 0;
+	guint upper = model->items->len;
+	guint middle;
+
+	if (!gpk_package_model_is_sorted (model) || model->sort_frozen > 0)
+		return upper;
+
+	/* after any equal rows, like GtkListStore */
+	while (lower < upper) {
+		middle = lower + (upper - lower) / 2;
+		if (gpk_package_model_compare (model, GPK_PACKAGE_MODEL_ITEM (model, middle), item) <= 0)
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+	return lower;
+}
+
+static void
+gpk_package_model_set_valist (GpkPackageModel *model, GpkPackageModelItem *item, va_list args)
+{
+	const gchar *tmp;
+	gint column;
+
+	while ((column = va_arg (args, gint)) != -1) {
+		switch (column) {
+		case GPK_PACKAGE_MODEL_COLUMN_IMAGE:
+			item->icon = g_intern_string (va_arg (args, const gchar *));
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_STATE:
+			item->state = (guint32) va_arg (args, guint64);
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX:
+			item->checkbox = va_arg (args, gboolean) ? 1 : 0;
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE:
+			item->checkbox_visible = va_arg (args, gboolean) ? 1 : 0;
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_TEXT:
+			tmp = va_arg (args, const gchar *);
+			item->text = tmp != NULL ? g_string_chunk_insert (model->strings, tmp) : NULL;
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_ID:
+			tmp = va_arg (args, const gchar *);
+			item->package_id = tmp != NULL ? g_string_chunk_insert (model->strings, tmp) : NULL;
+			break;
+		case GPK_PACKAGE_MODEL_COLUMN_SUMMARY:
+			/* the same summary is used for each arch and version */
+			tmp = va_arg (args, const gchar *);
+			item->summary = tmp != NULL ? g_string_chunk_insert_const (model->strings, tmp) : NULL;
+			break;
+		default:
+			g_warning ("invalid column %i", column);
+			return;
+		}
+	}
+}
+
+/**
+ * gpk_package_model_insert_with_values:
+ * @model: a #GpkPackageModel
+ * @iter: (out) (allow-none): the new row
+ * @...: pairs of column number and value, terminated with -1
+ *
+ * Adds a row at the sorted position, or at the end if the model is unsorted
+ * or the sort is frozen.
+ **/
+void
+gpk_package_model_insert_with_values (GpkPackageModel *model, GtkTreeIter *iter, ...)
+{
+	GpkPackageModelItem item = { NULL };
+	GtkTreeIter iter_tmp;
+	GtkTreePath *path;
+	guint pos;
+	va_list args;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	va_start (args, iter);
+	gpk_package_model_set_valist (model, &item, args);
+	va_end (args);
+
+	pos = gpk_package_model_get_insert_position (model, &item);
+	if (pos < model->items->len) {
+		model->stamp++;
+		gpk_package_model_index_invalidate (model);
+	}
+	g_array_insert_val (model->items, pos, item);
+	if (model->index_valid)
+		gpk_package_model_index_add (model, pos);
+
+	if (iter == NULL)
+		iter = &iter_tmp;
+	gpk_package_model_iter_set (model, iter, pos);
+	path = gtk_tree_path_new_from_indices (pos, -1);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (model), path, iter);
+	gtk_tree_path_free (path);
+}
+
+/**
+ * gpk_package_model_freeze_sort:
+ * @model: a #GpkPackageModel
+ *
+ * Makes inserts append rows rather than find their place, which costs a
+ * move of every row after them. Adding a lot of rows to a sorted model
+ * should be done between this and gpk_package_model_thaw_sort().
+ **/
+void
+gpk_package_model_freeze_sort (GpkPackageModel *model)
+{
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	model->sort_frozen++;
+}
+
+/**
+ * gpk_package_model_thaw_sort:
+ * @model: a #GpkPackageModel
+ *
+ * Moves the rows appended since gpk_package_model_freeze_sort() to their
+ * sorted position, with a single reorder.
+ **/
+void
+gpk_package_model_thaw_sort (GpkPackageModel *model)
+{
+	guint sorted;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	g_return_if_fail (model->sort_frozen > 0);
+
+	if (--model->sort_frozen > 0 || !gpk_package_model_is_sorted (model))
+		return;
+
+	/* the rows before the first one out of order were already sorted */
+	for (sorted = 1; sorted < model->items->len; sorted++) {
+		if (gpk_package_model_compare (model,
+					       GPK_PACKAGE_MODEL_ITEM (model, sorted - 1),
+					       GPK_PACKAGE_MODEL_ITEM (model, sorted)) > 0)
+			break;
+	}
+	gpk_package_model_sort_tail (model, sorted);
+}
+
+/**
+ * gpk_package_model_set:
+ * @model: a #GpkPackageModel
+ * @iter: a valid row
+ * @...: pairs of column number and value, terminated with -1
+ *
+ * Changes a row in place. Changing the sort key does not move the row.
+ **/
+void
+gpk_package_model_set (GpkPackageModel *model, GtkTreeIter *iter, ...)
+{
+	GpkPackageModelItem *item;
+	GtkTreePath *path;
+	const gchar *package_id;
+	guint idx;
+	va_list args;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+	g_return_if_fail (gpk_package_model_iter_is_valid (model, iter));
+
+	idx = GPOINTER_TO_UINT (iter->user_data);
+	item = GPK_PACKAGE_MODEL_ITEM (model, idx);
+	package_id = item->package_id;
+	va_start (args, iter);
+	gpk_package_model_set_valist (model, item, args);
+	va_end (args);
+
+	/* keep the index current if the row now shows another package */
+	if (g_strcmp0 (item->package_id, package_id) == 0) {
+		item->package_id = package_id;
+	} else if (model->index_valid) {
+		if (package_id != NULL &&
+		    GPOINTER_TO_UINT (g_hash_table_lookup (model->index, package_id)) == idx + 1)
+			g_hash_table_remove (model->index, package_id);
+		if (item->package_id != NULL &&
+		    g_hash_table_contains (model->index, item->package_id))
+			gpk_package_model_index_invalidate (model);
+		else
+			gpk_package_model_index_add (model, idx);
+	}
+
+	path = gtk_tree_path_new_from_indices (idx, -1);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, iter);
+	gtk_tree_path_free (path);
+}
+
+/**
+ * gpk_package_model_remove:
+ * @model: a #GpkPackageModel
+ * @iter: a valid row
+ *
+ * Return value: %TRUE if @iter now points at the next row
+ **/
+gboolean
+gpk_package_model_remove (GpkPackageModel *model, GtkTreeIter *iter)
+{
+	GtkTreePath *path;
+	guint idx;
+
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), FALSE);
+	g_return_val_if_fail (gpk_package_model_iter_is_valid (model, iter), FALSE);
+
+	/* the strings stay in the chunk until it is compacted or cleared */
+	idx = GPOINTER_TO_UINT (iter->user_data);
+	g_array_remove_index (model->items, idx);
+	model->rows_dead++;
+	model->stamp++;
+	gpk_package_model_index_invalidate (model);
+
+	path = gtk_tree_path_new_from_indices (idx, -1);
+	gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+	gtk_tree_path_free (path);
+
+	if (idx >= model->items->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+	gpk_package_model_iter_set (model, iter, idx);
+	return TRUE;
+}
+
+static void
+gpk_package_model_compact_strings (GpkPackageModel *model)
+{
+	GStringChunk *strings;
+	GpkPackageModelItem *item;
+	guint i;
+
+	/* the index keys point into the old chunk */
+	gpk_package_model_index_invalidate (model);
+	strings = g_string_chunk_new (64 * 1024);
+	for (i = 0; i < model->items->len; i++) {
+		item = GPK_PACKAGE_MODEL_ITEM (model, i);
+		if (item->package_id != NULL)
+			item->package_id = g_string_chunk_insert (strings, item->package_id);
+		if (item->summary != NULL)
+			item->summary = g_string_chunk_insert_const (strings, item->summary);
+		if (item->text != NULL)
+			item->text = g_string_chunk_insert (strings, item->text);
+	}
+	g_string_chunk_free (model->strings);
+	model->strings = strings;
+	model->rows_dead = 0;
+}
+
+/**
+ * gpk_package_model_remove_by_filter:
+ * @model: a #GpkPackageModel
+ * @filter_cb: returns %TRUE to keep the row with the package-id, which
+ * is %NULL for help rows
+ *
+ * Removes many rows at once. The array is compacted in one pass and the
+ * deletes are emitted from the end, so nothing has to be renumbered.
+ *
+ * Return value: the number of rows removed
+ **/
+guint
+gpk_package_model_remove_by_filter (GpkPackageModel *model,
+				    GpkPackageModelFilterFunc filter_cb,
+				    gpointer user_data)
+{
+	GpkPackageModelItem *item;
+	GtkTreePath *path;
+	guint i;
+	guint kept = 0;
+	g_autoptr(GArray) removed = NULL;
+
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), 0);
+	g_return_val_if_fail (filter_cb != NULL, 0);
+
+	removed = g_array_new (FALSE, FALSE, sizeof (guint));
+	for (i = 0; i < model->items->len; i++) {
+		item = GPK_PACKAGE_MODEL_ITEM (model, i);
+		if (!filter_cb (item->package_id, user_data)) {
+			g_array_append_val (removed, i);
+			continue;
+		}
+		if (kept != i)
+			*GPK_PACKAGE_MODEL_ITEM (model, kept) = *item;
+		kept++;
+	}
+	if (removed->len == 0)
+		return 0;
+	g_array_set_size (model->items, kept);
+	model->stamp++;
+	gpk_package_model_index_invalidate (model);
+
+	for (i = removed->len; i > 0; i--) {
+		path = gtk_tree_path_new_from_indices (g_array_index (removed, guint, i - 1), -1);
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+		gtk_tree_path_free (path);
+	}
+
+	/* don't let the chunk grow each time the same rows come and go */
+	model->rows_dead += removed->len;
+	if (model->rows_dead > model->items->len)
+		gpk_package_model_compact_strings (model);
+	return removed->len;
+}
+
+/**
+ * gpk_package_model_clear:
+ * @model: a #GpkPackageModel
+ **/
+void
+gpk_package_model_clear (GpkPackageModel *model)
+{
+	GtkTreePath *path;
+	guint i;
+
+	g_return_if_fail (GPK_IS_PACKAGE_MODEL (model));
+
+	/* remove from the end so nothing has to be renumbered */
+	for (i = model->items->len; i > 0; i--) {
+		g_array_set_size (model->items, i - 1);
+		model->stamp++;
+		path = gtk_tree_path_new_from_indices (i - 1, -1);
+		gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
+		gtk_tree_path_free (path);
+	}
+	g_string_chunk_clear (model->strings);
+	g_hash_table_remove_all (model->index);
+	model->index_valid = TRUE;
+	model->rows_dead = 0;
+}
+
+/**
+ * gpk_package_model_lookup:
+ * @model: a #GpkPackageModel
+ * @package_id: the package to find
+ * @iter: (out): the row showing @package_id
+ *
+ * Finds a row without walking the model. The index is kept up to date
+ * while rows are appended, and rebuilt the next time it is needed if
+ * rows are removed, moved or inserted in the middle.
+ *
+ * Return value: %TRUE if @package_id is shown
+ **/
+gboolean
+gpk_package_model_lookup (GpkPackageModel *model, const gchar *package_id, GtkTreeIter *iter)
+{
+	guint i;
+	guint idx;
+
+	g_return_val_if_fail (GPK_IS_PACKAGE_MODEL (model), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	if (!model->index_valid) {
+		for (i = 0; i < model->items->len; i++)
+			gpk_package_model_index_add (model, i);
+		model->index_valid = TRUE;
+	}
+	idx = GPOINTER_TO_UINT (g_hash_table_lookup (model->index, package_id));
+	if (idx == 0)
+		return FALSE;
+	gpk_package_model_iter_set (model, iter, idx - 1);
+	return TRUE;
+}
+
+static gboolean
+gpk_package_model_get_sort_column_id (GtkTreeSortable *sortable,
+				      gint *sort_column_id,
+				      GtkSortType *order)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (sortable);
+
+	if (sort_column_id != NULL)
+		*sort_column_id = model->sort_column_id;
+	if (order != NULL)
+		*order = model->sort_order;
+	return model->sort_column_id != GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID &&
+	       model->sort_column_id != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+}
+
+static void
+gpk_package_model_set_sort_column_id (GtkTreeSortable *sortable,
+				      gint sort_column_id,
+				      GtkSortType order)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (sortable);
+
+	if (model->sort_column_id == sort_column_id && model->sort_order == order)
+		return;
+	model->sort_column_id = sort_column_id;
+	model->sort_order = order;
+	gpk_package_model_sort (model);
+	gtk_tree_sortable_sort_column_changed (sortable);
+}
+
+static void
+gpk_package_model_set_sort_func (GtkTreeSortable *sortable,
+				 gint sort_column_id,
+				 GtkTreeIterCompareFunc sort_func,
+				 gpointer user_data,
+				 GDestroyNotify destroy)
+{
+	g_warning ("custom sort functions are not supported");
+}
+
+static void
+gpk_package_model_set_default_sort_func (GtkTreeSortable *sortable,
+					 GtkTreeIterCompareFunc sort_func,
+					 gpointer user_data,
+					 GDestroyNotify destroy)
+{
+	g_warning ("custom sort functions are not supported");
+}
+
+static gboolean
+gpk_package_model_has_default_sort_func (GtkTreeSortable *sortable)
+{
+	return FALSE;
+}
+
+static void
+gpk_package_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = gpk_package_model_get_flags;
+	iface->get_n_columns = gpk_package_model_get_n_columns;
+	iface->get_column_type = gpk_package_model_get_column_type;
+	iface->get_iter = gpk_package_model_get_iter;
+	iface->get_path = gpk_package_model_get_path;
+	iface->get_value = gpk_package_model_get_value;
+	iface->iter_next = gpk_package_model_iter_next;
+	iface->iter_previous = gpk_package_model_iter_previous;
+	iface->iter_children = gpk_package_model_iter_children;
+	iface->iter_has_child = gpk_package_model_iter_has_child;
+	iface->iter_n_children = gpk_package_model_iter_n_children;
+	iface->iter_nth_child = gpk_package_model_iter_nth_child;
+	iface->iter_parent = gpk_package_model_iter_parent;
+}
+
+static void
+gpk_package_model_tree_sortable_init (GtkTreeSortableIface *iface)
+{
+	iface->get_sort_column_id = gpk_package_model_get_sort_column_id;
+	iface->set_sort_column_id = gpk_package_model_set_sort_column_id;
+	iface->set_sort_func = gpk_package_model_set_sort_func;
+	iface->set_default_sort_func = gpk_package_model_set_default_sort_func;
+	iface->has_default_sort_func = gpk_package_model_has_default_sort_func;
+}
+
+static void
+gpk_package_model_finalize (GObject *object)
+{
+	GpkPackageModel *model = GPK_PACKAGE_MODEL (object);
+
+	g_array_unref (model->items);
+	g_string_chunk_free (model->strings);
+	g_hash_table_unref (model->index);
+	g_clear_object (&model->style);
+
+	G_OBJECT_CLASS (gpk_package_model_parent_class)->finalize (object);
+}
+
+static void
+gpk_package_model_class_init (GpkPackageModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_package_model_finalize;
+}
+
+static void
+gpk_package_model_init (GpkPackageModel *model)
+{
+	model->items = g_array_new (FALSE, FALSE, sizeof (GpkPackageModelItem));
+	model->strings = g_string_chunk_new (64 * 1024);
+	model->index = g_hash_table_new (g_str_hash, g_str_equal);
+	model->index_valid = TRUE;
+	model->sort_column_id = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+	model->sort_order = GTK_SORT_ASCENDING;
+	model->stamp = g_random_int ();
+}
+
+/**
+ * gpk_package_model_new:
+ * @style: (allow-none): the style used to color the row markup
+ **/
+GpkPackageModel *
+gpk_package_model_new (GtkStyleContext *style)
+{
+	GpkPackageModel *model;
+	model = g_object_new (GPK_TYPE_PACKAGE_MODEL, NULL);
+	if (style != NULL)
+		model->style = g_object_ref (style);
+	return model;
+}
@@ -0,0 +1,67 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GPK_PACKAGE_MODEL_H
+#define GPK_PACKAGE_MODEL_H
+
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_PACKAGE_MODEL (gpk_package_model_get_type())
+G_DECLARE_FINAL_TYPE (GpkPackageModel, gpk_package_model, GPK, PACKAGE_MODEL, GObject)
+
+typedef enum {
+	GPK_PACKAGE_MODEL_COLUMN_IMAGE,			/* G_TYPE_STRING */
+	GPK_PACKAGE_MODEL_COLUMN_STATE,			/* G_TYPE_UINT64 */
+	GPK_PACKAGE_MODEL_COLUMN_CHECKBOX,		/* G_TYPE_BOOLEAN */
+	GPK_PACKAGE_MODEL_COLUMN_CHECKBOX_VISIBLE,	/* G_TYPE_BOOLEAN */
+	GPK_PACKAGE_MODEL_COLUMN_TEXT,			/* G_TYPE_STRING */
+	GPK_PACKAGE_MODEL_COLUMN_ID,			/* G_TYPE_STRING */
+	GPK_PACKAGE_MODEL_COLUMN_SUMMARY,		/* G_TYPE_STRING */
+	GPK_PACKAGE_MODEL_COLUMN_LAST
+} GpkPackageModelColumn;
+
+typedef gboolean (*GpkPackageModelFilterFunc)		(const gchar		*package_id,
+							 gpointer		 user_data);
+
+GpkPackageModel	*gpk_package_model_new			(GtkStyleContext	*style);
+void		 gpk_package_model_insert_with_values	(GpkPackageModel	*model,
+							 GtkTreeIter		*iter,
+							 ...);
+void		 gpk_package_model_freeze_sort		(GpkPackageModel	*model);
+void		 gpk_package_model_thaw_sort		(GpkPackageModel	*model);
+void		 gpk_package_model_set			(GpkPackageModel	*model,
+							 GtkTreeIter		*iter,
+							 ...);
+gboolean	 gpk_package_model_remove		(GpkPackageModel	*model,
+							 GtkTreeIter		*iter);
+guint		 gpk_package_model_remove_by_filter	(GpkPackageModel	*model,
+							 GpkPackageModelFilterFunc filter_cb,
+							 gpointer		 user_data);
+void		 gpk_package_model_clear		(GpkPackageModel	*model);
+gboolean	 gpk_package_model_lookup		(GpkPackageModel	*model,
+							 const gchar		*package_id,
+							 GtkTreeIter		*iter);
+
+G_END_DECLS
+
+#endif /* GPK_PACKAGE_MODEL_H */
@@ -0,0 +1,346 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "gpk-query-scheduler.h"
+
+struct _GpkQueryScheduler
+{
+	GObject			 parent_instance;
+	PkClient		*clients[GPK_QUERY_KIND_LAST];
+	GCancellable		*cancellables[GPK_QUERY_KIND_LAST];
+	GHashTable		*in_flight;	/* key:GpkQueryRequest */
+	GQueue			*writes;	/* of GpkQueryWrite */
+	gboolean		 writing;
+};
+
+typedef struct {
+	GpkQueryFunc		 func;
+	gpointer		 user_data;
+} GpkQueryWaiter;
+
+typedef struct {
+	GpkQueryScheduler	*scheduler;
+	gchar			*key;
+	GArray			*waiters;	/* of GpkQueryWaiter */
+} GpkQueryRequest;
+
+typedef struct {
+	GpkQueryWriteFunc	 func;
+	gpointer		 user_data;
+	GCancellable		*cancellable;	/* set once the write is cancelled */
+} GpkQueryWrite;
+
+G_DEFINE_TYPE (GpkQueryScheduler, gpk_query_scheduler, G_TYPE_OBJECT)
+
+static void
+gpk_query_scheduler_request_free (GpkQueryRequest *request)
+{
+	g_object_unref (request->scheduler);
+	g_free (request->key);
+	g_array_unref (request->waiters);
+	g_free (request);
+}
+
+static void
+gpk_query_scheduler_write_free (GpkQueryWrite *write)
+{
+	if (write->cancellable != NULL)
+		g_object_unref (write->cancellable);
+	g_free (write);
+}
+
+static void
+gpk_query_scheduler_ready_cb (PkClient *client, GAsyncResult *res, GpkQueryRequest *request)
+{
+	GpkQueryScheduler *scheduler = request->scheduler;
+	guint i;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* anyone asking from now on gets a new transaction */
+	results = pk_client_generic_finish (client, res, &error);
+	if (g_hash_table_lookup (scheduler->in_flight, request->key) == request)
+		g_hash_table_remove (scheduler->in_flight, request->key);
+	for (i = 0; i < request->waiters->len; i++) {
+		GpkQueryWaiter *waiter = &g_array_index (request->waiters, GpkQueryWaiter, i);
+		waiter->func (scheduler, results, error, waiter->user_data);
+	}
+	gpk_query_scheduler_request_free (request);
+}
+
+/**
+ * gpk_query_scheduler_query:
+ * @kind: the read-only query to run
+ * @package_ids: (allow-none): the packages to query, if @kind needs them
+ * @func: called with the results, or with an error
+ *
+ * Runs a read-only query on the #PkClient for @kind, so that queries of
+ * different kinds run at the same time and can be cancelled separately.
+ * If the same query is already running, @func is called when it finishes
+ * rather than starting another transaction; in that case only the first
+ * caller gets progress updates.
+ **/
+void
+gpk_query_scheduler_query (GpkQueryScheduler *scheduler,
+			   GpkQueryKind kind,
+			   gchar **package_ids,
+			   PkProgressCallback progress_callback,
+			   gpointer progress_user_data,
+			   GpkQueryFunc func,
+			   gpointer user_data)
+{
+	GpkQueryRequest *request;
+	GpkQueryWaiter waiter;
+	PkClient *client;
+	GCancellable *cancellable;
+	g_autofree gchar *joined = NULL;
+	g_autofree gchar *key = NULL;
+
+	g_return_if_fail (GPK_IS_QUERY_SCHEDULER (scheduler));
+	g_return_if_fail (kind < GPK_QUERY_KIND_WRITE);
+	g_return_if_fail (func != NULL);
+
+	waiter.func = func;
+	waiter.user_data = user_data;
+
+	/* already asked for */
+	joined = package_ids != NULL ? g_strjoinv ("&", package_ids) : g_strdup ("");
+	key = g_strdup_printf ("%u:%s", kind, joined);
+	request = g_hash_table_lookup (scheduler->in_flight, key);
+	if (request != NULL) {
+		g_debug ("joining query %s", key);
+		g_array_append_val (request->waiters, waiter);
+		return;
+	}
+
+	request = g_new0 (GpkQueryRequest, 1);
+	request->scheduler = g_object_ref (scheduler);
+	request->key = g_steal_pointer (&key);
+	request->waiters = g_array_new (FALSE, FALSE, sizeof (GpkQueryWaiter));
+	g_array_append_val (request->waiters, waiter);
+	g_hash_table_insert (scheduler->in_flight, request->key, request);
+
+	client = scheduler->clients[kind];
+	cancellable = scheduler->cancellables[kind];
+	switch (kind) {
+	case GPK_QUERY_KIND_DETAILS:
+		pk_client_get_details_async (client, package_ids, cancellable,
+					     progress_callback, progress_user_data,
+					     (GAsyncReadyCallback) gpk_query_scheduler_ready_cb, request);
+		break;
+	case GPK_QUERY_KIND_FILES:
+		pk_client_get_files_async (client, package_ids, cancellable,
+					   progress_callback, progress_user_data,
+					   (GAsyncReadyCallback) gpk_query_scheduler_ready_cb, request);
+		break;
+	case GPK_QUERY_KIND_DEPENDS_ON:
+		pk_client_depends_on_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					    package_ids, TRUE, cancellable,
+					    progress_callback, progress_user_data,
+					    (GAsyncReadyCallback) gpk_query_scheduler_ready_cb, request);
+		break;
+	case GPK_QUERY_KIND_REQUIRED_BY:
+		pk_client_required_by_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					     package_ids, TRUE, cancellable,
+					     progress_callback, progress_user_data,
+					     (GAsyncReadyCallback) gpk_query_scheduler_ready_cb, request);
+		break;
+	case GPK_QUERY_KIND_CATEGORIES:
+		pk_client_get_categories_async (client, cancellable,
+						progress_callback, progress_user_data,
+						(GAsyncReadyCallback) gpk_query_scheduler_ready_cb, request);
+		break;
+	case GPK_QUERY_KIND_REPO_LIST:
+		pk_client_get_repo_list_async (client, pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					       cancellable,
+					       progress_callback, progress_user_data,
+					       (GAsyncReadyCallback) gpk_query_scheduler_ready_cb, request);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
+}
+
+/**
+ * gpk_query_scheduler_write:
+ * @func: starts the transaction, using the cancellable it is given
+ *
+ * Runs @func now if no other write is running, otherwise once all the
+ * writes queued before it have called gpk_query_scheduler_write_finished().
+ * @func is always called, even if the write is cancelled before it
+ * starts, so that it can finish and put the UI back.
+ **/
+void
+gpk_query_scheduler_write (GpkQueryScheduler *scheduler,
+			   GpkQueryWriteFunc func,
+			   gpointer user_data)
+{
+	GpkQueryWrite *write;
+
+	g_return_if_fail (GPK_IS_QUERY_SCHEDULER (scheduler));
+	g_return_if_fail (func != NULL);
+
+	if (!scheduler->writing) {
+		scheduler->writing = TRUE;
+		func (scheduler, scheduler->cancellables[GPK_QUERY_KIND_WRITE], user_data);
+		return;
+	}
+	write = g_new0 (GpkQueryWrite, 1);
+	write->func = func;
+	write->user_data = user_data;
+	g_queue_push_tail (scheduler->writes, write);
+	g_debug ("queued write, %u waiting", g_queue_get_length (scheduler->writes));
+}
+
+/**
+ * gpk_query_scheduler_write_finished:
+ *
+ * Must be called once the transaction started by a write has finished,
+ * whether or not it succeeded.
+ **/
+void
+gpk_query_scheduler_write_finished (GpkQueryScheduler *scheduler)
+{
+	GpkQueryWrite *write;
+
+	g_return_if_fail (GPK_IS_QUERY_SCHEDULER (scheduler));
+
+	scheduler->writing = FALSE;
+	write = g_queue_pop_head (scheduler->writes);
+	if (write == NULL)
+		return;
+
+	/* a cancelled write still runs, so its transaction fails straight
+	 * away and it calls back here for the next one */
+	if (write->cancellable != NULL) {
+		scheduler->writing = TRUE;
+		write->func (scheduler, write->cancellable, write->user_data);
+	} else {
+		gpk_query_scheduler_write (scheduler, write->func, write->user_data);
+	}
+	gpk_query_scheduler_write_free (write);
+}
+
+static gboolean
+gpk_query_scheduler_has_prefix_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	return g_str_has_prefix (key, user_data);
+}
+
+gboolean
+gpk_query_scheduler_is_writing (GpkQueryScheduler *scheduler)
+{
+	g_return_val_if_fail (GPK_IS_QUERY_SCHEDULER (scheduler), FALSE);
+	return scheduler->writing;
+}
+
+/**
+ * gpk_query_scheduler_cancel:
+ *
+ * Cancels everything of @kind that is running. Anything started after
+ * this uses a new cancellable, so there is no need to reset it, and
+ * never joins a query that was cancelled. Writes
+ * that have not started yet keep their place and are given the cancelled
+ * cancellable, so their transactions fail as cancelled.
+ **/
+void
+gpk_query_scheduler_cancel (GpkQueryScheduler *scheduler, GpkQueryKind kind)
+{
+	g_return_if_fail (GPK_IS_QUERY_SCHEDULER (scheduler));
+	g_return_if_fail (kind < GPK_QUERY_KIND_LAST);
+
+	g_cancellable_cancel (scheduler->cancellables[kind]);
+	if (kind != GPK_QUERY_KIND_WRITE) {
+		g_autofree gchar *prefix = g_strdup_printf ("%u:", kind);
+		g_hash_table_foreach_remove (scheduler->in_flight,
+					     gpk_query_scheduler_has_prefix_cb,
+					     prefix);
+	} else {
+		GList *l;
+		for (l = scheduler->writes->head; l != NULL; l = l->next) {
+			GpkQueryWrite *write = l->data;
+			if (write->cancellable == NULL)
+				write->cancellable = g_object_ref (scheduler->cancellables[kind]);
+		}
+	}
+	g_object_unref (scheduler->cancellables[kind]);
+	scheduler->cancellables[kind] = g_cancellable_new ();
+}
+
+void
+gpk_query_scheduler_cancel_all (GpkQueryScheduler *scheduler)
+{
+	guint i;
+
+	g_return_if_fail (GPK_IS_QUERY_SCHEDULER (scheduler));
+
+	for (i = 0; i < GPK_QUERY_KIND_LAST; i++)
+		gpk_query_scheduler_cancel (scheduler, i);
+}
+
+static void
+gpk_query_scheduler_finalize (GObject *object)
+{
+	GpkQueryScheduler *scheduler = GPK_QUERY_SCHEDULER (object);
+	guint i;
+
+	for (i = 0; i < GPK_QUERY_KIND_LAST; i++) {
+		if (scheduler->clients[i] != NULL)
+			g_object_unref (scheduler->clients[i]);
+		g_object_unref (scheduler->cancellables[i]);
+	}
+	g_hash_table_unref (scheduler->in_flight);
+	g_queue_free_full (scheduler->writes, (GDestroyNotify) gpk_query_scheduler_write_free);
+
+	G_OBJECT_CLASS (gpk_query_scheduler_parent_class)->finalize (object);
+}
+
+static void
+gpk_query_scheduler_class_init (GpkQuerySchedulerClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_query_scheduler_finalize;
+}
+
+static void
+gpk_query_scheduler_init (GpkQueryScheduler *scheduler)
+{
+	guint i;
+
+	/* writes go through the caller's PkTask so they can ask questions */
+	for (i = 0; i < GPK_QUERY_KIND_LAST; i++) {
+		if (i != GPK_QUERY_KIND_WRITE)
+			scheduler->clients[i] = pk_client_new ();
+		scheduler->cancellables[i] = g_cancellable_new ();
+	}
+	scheduler->in_flight = g_hash_table_new (g_str_hash, g_str_equal);
+	scheduler->writes = g_queue_new ();
+}
+
+GpkQueryScheduler *
+gpk_query_scheduler_new (void)
+{
+	return g_object_new (GPK_TYPE_QUERY_SCHEDULER, NULL);
+}
@@ -0,0 +1,71 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GPK_QUERY_SCHEDULER_H
+#define GPK_QUERY_SCHEDULER_H
+
+#include <gio/gio.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_QUERY_SCHEDULER (gpk_query_scheduler_get_type())
+G_DECLARE_FINAL_TYPE (GpkQueryScheduler, gpk_query_scheduler, GPK, QUERY_SCHEDULER, GObject)
+
+typedef enum {
+	GPK_QUERY_KIND_DETAILS,
+	GPK_QUERY_KIND_FILES,
+	GPK_QUERY_KIND_DEPENDS_ON,
+	GPK_QUERY_KIND_REQUIRED_BY,
+	GPK_QUERY_KIND_CATEGORIES,
+	GPK_QUERY_KIND_REPO_LIST,
+	GPK_QUERY_KIND_WRITE,
+	GPK_QUERY_KIND_LAST
+} GpkQueryKind;
+
+typedef void	 (*GpkQueryFunc)			(GpkQueryScheduler	*scheduler,
+							 PkResults		*results,
+							 const GError		*error,
+							 gpointer		 user_data);
+typedef void	 (*GpkQueryWriteFunc)			(GpkQueryScheduler	*scheduler,
+							 GCancellable		*cancellable,
+							 gpointer		 user_data);
+
+GpkQueryScheduler *gpk_query_scheduler_new		(void);
+void		 gpk_query_scheduler_query		(GpkQueryScheduler	*scheduler,
+							 GpkQueryKind		 kind,
+							 gchar			**package_ids,
+							 PkProgressCallback	 progress_callback,
+							 gpointer		 progress_user_data,
+							 GpkQueryFunc		 func,
+							 gpointer		 user_data);
+void		 gpk_query_scheduler_write		(GpkQueryScheduler	*scheduler,
+							 GpkQueryWriteFunc	 func,
+							 gpointer		 user_data);
+void		 gpk_query_scheduler_write_finished	(GpkQueryScheduler	*scheduler);
+gboolean	 gpk_query_scheduler_is_writing		(GpkQueryScheduler	*scheduler);
+void		 gpk_query_scheduler_cancel		(GpkQueryScheduler	*scheduler,
+							 GpkQueryKind		 kind);
+void		 gpk_query_scheduler_cancel_all		(GpkQueryScheduler	*scheduler);
+
+G_END_DECLS
+
+#endif /* GPK_QUERY_SCHEDULER_H */
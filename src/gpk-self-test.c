@@ -20,11 +20,17 @@
  */
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <glib-object.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "gpk-common.h"
+#include "gpk-details-index.h"
 #include "gpk-enum.h"
 #include "gpk-error.h"
+#include "gpk-name-index.h"
+#include "gpk-package-model.h"
 #include "gpk-task.h"
 
 static void
@@ -167,6 +173,611 @@ gpk_test_common_func (void)
 	text = gpk_package_id_format_twoline (NULL, "simon;0.0.1;;data", "dude");
 	g_assert_cmpstr (text, ==, "dude\n<span color=\"gray\">simon-0.0.1</span>");
 	g_free (text);
+
+	/* versions */
+	g_assert_cmpint (gpk_package_version_compare ("1.0", "1.0"), ==, 0);
+	g_assert_cmpint (gpk_package_version_compare ("1.10", "1.9"), >, 0);
+	g_assert_cmpint (gpk_package_version_compare ("1.0~rc1", "1.0"), <, 0);
+	g_assert_cmpint (gpk_package_version_compare ("1.0a", "1.0.1"), <, 0);
+	g_assert_cmpint (gpk_package_version_compare ("1:1.0", "2.0"), >, 0);
+	g_assert_cmpint (gpk_package_version_compare ("2.0-1.fc40", "2.0-1.fc39"), >, 0);
+	g_assert_cmpint (gpk_package_version_compare ("001", "1"), ==, 0);
+}
+
+static void
+gpk_test_package_id_view_func (void)
+{
+	GpkPackageIdView view;
+	const gchar *tmp;
+	gsize len;
+	g_autofree gchar *data = NULL;
+
+	/* valid */
+	g_assert_true (gpk_package_id_view_init (&view, "hal;0.0.1;i386;fedora"));
+	tmp = gpk_package_id_view_get (&view, PK_PACKAGE_ID_VERSION, &len);
+	g_assert_cmpint (len, ==, 5);
+	g_assert_cmpint (strncmp (tmp, "0.0.1", len), ==, 0);
+	g_assert_true (gpk_package_id_view_equal (&view, PK_PACKAGE_ID_NAME, "hal"));
+	g_assert_false (gpk_package_id_view_equal (&view, PK_PACKAGE_ID_NAME, "ha"));
+	g_assert_false (gpk_package_id_view_equal (&view, PK_PACKAGE_ID_NAME, "hald"));
+	g_assert_true (gpk_package_id_view_contains (&view, PK_PACKAGE_ID_ARCH, "38"));
+	g_assert_false (gpk_package_id_view_contains (&view, PK_PACKAGE_ID_ARCH, "fedora"));
+	data = gpk_package_id_view_dup (&view, PK_PACKAGE_ID_DATA);
+	g_assert_cmpstr (data, ==, "fedora");
+
+	/* empty fields are allowed, apart from the name */
+	g_assert_true (gpk_package_id_view_init (&view, "hal;;;"));
+	g_assert_false (gpk_package_id_view_init (&view, ";0.0.1;i386;fedora"));
+
+	/* wrong number of fields */
+	g_assert_false (gpk_package_id_view_init (&view, "hal;0.0.1;i386"));
+	g_assert_false (gpk_package_id_view_init (&view, "hal;0.0.1;i386;fedora;extra"));
+	g_assert_false (gpk_package_id_view_init (&view, NULL));
+}
+
+static void
+gpk_test_package_id_view_benchmark_func (void)
+{
+	gdouble elapsed_split;
+	gdouble elapsed_view;
+	guint i;
+	guint matches_split = 0;
+	guint matches_view = 0;
+	const guint size = 50000;
+	g_autoptr(GPtrArray) package_ids = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < size; i++) {
+		g_ptr_array_add (package_ids,
+				 g_strdup_printf ("package%u;1.0.%u-1.fc40;x86_64;fedora", i % 1000, i));
+	}
+
+	/* what select_exact_match does for each row */
+	g_timer_start (timer);
+	for (i = 0; i < package_ids->len; i++) {
+		g_auto(GStrv) split = pk_package_id_split (g_ptr_array_index (package_ids, i));
+		if (g_strcmp0 (split[PK_PACKAGE_ID_NAME], "package42") == 0)
+			matches_split++;
+	}
+	elapsed_split = g_timer_elapsed (timer, NULL) * 1000;
+
+	g_timer_start (timer);
+	for (i = 0; i < package_ids->len; i++) {
+		GpkPackageIdView view;
+		if (gpk_package_id_view_init (&view, g_ptr_array_index (package_ids, i)) &&
+		    gpk_package_id_view_equal (&view, PK_PACKAGE_ID_NAME, "package42"))
+			matches_view++;
+	}
+	elapsed_view = g_timer_elapsed (timer, NULL) * 1000;
+	g_assert_cmpint (matches_view, ==, matches_split);
+
+	g_test_message ("matched %u of %u: view %.3fms, split %.3fms",
+			matches_view, size, elapsed_view, elapsed_split);
+}
+
+static void
+gpk_test_details_index_func (void)
+{
+	GPtrArray *array;
+	PkDetails *item;
+	const gchar *search_one[] = { "editor", NULL };
+	const gchar *search_two[] = { "TEXT", "vim", NULL };
+	const gchar *search_missing[] = { "zzz", NULL };
+	const gchar *search_stale[] = { "obsolete", NULL };
+	g_autoptr(GpkDetailsIndex) index = NULL;
+
+	index = gpk_details_index_new ();
+	gpk_details_index_add (index, "vim;9.0;x86_64;fedora",
+			       PK_INFO_ENUM_AVAILABLE, "The VIM editor");
+	gpk_details_index_add (index, "editor;1.0;x86_64;fedora",
+			       PK_INFO_ENUM_INSTALLED, "Does things");
+	gpk_details_index_add (index, "nano;7.2;x86_64;fedora",
+			       PK_INFO_ENUM_AVAILABLE, "A small text editor");
+	g_assert_cmpint (gpk_details_index_get_size (index), ==, 3);
+
+	/* exact name, then summary matches */
+	array = gpk_details_index_search (index, (gchar **) search_one);
+	g_assert_cmpint (array->len, ==, 3);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==, "editor;1.0;x86_64;fedora");
+	g_assert_cmpint (pk_package_get_info (g_ptr_array_index (array, 0)), ==, PK_INFO_ENUM_INSTALLED);
+	g_ptr_array_unref (array);
+
+	/* every term has to match, the description only counts once known */
+	array = gpk_details_index_search (index, (gchar **) search_two);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+	item = g_object_new (PK_TYPE_DETAILS,
+			     "package-id", "vim;9.0;x86_64;fedora",
+			     "description", "Vim is an advanced text editor",
+			     NULL);
+	gpk_details_index_add_details (index, item);
+	g_object_unref (item);
+	g_assert_cmpint (gpk_details_index_get_size (index), ==, 3);
+	array = gpk_details_index_search (index, (gchar **) search_two);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_summary (g_ptr_array_index (array, 0)), ==, "The VIM editor");
+	g_ptr_array_unref (array);
+
+	array = gpk_details_index_search (index, (gchar **) search_missing);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+
+	/* clearing only keeps the descriptions of indexed packages */
+	item = g_object_new (PK_TYPE_DETAILS,
+			     "package-id", "gone;1.0;x86_64;fedora",
+			     "description", "An obsolete editor",
+			     NULL);
+	gpk_details_index_add_details (index, item);
+	g_object_unref (item);
+	gpk_details_index_clear (index);
+	g_assert_cmpint (gpk_details_index_get_size (index), ==, 0);
+	gpk_details_index_add (index, "vim;9.0;x86_64;fedora",
+			       PK_INFO_ENUM_AVAILABLE, "The VIM editor");
+	gpk_details_index_add (index, "gone;1.0;x86_64;fedora",
+			       PK_INFO_ENUM_AVAILABLE, "Not here any more");
+	array = gpk_details_index_search (index, (gchar **) search_two);
+	g_assert_cmpint (array->len, ==, 1);
+	g_ptr_array_unref (array);
+	array = gpk_details_index_search (index, (gchar **) search_stale);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+}
+
+static void
+gpk_test_details_index_benchmark_func (void)
+{
+	GPtrArray *array;
+	gdouble elapsed_index;
+	gdouble elapsed_scan;
+	guint i;
+	guint matches = 0;
+	const gchar *search[] = { "editor", NULL };
+	const guint size = 50000;
+	g_autoptr(GpkDetailsIndex) index = NULL;
+	g_autoptr(GPtrArray) summaries = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* something that looks like a distro */
+	index = gpk_details_index_new ();
+	summaries = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < size; i++) {
+		g_autofree gchar *package_id = NULL;
+		gchar *summary;
+
+		package_id = g_strdup_printf ("package%u;1.0.%u;x86_64;fedora", i, i % 7);
+		summary = g_strdup_printf ("Library number %u for %s", i,
+					   i % 100 == 0 ? "the text editor" : "parsing data");
+		gpk_details_index_add (index, package_id, PK_INFO_ENUM_AVAILABLE, summary);
+		g_ptr_array_add (summaries, summary);
+	}
+	g_test_message ("indexed %u summaries in %.1fms", size,
+			g_timer_elapsed (timer, NULL) * 1000);
+
+	/* what a backend does for SearchDetails */
+	g_timer_start (timer);
+	for (i = 0; i < summaries->len; i++) {
+		g_autofree gchar *summary_down = NULL;
+		summary_down = g_utf8_strdown (g_ptr_array_index (summaries, i), -1);
+		if (strstr (summary_down, search[0]) != NULL)
+			matches++;
+	}
+	elapsed_scan = g_timer_elapsed (timer, NULL) * 1000;
+
+	g_timer_start (timer);
+	array = gpk_details_index_search (index, (gchar **) search);
+	elapsed_index = g_timer_elapsed (timer, NULL) * 1000;
+	g_assert_cmpint (array->len, ==, matches);
+	g_ptr_array_unref (array);
+
+	g_test_message ("found %u of %u: index %.3fms, scan %.3fms",
+			matches, size, elapsed_index, elapsed_scan);
+}
+
+static void
+gpk_test_package_model_row_changed_cb (GtkTreeModel *model, GtkTreePath *path,
+				       GtkTreeIter *iter, guint *changed)
+{
+	(*changed)++;
+}
+
+static void
+gpk_test_name_index_rebuild_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	gboolean *done = user_data;
+	g_autoptr(GError) error = NULL;
+
+	g_assert_true (gpk_name_index_rebuild_finish (GPK_NAME_INDEX (source), res, &error));
+	g_assert_no_error (error);
+	*done = TRUE;
+}
+
+static void
+gpk_test_name_index_func (void)
+{
+	GPtrArray *array;
+	PkInfoEnum info;
+	const gchar *package_id;
+	const gchar *summary;
+	gboolean done = FALSE;
+	gboolean ret;
+	gchar *data = NULL;
+	gsize i;
+	gsize len;
+	const gchar *search_one[] = { "VIM", NULL };
+	const gchar *search_two[] = { "vim", "enh", NULL };
+	const gchar *search_missing[] = { "emacs", NULL };
+	const gchar *package_ids[] = { "vim;9.0;x86_64;fedora",
+				       "vim-enhanced;9.0;x86_64;fedora",
+				       "nano;7.2;x86_64;fedora",
+				       "gvim;9.0;x86_64;fedora",
+				       NULL };
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GpkNameIndex) index = NULL;
+	g_autoptr(GpkNameIndex) index_copy = NULL;
+	g_autoptr(GpkNameIndex) index_bad = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autofree gchar *filename_bad = NULL;
+
+	tmpdir = g_dir_make_tmp ("gpk-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "names.index", NULL);
+	filename_bad = g_build_filename (tmpdir, "names-bad.index", NULL);
+
+	/* nothing written yet */
+	index = gpk_name_index_new (filename);
+	ret = gpk_name_index_load (index, &error);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_null (gpk_name_index_search (index, (gchar **) search_one));
+
+	/* write it and map it back */
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; package_ids[i] != NULL; i++) {
+		PkPackage *package = pk_package_new ();
+		ret = pk_package_set_id (package, package_ids[i], &error);
+		g_assert_no_error (error);
+		g_assert_true (ret);
+		pk_package_set_info (package, i == 2 ? PK_INFO_ENUM_INSTALLED : PK_INFO_ENUM_AVAILABLE);
+		pk_package_set_summary (package, "A text editor");
+		g_ptr_array_add (packages, package);
+	}
+	gpk_name_index_rebuild_async (index, packages,
+				      pk_bitfield_value (PK_FILTER_ENUM_NONE), NULL,
+				      gpk_test_name_index_rebuild_cb, &done);
+	while (!done)
+		g_main_context_iteration (NULL, TRUE);
+	g_assert_cmpint (gpk_name_index_get_size (index), ==, 4);
+	g_assert_true (gpk_name_index_is_valid (index, pk_bitfield_value (PK_FILTER_ENUM_NONE)));
+	g_assert_false (gpk_name_index_is_valid (index, pk_bitfield_value (PK_FILTER_ENUM_INSTALLED)));
+
+	/* a second instance reads the same data from the file */
+	index_copy = gpk_name_index_new (filename);
+	ret = gpk_name_index_load (index_copy, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (gpk_name_index_get_size (index_copy), ==, 4);
+	gpk_name_index_get_entry (index_copy, 2, &package_id, &info, &summary);
+	g_assert_cmpstr (package_id, ==, "nano;7.2;x86_64;fedora");
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (summary, ==, "A text editor");
+
+	/* substrings anywhere in the name, ignoring case */
+	array = gpk_name_index_search (index_copy, (gchar **) search_one);
+	g_assert_cmpint (array->len, ==, 3);
+	g_ptr_array_unref (array);
+	array = gpk_name_index_search (index_copy, (gchar **) search_two);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==,
+			 "vim-enhanced;9.0;x86_64;fedora");
+	g_ptr_array_unref (array);
+	array = gpk_name_index_search (index_copy, (gchar **) search_missing);
+	g_assert_cmpint (array->len, ==, 0);
+	g_ptr_array_unref (array);
+
+	/* a truncated file is refused */
+	ret = g_file_get_contents (filename, &data, &len, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_contents (filename_bad, data, len / 2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	index_bad = gpk_name_index_new (filename_bad);
+	ret = gpk_name_index_load (index_bad, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	/* so is one where a name no longer ends where its offset says */
+	for (i = 0; i + 5 <= len; i++) {
+		if (memcmp (data + i, "nano\n", 5) == 0) {
+			data[i + 4] = 'x';
+			break;
+		}
+	}
+	g_assert_cmpint (i + 5, <=, len);
+	ret = g_file_set_contents (filename_bad, data, len, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = gpk_name_index_load (index_bad, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_null (gpk_name_index_search (index_bad, (gchar **) search_one));
+	g_free (data);
+
+	g_unlink (filename_bad);
+	g_unlink (filename);
+	g_rmdir (tmpdir);
+}
+
+static gchar *
+gpk_test_package_model_get_id (GtkTreeModel *tree_model, GtkTreeIter *iter)
+{
+	gchar *package_id = NULL;
+	gtk_tree_model_get (tree_model, iter,
+			    GPK_PACKAGE_MODEL_COLUMN_ID, &package_id, -1);
+	return package_id;
+}
+
+static void
+gpk_test_package_model_row_deleted_cb (GtkTreeModel *model, GtkTreePath *path, guint *deleted)
+{
+	(*deleted)++;
+}
+
+static void
+gpk_test_package_model_rows_reordered_cb (GtkTreeModel *model, GtkTreePath *path,
+					  GtkTreeIter *iter, gpointer new_order, guint *reordered)
+{
+	(*reordered)++;
+}
+
+static gboolean
+gpk_test_package_model_filter_cb (const gchar *package_id, gpointer user_data)
+{
+	return g_str_has_prefix (package_id, "vim;");
+}
+
+static void
+gpk_test_package_model_func (void)
+{
+	GtkTreeIter iter;
+	GtkTreeModel *tree_model;
+	GtkTreePath *tree_path;
+	gboolean checkbox;
+	gboolean ret;
+	gchar *package_id;
+	gchar *path;
+	guint changed = 0;
+	guint deleted = 0;
+	guint i;
+	guint reordered = 0;
+	const gchar *package_ids[] = { "vim;9.0;x86_64;fedora",
+				       "bash;5.2;x86_64;fedora",
+				       "nano;7.2;x86_64;fedora",
+				       NULL };
+	g_autoptr(GpkPackageModel) model = NULL;
+
+	model = gpk_package_model_new (NULL);
+	tree_model = GTK_TREE_MODEL (model);
+	for (i = 0; package_ids[i] != NULL; i++) {
+		gpk_package_model_insert_with_values (model, NULL,
+						      GPK_PACKAGE_MODEL_COLUMN_ID, package_ids[i],
+						      GPK_PACKAGE_MODEL_COLUMN_SUMMARY, "A program",
+						      GPK_PACKAGE_MODEL_COLUMN_CHECKBOX, i == 1,
+						      -1);
+	}
+	g_assert_cmpint (gtk_tree_model_iter_n_children (tree_model, NULL), ==, 3);
+
+	/* unsorted, so in the order added */
+	i = 0;
+	ret = gtk_tree_model_get_iter_first (tree_model, &iter);
+	while (ret) {
+		package_id = gpk_test_package_model_get_id (tree_model, &iter);
+		g_assert_cmpstr (package_id, ==, package_ids[i++]);
+		g_free (package_id);
+		ret = gtk_tree_model_iter_next (tree_model, &iter);
+	}
+	g_assert_cmpint (i, ==, 3);
+
+	/* sorting moves the rows, and the index follows them */
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GPK_PACKAGE_MODEL_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+	ret = gtk_tree_model_get_iter_first (tree_model, &iter);
+	g_assert_true (ret);
+	package_id = gpk_test_package_model_get_id (tree_model, &iter);
+	g_assert_cmpstr (package_id, ==, "bash;5.2;x86_64;fedora");
+	g_free (package_id);
+	gtk_tree_model_get (tree_model, &iter,
+			    GPK_PACKAGE_MODEL_COLUMN_CHECKBOX, &checkbox, -1);
+	g_assert_true (checkbox);
+	ret = gpk_package_model_lookup (model, "vim;9.0;x86_64;fedora", &iter);
+	g_assert_true (ret);
+	path = gtk_tree_model_get_string_from_iter (tree_model, &iter);
+	g_assert_cmpstr (path, ==, "2");
+	g_free (path);
+
+	/* inserts go to the sorted position */
+	gpk_package_model_insert_with_values (model, &iter,
+					      GPK_PACKAGE_MODEL_COLUMN_ID, "gcc;14.1;x86_64;fedora",
+					      -1);
+	path = gtk_tree_model_get_string_from_iter (tree_model, &iter);
+	g_assert_cmpstr (path, ==, "1");
+	g_free (path);
+
+	/* changing a row tells the view, and the index uses the new id */
+	g_signal_connect (model, "row-changed",
+			  G_CALLBACK (gpk_test_package_model_row_changed_cb), &changed);
+	ret = gpk_package_model_lookup (model, "nano;7.2;x86_64;fedora", &iter);
+	g_assert_true (ret);
+	gpk_package_model_set (model, &iter,
+			       GPK_PACKAGE_MODEL_COLUMN_ID, "nano;7.3;x86_64;fedora",
+			       GPK_PACKAGE_MODEL_COLUMN_STATE, (guint64) 1,
+			       -1);
+	g_assert_cmpint (changed, ==, 1);
+	g_assert_false (gpk_package_model_lookup (model, "nano;7.2;x86_64;fedora", &iter));
+	g_assert_true (gpk_package_model_lookup (model, "nano;7.3;x86_64;fedora", &iter));
+
+	/* removing returns the next row */
+	ret = gpk_package_model_lookup (model, "bash;5.2;x86_64;fedora", &iter);
+	g_assert_true (ret);
+	ret = gpk_package_model_remove (model, &iter);
+	g_assert_true (ret);
+	g_assert_cmpint (gtk_tree_model_iter_n_children (tree_model, NULL), ==, 3);
+
+	/* many rows at once, one delete each */
+	g_signal_connect (model, "row-deleted",
+			  G_CALLBACK (gpk_test_package_model_row_deleted_cb), &deleted);
+	i = gpk_package_model_remove_by_filter (model, gpk_test_package_model_filter_cb, NULL);
+	g_assert_cmpint (i, ==, 2);
+	g_assert_cmpint (deleted, ==, 2);
+	g_assert_cmpint (gtk_tree_model_iter_n_children (tree_model, NULL), ==, 1);
+	ret = gpk_package_model_lookup (model, "vim;9.0;x86_64;fedora", &iter);
+	g_assert_true (ret);
+	path = gtk_tree_model_get_string_from_iter (tree_model, &iter);
+	g_assert_cmpstr (path, ==, "0");
+	g_free (path);
+	g_assert_false (gpk_package_model_lookup (model, "gcc;14.1;x86_64;fedora", &iter));
+	gpk_package_model_clear (model);
+	g_assert_cmpint (gtk_tree_model_iter_n_children (tree_model, NULL), ==, 0);
+	g_assert_false (gpk_package_model_lookup (model, "vim;9.0;x86_64;fedora", &iter));
+
+	/* a frozen sort appends, then moves the rows in one go */
+	g_signal_connect (model, "rows-reordered",
+			  G_CALLBACK (gpk_test_package_model_rows_reordered_cb), &reordered);
+	gpk_package_model_insert_with_values (model, NULL,
+					      GPK_PACKAGE_MODEL_COLUMN_ID, "make;4.4;x86_64;fedora",
+					      -1);
+	gpk_package_model_freeze_sort (model);
+	for (i = 0; package_ids[i] != NULL; i++) {
+		gpk_package_model_insert_with_values (model, &iter,
+						      GPK_PACKAGE_MODEL_COLUMN_ID, package_ids[i],
+						      -1);
+		tree_path = gtk_tree_model_get_path (tree_model, &iter);
+		g_assert_cmpint (gtk_tree_path_get_indices (tree_path)[0], ==, i + 1);
+		gtk_tree_path_free (tree_path);
+	}
+	gpk_package_model_thaw_sort (model);
+	g_assert_cmpint (reordered, ==, 1);
+	ret = gtk_tree_model_iter_nth_child (tree_model, &iter, NULL, 0);
+	g_assert_true (ret);
+	package_id = gpk_test_package_model_get_id (tree_model, &iter);
+	g_assert_cmpstr (package_id, ==, "bash;5.2;x86_64;fedora");
+	g_free (package_id);
+	ret = gpk_package_model_lookup (model, "make;4.4;x86_64;fedora", &iter);
+	g_assert_true (ret);
+	path = gtk_tree_model_get_string_from_iter (tree_model, &iter);
+	g_assert_cmpstr (path, ==, "1");
+	g_free (path);
+	ret = gpk_package_model_lookup (model, "vim;9.0;x86_64;fedora", &iter);
+	g_assert_true (ret);
+	path = gtk_tree_model_get_string_from_iter (tree_model, &iter);
+	g_assert_cmpstr (path, ==, "3");
+	g_free (path);
+
+	/* nothing to move */
+	gpk_package_model_freeze_sort (model);
+	gpk_package_model_insert_with_values (model, NULL,
+					      GPK_PACKAGE_MODEL_COLUMN_ID, "zsh;5.9;x86_64;fedora",
+					      -1);
+	gpk_package_model_thaw_sort (model);
+	g_assert_cmpint (reordered, ==, 1);
+}
+
+static gint64
+gpk_test_get_resident (void)
+{
+	guint64 pages;
+	g_autofree gchar *data = NULL;
+	g_auto(GStrv) split = NULL;
+
+	/* size and resident, in pages */
+	if (!g_file_get_contents ("/proc/self/statm", &data, NULL, NULL))
+		return 0;
+	split = g_strsplit (data, " ", 3);
+	if (g_strv_length (split) < 2)
+		return 0;
+	pages = g_ascii_strtoull (split[1], NULL, 10);
+	return (gint64) pages * sysconf (_SC_PAGESIZE);
+}
+
+static void
+gpk_test_package_model_benchmark_func (void)
+{
+	GtkTreeIter iter;
+	gdouble elapsed_list;
+	gdouble elapsed_model;
+	gint64 resident;
+	gint64 resident_list;
+	gint64 resident_model;
+	guint i;
+	const guint size = 50000;
+	g_autoptr(GPtrArray) package_ids = NULL;
+	g_autoptr(GpkPackageModel) model = NULL;
+	g_autoptr(GtkListStore) store = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* a search that matches most of a distro, in backend order */
+	package_ids = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < size; i++) {
+		g_ptr_array_add (package_ids,
+				 g_strdup_printf ("package%u;1.0.%u;x86_64;fedora",
+						  (i * 7919) % size, i % 7));
+	}
+
+	/* both are kept alive, so each only adds its own rows */
+	resident = gpk_test_get_resident ();
+	model = gpk_package_model_new (NULL);
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GPK_PACKAGE_MODEL_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+	g_timer_start (timer);
+	gpk_package_model_freeze_sort (model);
+	for (i = 0; i < package_ids->len; i++) {
+		gpk_package_model_insert_with_values (model, &iter,
+						      GPK_PACKAGE_MODEL_COLUMN_IMAGE, "package-x-generic",
+						      GPK_PACKAGE_MODEL_COLUMN_ID, g_ptr_array_index (package_ids, i),
+						      GPK_PACKAGE_MODEL_COLUMN_SUMMARY, "A library",
+						      -1);
+	}
+	gpk_package_model_thaw_sort (model);
+	elapsed_model = g_timer_elapsed (timer, NULL) * 1000;
+	resident_model = gpk_test_get_resident () - resident;
+
+	/* what the package list used before */
+	resident = gpk_test_get_resident ();
+	store = gtk_list_store_new (GPK_PACKAGE_MODEL_COLUMN_LAST,
+				    G_TYPE_STRING, G_TYPE_UINT64, G_TYPE_BOOLEAN,
+				    G_TYPE_BOOLEAN, G_TYPE_STRING, G_TYPE_STRING,
+				    G_TYPE_STRING);
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+					      GPK_PACKAGE_MODEL_COLUMN_ID,
+					      GTK_SORT_ASCENDING);
+	g_timer_start (timer);
+	for (i = 0; i < package_ids->len; i++) {
+		g_autofree gchar *text = NULL;
+		text = gpk_package_id_format_twoline (NULL, g_ptr_array_index (package_ids, i),
+						      "A library");
+		gtk_list_store_insert_with_values (store, &iter, -1,
+						   GPK_PACKAGE_MODEL_COLUMN_IMAGE, "package-x-generic",
+						   GPK_PACKAGE_MODEL_COLUMN_TEXT, text,
+						   GPK_PACKAGE_MODEL_COLUMN_ID, g_ptr_array_index (package_ids, i),
+						   GPK_PACKAGE_MODEL_COLUMN_SUMMARY, "A library",
+						   -1);
+	}
+	elapsed_list = g_timer_elapsed (timer, NULL) * 1000;
+	resident_list = gpk_test_get_resident () - resident;
+	g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (model), NULL), ==,
+			 gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL));
+
+	g_test_message ("added %u sorted rows: model %.3fms, list store %.3fms",
+			size, elapsed_model, elapsed_list);
+	g_test_message ("resident growth: model %" G_GINT64_FORMAT "kB, list store %" G_GINT64_FORMAT "kB",
+			resident_model / 1024, resident_list / 1024);
 }
 
 int
@@ -177,6 +788,17 @@ main (int argc, char **argv)
 
 	g_test_add_func ("/gnome-packagekit/enum", gpk_test_enum_func);
 	g_test_add_func ("/gnome-packagekit/common", gpk_test_common_func);
+	g_test_add_func ("/gnome-packagekit/package-id-view", gpk_test_package_id_view_func);
+	g_test_add_func ("/gnome-packagekit/details-index", gpk_test_details_index_func);
+	g_test_add_func ("/gnome-packagekit/name-index", gpk_test_name_index_func);
+	g_test_add_func ("/gnome-packagekit/package-model", gpk_test_package_model_func);
+
+	/* timings only, so just with -m perf */
+	if (g_test_perf ()) {
+		g_test_add_func ("/gnome-packagekit/package-id-view-benchmark", gpk_test_package_id_view_benchmark_func);
+		g_test_add_func ("/gnome-packagekit/details-index-benchmark", gpk_test_details_index_benchmark_func);
+		g_test_add_func ("/gnome-packagekit/package-model-benchmark", gpk_test_package_model_benchmark_func);
+	}
 
 	return g_test_run ();
 }
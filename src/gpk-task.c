@@ -384,18 +384,75 @@ gpk_task_add_dialog_deps_section (PkTask *task,
 	gtk_notebook_append_page (tabbed_widget, tab_page, tab_label);
 }
 
+static GtkWindow *
+gpk_task_simulate_dialog_new (PkTask *task, PkPackageSack *sack, const gchar *message)
+{
+	GpkTaskPrivate *priv = GET_PRIVATE (GPK_TASK(task));
+	GtkWindow *window;
+	const gchar *title;
+	GtkNotebook *tabbed_widget = NULL;
+
+	/* TRANSLATORS: title of a dependency dialog */
+	title = _("Additional confirmation required");
+	window = GTK_WINDOW (gtk_message_dialog_new (priv->parent_window,
+						     GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
+						     GTK_MESSAGE_INFO, GTK_BUTTONS_CANCEL, "%s", title));
+	gtk_message_dialog_format_secondary_markup (GTK_MESSAGE_DIALOG (window), "%s", message);
+
+	tabbed_widget = GTK_NOTEBOOK (gtk_notebook_new ());
+
+	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
+					  PK_INFO_ENUM_INSTALLING);
+
+	/* TRANSLATORS: additional message text for the deps dialog */
+	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
+					  PK_INFO_ENUM_REMOVING);
+
+	/* TRANSLATORS: additional message text for the deps dialog */
+	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
+					  PK_INFO_ENUM_UPDATING);
+
+	/* TRANSLATORS: additional message text for the deps dialog */
+	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
+					  PK_INFO_ENUM_OBSOLETING);
+
+	/* TRANSLATORS: additional message text for the deps dialog */
+	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
+					  PK_INFO_ENUM_REINSTALLING);
+
+	/* TRANSLATORS: additional message text for the deps dialog */
+	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
+					  PK_INFO_ENUM_DOWNGRADING);
+
+	gpk_dialog_embed_tabbed_widget (GTK_DIALOG(window), tabbed_widget);
+
+	gpk_dialog_embed_do_not_show_widget (GTK_DIALOG(window), GPK_SETTINGS_SHOW_DEPENDS);
+	/* TRANSLATORS: this is button text */
+	gtk_dialog_add_button (GTK_DIALOG(window), _("Continue"), GTK_RESPONSE_YES);
+
+	/* set icon name */
+	gtk_window_set_icon_name (window, GPK_ICON_SOFTWARE_INSTALLER);
+	return window;
+}
+
+static gboolean
+gpk_task_simulate_filter_cb (PkPackage *package, gpointer user_data)
+{
+	PkInfoEnum info = pk_package_get_info (package);
+
+	/* not changes, just what the backend did */
+	return info != PK_INFO_ENUM_CLEANUP && info != PK_INFO_ENUM_FINISHED;
+}
+
 static void
 gpk_task_simulate_question (PkTask *task, guint request, PkResults *results)
 {
 	gboolean ret;
-	g_autoptr(GPtrArray) array = NULL;
 	GpkTaskPrivate *priv = GET_PRIVATE (GPK_TASK(task));
 	PkRoleEnum role;
 	g_autoptr(PkPackageSack) sack = NULL;
 	guint inputs;
-	const gchar *title;
 	const gchar *message = NULL;
-	GtkNotebook *tabbed_widget = NULL;
 	PkBitfield transaction_flags = 0;
 
 	/* save the current request */
@@ -419,9 +476,6 @@ gpk_task_simulate_question (PkTask *task, guint request, PkResults *results)
 		}
 	}
 
-	/* TRANSLATORS: title of a dependency dialog */
-	title = _("Additional confirmation required");
-
 	/* per-role messages */
 	if (role == PK_ROLE_ENUM_INSTALL_PACKAGES) {
 
@@ -449,51 +503,62 @@ gpk_task_simulate_question (PkTask *task, guint request, PkResults *results)
 		message = _("To process this transaction, additional software also has to be modified.");
 	}
 
-	priv->current_window = GTK_WINDOW (gtk_message_dialog_new (priv->parent_window,
-								   GTK_DIALOG_MODAL | GTK_DIALOG_DESTROY_WITH_PARENT,
-								   GTK_MESSAGE_INFO, GTK_BUTTONS_CANCEL, "%s", title));
-	gtk_message_dialog_format_secondary_markup (GTK_MESSAGE_DIALOG (priv->current_window), "%s", message);
-
-	tabbed_widget = GTK_NOTEBOOK (gtk_notebook_new ());
-
 	/* get the details for all the packages */
 	sack = pk_results_get_package_sack (results);
+	priv->current_window = gpk_task_simulate_dialog_new (task, sack, message);
+	g_signal_connect (priv->current_window, "response", G_CALLBACK (gpk_task_dialog_response_cb), task);
+	gtk_widget_show_all (GTK_WIDGET(priv->current_window));
+}
 
-	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
-					  PK_INFO_ENUM_INSTALLING);
-
-	/* TRANSLATORS: additional message text for the deps dialog */
-	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
-					  PK_INFO_ENUM_REMOVING);
-
-	/* TRANSLATORS: additional message text for the deps dialog */
-	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
-					  PK_INFO_ENUM_UPDATING);
-
-	/* TRANSLATORS: additional message text for the deps dialog */
-	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
-					  PK_INFO_ENUM_OBSOLETING);
-
-	/* TRANSLATORS: additional message text for the deps dialog */
-	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
-					  PK_INFO_ENUM_REINSTALLING);
-
-	/* TRANSLATORS: additional message text for the deps dialog */
-	gpk_task_add_dialog_deps_section (task, tabbed_widget, sack,
-					  PK_INFO_ENUM_DOWNGRADING);
-
-	gpk_dialog_embed_tabbed_widget (GTK_DIALOG(priv->current_window),
-					tabbed_widget);
+/**
+ * gpk_task_confirm_changes:
+ * @sack: everything that will be changed, as reported by one or more
+ *        simulated transactions; the requested packages are removed
+ * @package_ids: the packages that were asked for
+ * @removing: if any packages are being removed
+ *
+ * Shows one dependency dialog for changes that need more than one
+ * transaction, and waits for the user to answer it. Like #PkTask, the
+ * dialog is only shown if something other than @package_ids changes.
+ *
+ * Return value: %TRUE if the changes should go ahead
+ **/
+gboolean
+gpk_task_confirm_changes (GpkTask *task, PkPackageSack *sack, gchar **package_ids, gboolean removing)
+{
+	GtkWindow *window;
+	gint response;
+	guint i;
+	guint inputs;
+	const gchar *message;
 
-	gpk_dialog_embed_do_not_show_widget (GTK_DIALOG(priv->current_window), GPK_SETTINGS_SHOW_DEPENDS);
-	/* TRANSLATORS: this is button text */
-	gtk_dialog_add_button (GTK_DIALOG(priv->current_window), _("Continue"), GTK_RESPONSE_YES);
+	g_return_val_if_fail (GPK_IS_TASK (task), FALSE);
+	g_return_val_if_fail (package_ids != NULL, FALSE);
+
+	/* only show what was not asked for */
+	inputs = g_strv_length (package_ids);
+	for (i = 0; i < inputs; i++)
+		pk_package_sack_remove_package_by_id (sack, package_ids[i]);
+	pk_package_sack_remove_by_filter (sack, gpk_task_simulate_filter_cb, NULL);
+	if (pk_package_sack_get_size (sack) == 0) {
+		g_debug ("nothing else is changed");
+		return TRUE;
+	}
 
-	/* set icon name */
-	gtk_window_set_icon_name (priv->current_window, GPK_ICON_SOFTWARE_INSTALLER);
+	/* we always ask when removing other packages */
+	if (!removing && !g_settings_get_boolean (task->priv->settings, GPK_SETTINGS_SHOW_DEPENDS)) {
+		g_debug ("we've said we don't want the dep dialog");
+		return TRUE;
+	}
 
-	g_signal_connect (priv->current_window, "response", G_CALLBACK (gpk_task_dialog_response_cb), task);
-	gtk_widget_show_all (GTK_WIDGET(priv->current_window));
+	/* TRANSLATORS: message text of a dependency dialog */
+	message = ngettext ("To apply this change, additional software also has to be modified.",
+			    "To apply these changes, additional software also has to be modified.", inputs);
+	window = gpk_task_simulate_dialog_new (PK_TASK (task), sack, message);
+	gtk_widget_show_all (GTK_WIDGET (window));
+	response = gtk_dialog_run (GTK_DIALOG (window));
+	gtk_widget_destroy (GTK_WIDGET (window));
+	return response == GTK_RESPONSE_YES;
 }
 
 static void
@@ -55,6 +55,10 @@ GQuark		 gpk_task_error_quark		(void);
 GpkTask		*gpk_task_new			(void);
 gboolean	 gpk_task_set_parent_window	(GpkTask	*task,
 						 GtkWindow	*window);
+gboolean	 gpk_task_confirm_changes	(GpkTask	*task,
+						 PkPackageSack	*sack,
+						 gchar		**package_ids,
+						 gboolean	 removing);
 
 G_END_DECLS
 
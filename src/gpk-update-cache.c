@@ -0,0 +1,558 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "gpk-update-cache.h"
+
+/* bump this if the layout below changes */
+#define GPK_UPDATE_CACHE_VERSION	1
+
+/* updates, obsoletes, vendor-urls, bugzilla-urls, cve-urls, restart,
+ * update-text, changelog, state, issued, updated */
+#define GPK_UPDATE_CACHE_UPDATE_DETAIL_TYPE	"(asasasasasussuss)"
+
+/* license, group, description, url, size */
+#define GPK_UPDATE_CACHE_DETAILS_TYPE		"(susst)"
+
+#define GPK_UPDATE_CACHE_TYPE	"(u"							\
+				"a{s" GPK_UPDATE_CACHE_UPDATE_DETAIL_TYPE "}"	\
+				"a{s" GPK_UPDATE_CACHE_DETAILS_TYPE "}"		\
+				")"
+
+struct _GpkUpdateCache
+{
+	GObject			 parent_instance;
+	gchar			*filename;
+	GHashTable		*update_details;	/* package-id:PkUpdateDetail */
+	GHashTable		*details;		/* package-id:PkDetails */
+	GHashTable		*update_details_mapped;	/* package-id:GVariant */
+	GHashTable		*details_mapped;	/* package-id:GVariant */
+	gboolean		 dirty;
+};
+
+G_DEFINE_TYPE (GpkUpdateCache, gpk_update_cache, G_TYPE_OBJECT)
+
+static const gchar *
+gpk_update_cache_str_or_null (const gchar *text)
+{
+	if (text == NULL || text[0] == '\0')
+		return NULL;
+	return text;
+}
+
+static gchar **
+gpk_update_cache_strv_or_null (gchar **strv)
+{
+	if (strv == NULL || strv[0] == NULL)
+		return NULL;
+	return strv;
+}
+
+static GVariant *
+gpk_update_cache_strv_to_variant (gchar **strv)
+{
+	if (strv == NULL)
+		return g_variant_new_strv (NULL, 0);
+	return g_variant_new_strv ((const gchar * const *) strv, -1);
+}
+
+static PkUpdateDetail *
+gpk_update_cache_update_detail_from_variant (const gchar *package_id, GVariant *value)
+{
+	g_auto(GStrv) updates = NULL;
+	g_auto(GStrv) obsoletes = NULL;
+	g_auto(GStrv) vendor_urls = NULL;
+	g_auto(GStrv) bugzilla_urls = NULL;
+	g_auto(GStrv) cve_urls = NULL;
+	const gchar *update_text;
+	const gchar *changelog;
+	const gchar *issued;
+	const gchar *updated;
+	guint32 restart;
+	guint32 state;
+
+	g_variant_get (value, "(^as^as^as^as^asu&s&su&s&s)",
+		       &updates, &obsoletes, &vendor_urls, &bugzilla_urls, &cve_urls,
+		       &restart, &update_text, &changelog, &state, &issued, &updated);
+	return g_object_new (PK_TYPE_UPDATE_DETAIL,
+			     "package-id", package_id,
+			     "updates", gpk_update_cache_strv_or_null (updates),
+			     "obsoletes", gpk_update_cache_strv_or_null (obsoletes),
+			     "vendor-urls", gpk_update_cache_strv_or_null (vendor_urls),
+			     "bugzilla-urls", gpk_update_cache_strv_or_null (bugzilla_urls),
+			     "cve-urls", gpk_update_cache_strv_or_null (cve_urls),
+			     "restart", restart,
+			     "update-text", gpk_update_cache_str_or_null (update_text),
+			     "changelog", gpk_update_cache_str_or_null (changelog),
+			     "state", state,
+			     "issued", gpk_update_cache_str_or_null (issued),
+			     "updated", gpk_update_cache_str_or_null (updated),
+			     NULL);
+}
+
+static GVariant *
+gpk_update_cache_update_detail_to_variant (PkUpdateDetail *item)
+{
+	g_auto(GStrv) updates = NULL;
+	g_auto(GStrv) obsoletes = NULL;
+	g_auto(GStrv) vendor_urls = NULL;
+	g_auto(GStrv) bugzilla_urls = NULL;
+	g_auto(GStrv) cve_urls = NULL;
+	g_autofree gchar *update_text = NULL;
+	g_autofree gchar *changelog = NULL;
+	g_autofree gchar *issued = NULL;
+	g_autofree gchar *updated = NULL;
+	guint restart;
+	guint state;
+
+	g_object_get (item,
+		      "updates", &updates,
+		      "obsoletes", &obsoletes,
+		      "vendor-urls", &vendor_urls,
+		      "bugzilla-urls", &bugzilla_urls,
+		      "cve-urls", &cve_urls,
+		      "restart", &restart,
+		      "update-text", &update_text,
+		      "changelog", &changelog,
+		      "state", &state,
+		      "issued", &issued,
+		      "updated", &updated,
+		      NULL);
+	return g_variant_new ("(@as@as@as@as@asussuss)",
+			      gpk_update_cache_strv_to_variant (updates),
+			      gpk_update_cache_strv_to_variant (obsoletes),
+			      gpk_update_cache_strv_to_variant (vendor_urls),
+			      gpk_update_cache_strv_to_variant (bugzilla_urls),
+			      gpk_update_cache_strv_to_variant (cve_urls),
+			      restart,
+			      update_text != NULL ? update_text : "",
+			      changelog != NULL ? changelog : "",
+			      state,
+			      issued != NULL ? issued : "",
+			      updated != NULL ? updated : "");
+}
+
+static PkDetails *
+gpk_update_cache_details_from_variant (const gchar *package_id, GVariant *value)
+{
+	const gchar *license;
+	const gchar *description;
+	const gchar *url;
+	guint32 group;
+	guint64 size;
+
+	g_variant_get (value, "(&su&s&st)",
+		       &license, &group, &description, &url, &size);
+	return g_object_new (PK_TYPE_DETAILS,
+			     "package-id", package_id,
+			     "license", gpk_update_cache_str_or_null (license),
+			     "group", group,
+			     "description", gpk_update_cache_str_or_null (description),
+			     "url", gpk_update_cache_str_or_null (url),
+			     "size", size,
+			     NULL);
+}
+
+static GVariant *
+gpk_update_cache_details_to_variant (PkDetails *item)
+{
+	g_autofree gchar *license = NULL;
+	g_autofree gchar *description = NULL;
+	g_autofree gchar *url = NULL;
+	guint group;
+	guint64 size;
+
+	g_object_get (item,
+		      "license", &license,
+		      "group", &group,
+		      "description", &description,
+		      "url", &url,
+		      "size", &size,
+		      NULL);
+	return g_variant_new (GPK_UPDATE_CACHE_DETAILS_TYPE,
+			      license != NULL ? license : "",
+			      group,
+			      description != NULL ? description : "",
+			      url != NULL ? url : "",
+			      size);
+}
+
+static void
+gpk_update_cache_clear (GpkUpdateCache *cache)
+{
+	g_hash_table_remove_all (cache->update_details);
+	g_hash_table_remove_all (cache->details);
+	g_hash_table_remove_all (cache->update_details_mapped);
+	g_hash_table_remove_all (cache->details_mapped);
+	cache->dirty = FALSE;
+}
+
+static void
+gpk_update_cache_index_mapped (GHashTable *hash, GVariant *dict)
+{
+	GVariantIter iter;
+	GVariant *value;
+	gchar *package_id;
+
+	/* the values are only views into the mapped file */
+	g_variant_iter_init (&iter, dict);
+	while (g_variant_iter_next (&iter, "{s@*}", &package_id, &value))
+		g_hash_table_insert (hash, package_id, value);
+}
+
+/**
+ * gpk_update_cache_load:
+ *
+ * Maps the cache file into memory. Entries are only turned back into
+ * objects when they are asked for.
+ **/
+gboolean
+gpk_update_cache_load (GpkUpdateCache *cache, GError **error)
+{
+	guint32 version;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+	g_autoptr(GVariant) root = NULL;
+	g_autoptr(GVariant) update_details = NULL;
+	g_autoptr(GVariant) details = NULL;
+
+	g_return_val_if_fail (GPK_IS_UPDATE_CACHE (cache), FALSE);
+
+	mapped_file = g_mapped_file_new (cache->filename, FALSE, error);
+	if (mapped_file == NULL)
+		return FALSE;
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	root = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GPK_UPDATE_CACHE_TYPE),
+							     bytes, FALSE));
+	g_variant_get_child (root, 0, "u", &version);
+	if (version != GPK_UPDATE_CACHE_VERSION) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+			     "cache version %u is not supported", version);
+		return FALSE;
+	}
+
+	gpk_update_cache_clear (cache);
+	update_details = g_variant_get_child_value (root, 1);
+	gpk_update_cache_index_mapped (cache->update_details_mapped, update_details);
+	details = g_variant_get_child_value (root, 2);
+	gpk_update_cache_index_mapped (cache->details_mapped, details);
+	g_debug ("loaded %u update details and %u details from %s",
+		 g_hash_table_size (cache->update_details_mapped),
+		 g_hash_table_size (cache->details_mapped),
+		 cache->filename);
+	return TRUE;
+}
+
+static void
+gpk_update_cache_add_mapped_keys (GHashTable *set, GHashTable *hash)
+{
+	GHashTableIter iter;
+	gpointer key;
+
+	g_hash_table_iter_init (&iter, hash);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_hash_table_add (set, key);
+}
+
+/**
+ * gpk_update_cache_save:
+ * @package_ids: (allow-none): the package-ids to keep, or %NULL for all
+ *
+ * Writes the cache to disk, dropping any entries not in @package_ids so
+ * the file does not grow without bound.
+ **/
+gboolean
+gpk_update_cache_save (GpkUpdateCache *cache, GHashTable *package_ids, GError **error)
+{
+	GHashTableIter iter;
+	GVariantBuilder builder_update_details;
+	GVariantBuilder builder_details;
+	gpointer key;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GHashTable) all_ids = NULL;
+	g_autoptr(GVariant) root = NULL;
+
+	g_return_val_if_fail (GPK_IS_UPDATE_CACHE (cache), FALSE);
+
+	/* everything we know about */
+	if (package_ids == NULL) {
+		all_ids = g_hash_table_new (g_str_hash, g_str_equal);
+		gpk_update_cache_add_mapped_keys (all_ids, cache->update_details);
+		gpk_update_cache_add_mapped_keys (all_ids, cache->details);
+		gpk_update_cache_add_mapped_keys (all_ids, cache->update_details_mapped);
+		gpk_update_cache_add_mapped_keys (all_ids, cache->details_mapped);
+		package_ids = all_ids;
+	}
+
+	g_variant_builder_init (&builder_update_details,
+				G_VARIANT_TYPE ("a{s" GPK_UPDATE_CACHE_UPDATE_DETAIL_TYPE "}"));
+	g_variant_builder_init (&builder_details,
+				G_VARIANT_TYPE ("a{s" GPK_UPDATE_CACHE_DETAILS_TYPE "}"));
+	g_hash_table_iter_init (&iter, package_ids);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		const gchar *package_id = key;
+		PkUpdateDetail *update_detail;
+		PkDetails *details;
+		GVariant *value;
+
+		/* reuse the mapped data where we never built an object */
+		update_detail = g_hash_table_lookup (cache->update_details, package_id);
+		value = g_hash_table_lookup (cache->update_details_mapped, package_id);
+		if (update_detail != NULL) {
+			g_variant_builder_add (&builder_update_details, "{s@*}", package_id,
+					       gpk_update_cache_update_detail_to_variant (update_detail));
+		} else if (value != NULL) {
+			g_variant_builder_add (&builder_update_details, "{s@*}", package_id, value);
+		}
+		details = g_hash_table_lookup (cache->details, package_id);
+		value = g_hash_table_lookup (cache->details_mapped, package_id);
+		if (details != NULL) {
+			g_variant_builder_add (&builder_details, "{s@*}", package_id,
+					       gpk_update_cache_details_to_variant (details));
+		} else if (value != NULL) {
+			g_variant_builder_add (&builder_details, "{s@*}", package_id, value);
+		}
+	}
+	root = g_variant_ref_sink (g_variant_new ("(u@*@*)",
+						  (guint32) GPK_UPDATE_CACHE_VERSION,
+						  g_variant_builder_end (&builder_update_details),
+						  g_variant_builder_end (&builder_details)));
+
+	/* write the serialized data as-is so it can be mapped back */
+	dirname = g_path_get_dirname (cache->filename);
+	if (g_mkdir_with_parents (dirname, 0700) < 0) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+			     "failed to create %s: %s", dirname, g_strerror (errno));
+		return FALSE;
+	}
+	if (!g_file_set_contents (cache->filename,
+				  g_variant_get_data (root),
+				  g_variant_get_size (root),
+				  error))
+		return FALSE;
+	cache->dirty = FALSE;
+	return TRUE;
+}
+
+/**
+ * gpk_update_cache_invalidate:
+ *
+ * Forgets everything and removes the file, e.g. when the repo metadata
+ * has changed.
+ **/
+void
+gpk_update_cache_invalidate (GpkUpdateCache *cache)
+{
+	g_return_if_fail (GPK_IS_UPDATE_CACHE (cache));
+
+	gpk_update_cache_clear (cache);
+	if (g_unlink (cache->filename) < 0 && errno != ENOENT)
+		g_warning ("failed to remove %s: %s", cache->filename, g_strerror (errno));
+}
+
+gboolean
+gpk_update_cache_is_dirty (GpkUpdateCache *cache)
+{
+	g_return_val_if_fail (GPK_IS_UPDATE_CACHE (cache), FALSE);
+	return cache->dirty;
+}
+
+/**
+ * gpk_update_cache_get_update_detail:
+ *
+ * Return value: (transfer none): the cached update detail, or %NULL
+ **/
+PkUpdateDetail *
+gpk_update_cache_get_update_detail (GpkUpdateCache *cache, const gchar *package_id)
+{
+	PkUpdateDetail *item;
+	GVariant *value;
+
+	g_return_val_if_fail (GPK_IS_UPDATE_CACHE (cache), NULL);
+	g_return_val_if_fail (package_id != NULL, NULL);
+
+	item = g_hash_table_lookup (cache->update_details, package_id);
+	if (item != NULL)
+		return item;
+	value = g_hash_table_lookup (cache->update_details_mapped, package_id);
+	if (value == NULL)
+		return NULL;
+	item = gpk_update_cache_update_detail_from_variant (package_id, value);
+	g_hash_table_insert (cache->update_details, g_strdup (package_id), item);
+	return item;
+}
+
+/**
+ * gpk_update_cache_get_details:
+ *
+ * Return value: (transfer none): the cached package details, or %NULL
+ **/
+PkDetails *
+gpk_update_cache_get_details (GpkUpdateCache *cache, const gchar *package_id)
+{
+	PkDetails *item;
+	GVariant *value;
+
+	g_return_val_if_fail (GPK_IS_UPDATE_CACHE (cache), NULL);
+	g_return_val_if_fail (package_id != NULL, NULL);
+
+	item = g_hash_table_lookup (cache->details, package_id);
+	if (item != NULL)
+		return item;
+	value = g_hash_table_lookup (cache->details_mapped, package_id);
+	if (value == NULL)
+		return NULL;
+	item = gpk_update_cache_details_from_variant (package_id, value);
+	g_hash_table_insert (cache->details, g_strdup (package_id), item);
+	return item;
+}
+
+void
+gpk_update_cache_add_update_detail (GpkUpdateCache *cache, PkUpdateDetail *item)
+{
+	const gchar *package_id;
+
+	g_return_if_fail (GPK_IS_UPDATE_CACHE (cache));
+	g_return_if_fail (PK_IS_UPDATE_DETAIL (item));
+
+	package_id = pk_update_detail_get_package_id (item);
+	if (package_id == NULL)
+		return;
+	g_hash_table_remove (cache->update_details_mapped, package_id);
+	g_hash_table_insert (cache->update_details, g_strdup (package_id), g_object_ref (item));
+	cache->dirty = TRUE;
+}
+
+void
+gpk_update_cache_add_details (GpkUpdateCache *cache, PkDetails *item)
+{
+	const gchar *package_id;
+
+	g_return_if_fail (GPK_IS_UPDATE_CACHE (cache));
+	g_return_if_fail (PK_IS_DETAILS (item));
+
+	package_id = pk_details_get_package_id (item);
+	if (package_id == NULL)
+		return;
+	g_hash_table_remove (cache->details_mapped, package_id);
+	g_hash_table_insert (cache->details, g_strdup (package_id), g_object_ref (item));
+	cache->dirty = TRUE;
+}
+
+/**
+ * gpk_update_cache_set_size:
+ *
+ * Updates the download size of a cached entry, e.g. once the package
+ * has been downloaded and there is nothing left to fetch.
+ **/
+void
+gpk_update_cache_set_size (GpkUpdateCache *cache, const gchar *package_id, guint64 size)
+{
+	PkDetails *item;
+	g_autofree gchar *license = NULL;
+	g_autofree gchar *description = NULL;
+	g_autofree gchar *url = NULL;
+	guint group;
+
+	g_return_if_fail (GPK_IS_UPDATE_CACHE (cache));
+	g_return_if_fail (package_id != NULL);
+
+	item = gpk_update_cache_get_details (cache, package_id);
+	if (item == NULL || pk_details_get_size (item) == size)
+		return;
+
+	/* the caller may still be showing the old object, so keep a copy */
+	g_object_get (item,
+		      "license", &license,
+		      "group", &group,
+		      "description", &description,
+		      "url", &url,
+		      NULL);
+	item = g_object_new (PK_TYPE_DETAILS,
+			     "package-id", package_id,
+			     "license", license,
+			     "group", group,
+			     "description", description,
+			     "url", url,
+			     "size", size,
+			     NULL);
+	g_hash_table_insert (cache->details, g_strdup (package_id), item);
+	cache->dirty = TRUE;
+}
+
+static void
+gpk_update_cache_finalize (GObject *object)
+{
+	GpkUpdateCache *cache = GPK_UPDATE_CACHE (object);
+
+	g_free (cache->filename);
+	g_hash_table_unref (cache->update_details);
+	g_hash_table_unref (cache->details);
+	g_hash_table_unref (cache->update_details_mapped);
+	g_hash_table_unref (cache->details_mapped);
+
+	G_OBJECT_CLASS (gpk_update_cache_parent_class)->finalize (object);
+}
+
+static void
+gpk_update_cache_class_init (GpkUpdateCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = gpk_update_cache_finalize;
+}
+
+static void
+gpk_update_cache_init (GpkUpdateCache *cache)
+{
+	cache->update_details = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, g_object_unref);
+	cache->details = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, g_object_unref);
+	cache->update_details_mapped = g_hash_table_new_full (g_str_hash, g_str_equal,
+							      g_free, (GDestroyNotify) g_variant_unref);
+	cache->details_mapped = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_variant_unref);
+}
+
+/**
+ * gpk_update_cache_new:
+ * @filename: (allow-none): the cache file, or %NULL for the default
+ **/
+GpkUpdateCache *
+gpk_update_cache_new (const gchar *filename)
+{
+	GpkUpdateCache *cache;
+	cache = g_object_new (GPK_TYPE_UPDATE_CACHE, NULL);
+	if (filename != NULL)
+		cache->filename = g_strdup (filename);
+	else
+		cache->filename = g_build_filename (g_get_user_cache_dir (),
+						    "gnome-packagekit",
+						    "update-viewer.cache",
+						    NULL);
+	return cache;
+}
@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 GNOME PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef GPK_UPDATE_CACHE_H
+#define GPK_UPDATE_CACHE_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/packagekit.h>
+
+G_BEGIN_DECLS
+
+#define GPK_TYPE_UPDATE_CACHE (gpk_update_cache_get_type())
+G_DECLARE_FINAL_TYPE (GpkUpdateCache, gpk_update_cache, GPK, UPDATE_CACHE, GObject)
+
+GpkUpdateCache	*gpk_update_cache_new			(const gchar	*filename);
+gboolean	 gpk_update_cache_load			(GpkUpdateCache	*cache,
+							 GError		**error);
+gboolean	 gpk_update_cache_save			(GpkUpdateCache	*cache,
+							 GHashTable	*package_ids,
+							 GError		**error);
+void		 gpk_update_cache_invalidate		(GpkUpdateCache	*cache);
+gboolean	 gpk_update_cache_is_dirty		(GpkUpdateCache	*cache);
+PkUpdateDetail	*gpk_update_cache_get_update_detail	(GpkUpdateCache	*cache,
+							 const gchar	*package_id);
+PkDetails	*gpk_update_cache_get_details		(GpkUpdateCache	*cache,
+							 const gchar	*package_id);
+void		 gpk_update_cache_add_update_detail	(GpkUpdateCache	*cache,
+							 PkUpdateDetail	*item);
+void		 gpk_update_cache_add_details		(GpkUpdateCache	*cache,
+							 PkDetails	*item);
+void		 gpk_update_cache_set_size		(GpkUpdateCache	*cache,
+							 const gchar	*package_id,
+							 guint64	 size);
+
+G_END_DECLS
+
+#endif /* GPK_UPDATE_CACHE_H */
@@ -28,6 +28,7 @@
 #include <gtk/gtk.h>
 #include <locale.h>
 #include <packagekit-glib2/packagekit.h>
+#include <string.h>
 
 #ifdef HAVE_SYSTEMD
 #include "systemd-proxy.h"
@@ -41,24 +42,47 @@
 #include "gpk-enum.h"
 #include "gpk-error.h"
 #include "gpk-task.h"
+#include "gpk-update-cache.h"
 #include "gpk-debug.h"
 
 #define GPK_UPDATE_VIEWER_AUTO_QUIT_TIMEOUT	10 /* seconds */
 #define GPK_UPDATE_VIEWER_AUTO_RESTART_TIMEOUT	60 /* seconds */
 #define GPK_UPDATE_VIEWER_MOBILE_SMALL_SIZE	512*1024 /* bytes */
+#define GPK_UPDATE_VIEWER_PROGRESS_FLUSH_FALLBACK	16 /* ms */
+#define GPK_UPDATE_VIEWER_REFRESH_DELAY		500 /* ms */
+#define GPK_UPDATE_VIEWER_FETCH_BATCH_SIZE	100 /* package-ids */
+#define GPK_UPDATE_VIEWER_PULSE_INTERVAL	60 /* ms */
 
 static	gboolean		 ignore_updates_changed = FALSE;
 static	gchar			*package_id_last = NULL;
 static	guint			 auto_shutdown_id = 0;
 static	guint			 size_total = 0;
 static	guint			 number_total = 0;
+static	guint			 number_updates = 0;
+static	guint			 number_updates_selected = 0;
 static	PkRestartEnum		 restart_worst = 0;
+static	guint			 restart_counts[PK_RESTART_ENUM_LAST];
+static	GHashTable		*selection_index = NULL;
 #ifdef HAVE_SYSTEMD
 static  SystemdProxy		*proxy = NULL;
 #endif
 static	GCancellable		*cancellable = NULL;
 static	GSettings		*settings = NULL;
 static	GPtrArray		*update_array = NULL;
+static	GHashTable		*package_id_index = NULL;
+static	GtkTreeRowReference	*header_refs[PK_INFO_ENUM_LAST];
+static	GHashTable		*progress_pending = NULL;
+static	GPtrArray		*progress_pending_order = NULL;
+static	guint			 progress_tick_id = 0;
+static	guint			 progress_timeout_id = 0;
+static	guint			 progress_events_received = 0;
+static	guint			 progress_events_applied = 0;
+static	guint			 refresh_id = 0;
+static	guint			 refresh_generation = 0;
+static	GpkUpdateCache		*update_cache = NULL;
+static	guint			 cache_save_id = 0;
+static	PkClient		*download_client = NULL;
+static	GCancellable		*download_cancellable = NULL;
 static	GtkBuilder		*builder = NULL;
 static	GtkTreeStore		*array_store_updates = NULL;
 static	GtkTextBuffer		*text_buffer = NULL;
@@ -95,7 +119,28 @@ enum {
 	GPK_UPDATES_COLUMN_LAST
 };
 
+typedef enum {
+	GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL,
+	GPK_UPDATE_VIEWER_FETCH_DETAILS,
+	GPK_UPDATE_VIEWER_FETCH_LAST
+} GpkUpdateViewerFetchKind;
+
+typedef struct {
+	GPtrArray		*order;		/* package-id, in model order */
+	GHashTable		*pending;	/* package-id, borrowed from order */
+	guint			 cursor;
+	gboolean		 in_flight;
+} GpkUpdateViewerFetchQueue;
+
+static	GpkUpdateViewerFetchQueue fetch_queues[GPK_UPDATE_VIEWER_FETCH_LAST];
+
 static void gpk_update_viewer_get_new_update_array (void);
+static void gpk_update_viewer_fetch_next (GpkUpdateViewerFetchKind kind);
+static void gpk_update_viewer_progress_flush_now (void);
+static void gpk_update_viewer_refresh_queue (void);
+static void gpk_update_viewer_cache_save_queue (void);
+static void gpk_update_viewer_download_cancel (void);
+static void gpk_update_viewer_download_packages (gchar **package_ids, GCancellable *cancellable_download);
 
 static gboolean
 _g_strzero (const gchar *text)
@@ -111,6 +156,7 @@ static void
 gpk_update_viewer_quit (void)
 {
 	/* are we in a transaction */
+	gpk_update_viewer_download_cancel ();
 	g_cancellable_cancel (cancellable);
 	g_application_release (G_APPLICATION (application));
 }
@@ -326,37 +372,139 @@ gpk_update_viewer_check_blocked_packages (GPtrArray *array)
 }
 
 static gboolean
-gpk_update_viewer_are_all_updates_selected (GtkTreeModel *model)
+gpk_update_viewer_info_is_update_enum (PkInfoEnum info)
 {
-	gboolean selected = TRUE;
-	gboolean valid;
-	gboolean child_valid;
-	GtkTreeIter child_iter;
-	GtkTreeIter iter;
+	gboolean ret = FALSE;
+	switch (info) {
+	case PK_INFO_ENUM_AVAILABLE:
+	case PK_INFO_ENUM_LOW:
+	case PK_INFO_ENUM_NORMAL:
+	case PK_INFO_ENUM_IMPORTANT:
+	case PK_INFO_ENUM_SECURITY:
+	case PK_INFO_ENUM_BUGFIX:
+	case PK_INFO_ENUM_ENHANCEMENT:
+	case PK_INFO_ENUM_BLOCKED:
+		ret = TRUE;
+		break;
+	default:
+		break;
+	}
+	return ret;
+}
 
-	/* if there are no entries selected, deselect the button */
-	valid = gtk_tree_model_get_iter_first (model, &iter);
-	while (valid) {
-		gtk_tree_model_get (model, &iter,
-				    GPK_UPDATES_COLUMN_SELECT, &selected,
-				    -1);
-		if (!selected)
-			return FALSE;
+typedef struct {
+	PkInfoEnum		 info;
+	PkRestartEnum		 restart;
+	guint			 size;
+	gboolean		 update;
+} GpkUpdateViewerSelected;
 
-		/* do for children too */
-		child_valid = gtk_tree_model_iter_children (model, &child_iter, &iter);
-		while (child_valid) {
-			gtk_tree_model_get (model, &child_iter,
-					    GPK_UPDATES_COLUMN_SELECT, &selected,
-					    -1);
-			if (!selected)
-				return FALSE;
-			child_valid = gtk_tree_model_iter_next (model, &child_iter);
+/* only update rows under a section header can be picked by the user,
+ * not blocked updates or the dependencies shown while installing */
+static gboolean
+gpk_update_viewer_row_is_selectable (GtkTreeModel *model, GtkTreeIter *iter, PkInfoEnum info)
+{
+	GtkTreeIter parent;
+
+	if (info == PK_INFO_ENUM_BLOCKED ||
+	    !gpk_update_viewer_info_is_update_enum (info))
+		return FALSE;
+	return gtk_tree_model_iter_parent (model, &parent, iter);
+}
+
+static void
+gpk_update_viewer_selection_update_restart_worst (void)
+{
+	gint i;
+
+	restart_worst = PK_RESTART_ENUM_NONE;
+	for (i = PK_RESTART_ENUM_LAST - 1; i > PK_RESTART_ENUM_NONE; i--) {
+		if (restart_counts[i] > 0) {
+			restart_worst = i;
+			break;
 		}
+	}
+}
 
-		valid = gtk_tree_model_iter_next (model, &iter);
+static void
+gpk_update_viewer_selection_set (const gchar *package_id,
+				 gboolean selected,
+				 PkInfoEnum info,
+				 guint size,
+				 PkRestartEnum restart,
+				 gboolean update)
+{
+	GpkUpdateViewerSelected *item;
+
+	/* remove the old contribution */
+	item = g_hash_table_lookup (selection_index, package_id);
+	if (item != NULL) {
+		size_total -= item->size;
+		number_total--;
+		if (item->update)
+			number_updates_selected--;
+		restart_counts[item->restart]--;
+		g_hash_table_remove (selection_index, package_id);
 	}
-	return TRUE;
+
+	/* add the new one */
+	if (selected) {
+		if (restart >= PK_RESTART_ENUM_LAST)
+			restart = PK_RESTART_ENUM_UNKNOWN;
+		item = g_new0 (GpkUpdateViewerSelected, 1);
+		item->info = info;
+		item->restart = restart;
+		item->size = size;
+		item->update = update;
+		g_hash_table_insert (selection_index, g_strdup (package_id), item);
+		size_total += size;
+		number_total++;
+		if (item->update)
+			number_updates_selected++;
+		restart_counts[restart]++;
+	}
+	gpk_update_viewer_selection_update_restart_worst ();
+}
+
+static void
+gpk_update_viewer_selection_sync_row (GtkTreeModel *model, GtkTreeIter *iter)
+{
+	gboolean selected;
+	guint size;
+	g_autofree gchar *package_id = NULL;
+	PkInfoEnum info;
+	PkRestartEnum restart;
+
+	gtk_tree_model_get (model, iter,
+			    GPK_UPDATES_COLUMN_ID, &package_id,
+			    GPK_UPDATES_COLUMN_SELECT, &selected,
+			    GPK_UPDATES_COLUMN_INFO, &info,
+			    GPK_UPDATES_COLUMN_SIZE, &size,
+			    GPK_UPDATES_COLUMN_RESTART, &restart,
+			    -1);
+
+	/* section headers are not counted */
+	if (package_id == NULL)
+		return;
+	gpk_update_viewer_selection_set (package_id, selected, info, size, restart,
+					 gpk_update_viewer_row_is_selectable (model, iter, info));
+}
+
+static void
+gpk_update_viewer_selection_clear (void)
+{
+	g_hash_table_remove_all (selection_index);
+	memset (restart_counts, 0, sizeof (restart_counts));
+	size_total = 0;
+	number_total = 0;
+	number_updates_selected = 0;
+	restart_worst = PK_RESTART_ENUM_NONE;
+}
+
+static gboolean
+gpk_update_viewer_are_all_updates_selected (void)
+{
+	return number_updates_selected == number_updates;
 }
 
 static void
@@ -373,8 +521,9 @@ gpk_update_viewer_update_packages_cb (PkTask *_task, GAsyncResult *res, gpointer
 	GtkWindow *window;
 	gboolean ret;
 	const gchar *message;
-	GtkTreeView *treeview;
-	GtkTreeModel *model;
+
+	/* apply any progress that is still queued */
+	gpk_update_viewer_progress_flush_now ();
 
 	/* get the results */
 	results = pk_task_generic_finish (task, res, &error);
@@ -455,9 +604,7 @@ gpk_update_viewer_update_packages_cb (PkTask *_task, GAsyncResult *res, gpointer
 	gtk_label_set_label (GTK_LABEL(widget), text);
 
 	/* do different text depending on if we deselected any */
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
-	ret = gpk_update_viewer_are_all_updates_selected (model);
+	ret = gpk_update_viewer_are_all_updates_selected ();
 	if (ret) {
 		/* TRANSLATORS: title: all updates for the machine installed okay */
 		message = _("All updates were installed successfully.");
@@ -498,143 +645,144 @@ out:
 	ignore_updates_changed = FALSE;
 }
 
-static GSList *active_rows = NULL;
-static guint active_row_timeout_id = 0;
-
-static gint
-gpk_update_viewer_compare_refs (GtkTreeRowReference *a, GtkTreeRowReference *b)
-{
-	GtkTreeModel *am, *bm;
-	GtkTreePath *ap, *bp;
-	gint res;
-
-	am = gtk_tree_row_reference_get_model (a);
-	bm = gtk_tree_row_reference_get_model (b);
-
-	res = 1;
-	if (am == bm) {
-		ap = gtk_tree_row_reference_get_path (a);
-		bp = gtk_tree_row_reference_get_path (b);
-
-		res = gtk_tree_path_compare (ap, bp);
-
-		gtk_tree_path_free (ap);
-		gtk_tree_path_free (bp);
-	}
-
-	return res;
-}
+static GHashTable *active_rows = NULL;
+static guint active_rows_tick_id = 0;
+static gint64 active_rows_pulse_last = -1;
 
 static gboolean
-gpk_update_viewer_pulse_active_rows (gpointer user_data)
+gpk_update_viewer_active_rows_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
 {
-	GSList *l;
-	GtkTreeRowReference *ref;
+	GHashTableIter hash_iter;
+	GtkTreeIter iter;
 	GtkTreeModel *model;
+	GtkTreePath *end = NULL;
 	GtkTreePath *path;
-	GtkTreeIter iter;
-	gint val;
-
-	for (l = active_rows; l; l = l->next) {
-		ref = l->data;
-		model = gtk_tree_row_reference_get_model (ref);
+	GtkTreePath *start = NULL;
+	GtkTreeRowReference *ref;
+	gint64 pulse;
+
+	/* advance the spinners at the same rate whatever the frame rate */
+	pulse = gdk_frame_clock_get_frame_time (frame_clock) / (GPK_UPDATE_VIEWER_PULSE_INTERVAL * 1000);
+	if (pulse == active_rows_pulse_last)
+		return G_SOURCE_CONTINUE;
+	active_rows_pulse_last = pulse;
+
+	/* rows scrolled out of view don't need redrawing */
+	if (!gtk_tree_view_get_visible_range (GTK_TREE_VIEW (widget), &start, &end))
+		return G_SOURCE_CONTINUE;
+	model = GTK_TREE_MODEL (array_store_updates);
+	g_hash_table_iter_init (&hash_iter, active_rows);
+	while (g_hash_table_iter_next (&hash_iter, NULL, (gpointer *) &ref)) {
 		path = gtk_tree_row_reference_get_path (ref);
-		if (path) {
-			gtk_tree_model_get_iter (model, &iter, path);
-			gtk_tree_model_get (model, &iter, GPK_UPDATES_COLUMN_PULSE, &val, -1);
-			gtk_tree_store_set (GTK_TREE_STORE(model), &iter, GPK_UPDATES_COLUMN_PULSE, val + 1, -1);
-			gtk_tree_path_free (path);
+		if (path == NULL) {
+			/* the row has been deleted from the model */
+			g_hash_table_iter_remove (&hash_iter);
+			continue;
+		}
+		if (gtk_tree_path_compare (path, start) >= 0 &&
+		    gtk_tree_path_compare (path, end) <= 0 &&
+		    gtk_tree_model_get_iter (model, &iter, path)) {
+			gtk_tree_store_set (array_store_updates, &iter,
+					    GPK_UPDATES_COLUMN_PULSE, (gint) (pulse % 120),
+					    -1);
 		}
+		gtk_tree_path_free (path);
 	}
+	gtk_tree_path_free (start);
+	gtk_tree_path_free (end);
+	return G_SOURCE_CONTINUE;
+}
 
-	return TRUE;
+static void
+gpk_update_viewer_active_rows_stop (void)
+{
+	GtkWidget *widget;
+
+	if (active_rows_tick_id == 0)
+		return;
+	widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
+	gtk_widget_remove_tick_callback (widget, active_rows_tick_id);
+	active_rows_tick_id = 0;
+	active_rows_pulse_last = -1;
 }
 
 static void
-gpk_update_viewer_add_active_row (GtkTreeModel *model, GtkTreePath *path)
+gpk_update_viewer_add_active_row (GtkTreeModel *model, GtkTreePath *path, const gchar *package_id)
 {
 	GtkTreeRowReference *ref;
-	GSList *row = NULL;
+	GtkWidget *widget;
 
 	/* check if already active */
+	if (g_hash_table_contains (active_rows, package_id))
+		return;
 	ref = gtk_tree_row_reference_new (model, path);
 	if (ref == NULL)
 		return;
-	row = g_slist_find_custom (active_rows, (gconstpointer)ref, (GCompareFunc)gpk_update_viewer_compare_refs);
-	if (row != NULL) {
-		g_debug ("already active");
-		gtk_tree_row_reference_free (ref);
-		return;
-	}
-
-	/* add poll */
-	if (active_row_timeout_id == 0) {
-		active_row_timeout_id = g_timeout_add (60, (GSourceFunc)gpk_update_viewer_pulse_active_rows, NULL);
-		g_source_set_name_by_id (active_row_timeout_id, "[GpkUpdateViewer] pulse row");
+	g_hash_table_insert (active_rows, g_strdup (package_id), ref);
+
+	/* pulse on each frame that is drawn */
+	if (active_rows_tick_id == 0) {
+		widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
+		active_rows_tick_id = gtk_widget_add_tick_callback (widget,
+								    gpk_update_viewer_active_rows_tick_cb,
+								    NULL, NULL);
 	}
-	active_rows = g_slist_prepend (active_rows, ref);
 }
 
 static void
-gpk_update_viewer_remove_active_row (GtkTreeModel *model, GtkTreePath *path)
+gpk_update_viewer_remove_active_row (GtkTreeModel *model, GtkTreePath *path, const gchar *package_id)
 {
-	GSList *row;
-	GtkTreeRowReference *ref;
 	GtkTreeIter iter;
 
 	gtk_tree_model_get_iter (model, &iter, path);
 	gtk_tree_store_set (GTK_TREE_STORE(model), &iter, GPK_UPDATES_COLUMN_PULSE, -1, -1);
 
-	ref = gtk_tree_row_reference_new (model, path);
-	row = g_slist_find_custom (active_rows, (gconstpointer)ref, (GCompareFunc)gpk_update_viewer_compare_refs);
-	gtk_tree_row_reference_free (ref);
-	if (row == NULL) {
-		g_warning ("row not already added");
+	/* the start and finish may have arrived in the same frame */
+	if (!g_hash_table_remove (active_rows, package_id))
 		return;
-	}
-
-	active_rows = g_slist_remove_link (active_rows, row);
-	gtk_tree_row_reference_free (row->data);
-	g_slist_free (row);
-
-	if (active_rows == NULL) {
-		g_source_remove (active_row_timeout_id);
-		active_row_timeout_id = 0;
-	}
+	if (g_hash_table_size (active_rows) == 0)
+		gpk_update_viewer_active_rows_stop ();
 }
 
-static gboolean
-gpk_update_viewer_find_iter_model_cb (GtkTreeModel *model,
-				      GtkTreePath *path,
-				      GtkTreeIter *iter,
-				      const gchar *package_id)
+static void
+gpk_update_viewer_index_add (GtkTreeModel *model, GtkTreeIter *iter, const gchar *package_id)
 {
-	g_autofree gchar *package_id_tmp = NULL;
-	GtkTreePath **_path = NULL;
+	GtkTreePath *path;
+	GtkTreeRowReference *ref;
 
-	gtk_tree_model_get (model, iter,
-			    GPK_UPDATES_COLUMN_ID, &package_id_tmp,
-			    -1);
-	if (package_id_tmp == NULL)
-		return FALSE;
+	path = gtk_tree_model_get_path (model, iter);
+	ref = gtk_tree_row_reference_new (model, path);
+	gtk_tree_path_free (path);
+	if (ref == NULL)
+		return;
+	g_hash_table_insert (package_id_index, g_strdup (package_id), ref);
+}
 
-	/* match on the package id */
-	if (g_strcmp0 (package_id, package_id_tmp) == 0) {
-		_path = (GtkTreePath **) g_object_get_data (G_OBJECT(model), "_path");
-		*_path = gtk_tree_path_copy (path);
-		return TRUE;
-	}
-	return FALSE;
+static void
+gpk_update_viewer_index_clear (void)
+{
+	g_hash_table_remove_all (package_id_index);
+	number_updates = 0;
 }
 
 static GtkTreePath *
 gpk_update_viewer_model_get_path (GtkTreeModel *model, const gchar *package_id)
 {
-	GtkTreePath *path = NULL;
+	GtkTreePath *path;
+	GtkTreeRowReference *ref;
+
 	g_return_val_if_fail (package_id != NULL, NULL);
-	g_object_set_data (G_OBJECT(model), "_path", (gpointer) &path);
-	gtk_tree_model_foreach (model, (GtkTreeModelForeachFunc) gpk_update_viewer_find_iter_model_cb, (gpointer) package_id);
-	g_object_steal_data (G_OBJECT(model), "_path");
+
+	/* the row reference follows the row across inserts and re-sorts */
+	ref = g_hash_table_lookup (package_id_index, package_id);
+	if (ref == NULL)
+		return NULL;
+	path = gtk_tree_row_reference_get_path (ref);
+	if (path == NULL) {
+		/* the row has been deleted from the model */
+		g_hash_table_remove (package_id_index, package_id);
+		return NULL;
+	}
 	return path;
 }
 
@@ -674,23 +822,20 @@ gpk_update_view_get_info_headers (PkInfoEnum info)
 	return text;
 }
 
+static void
+gpk_update_viewer_headers_clear (void)
+{
+	guint i;
+	for (i = 0; i < PK_INFO_ENUM_LAST; i++)
+		g_clear_pointer (&header_refs[i], gtk_tree_row_reference_free);
+}
+
 static void
 gpk_update_viewer_get_parent_for_info (PkInfoEnum info, GtkTreeIter *parent)
 {
-	gboolean is_package;
-	gboolean ret = FALSE;
-	gboolean valid;
 	g_autofree gchar *title = NULL;
-	GtkTreeIter iter;
-	GtkTreeModel *model;
-	GtkTreeView *treeview;
-	PkInfoEnum info_tmp;
-
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
-
-	/* get the first iter in the array */
-	valid = gtk_tree_model_get_iter_first (model, &iter);
+	GtkTreeModel *model = GTK_TREE_MODEL (array_store_updates);
+	GtkTreePath *path;
 
 	/* smush some update states together */
 	switch (info) {
@@ -701,37 +846,123 @@ gpk_update_viewer_get_parent_for_info (PkInfoEnum info, GtkTreeIter *parent)
 	default:
 		break;
 	}
+	if (info >= PK_INFO_ENUM_LAST)
+		info = PK_INFO_ENUM_UNKNOWN;
+
+	/* use the cached section header if it's still in the model */
+	if (header_refs[info] != NULL) {
+		path = gtk_tree_row_reference_get_path (header_refs[info]);
+		if (path != NULL) {
+			gboolean ret = gtk_tree_model_get_iter (model, parent, path);
+			gtk_tree_path_free (path);
+			if (ret)
+				return;
+		}
+		g_clear_pointer (&header_refs[info], gtk_tree_row_reference_free);
+	}
 
-	/* find out how many we should update */
-	while (valid) {
-		g_autofree gchar *package_id_tmp = NULL;
-		gtk_tree_model_get (model, &iter,
-				    GPK_UPDATES_COLUMN_INFO, &info_tmp,
-				    GPK_UPDATES_COLUMN_ID, &package_id_tmp,
-				    -1);
-		is_package = package_id_tmp != NULL;
+	/* create */
+	title = g_strdup_printf ("<b>%s</b>",
+				 gpk_update_view_get_info_headers (info));
+	gtk_tree_store_append (array_store_updates, parent, NULL);
+	gtk_tree_store_set (array_store_updates, parent,
+			    GPK_UPDATES_COLUMN_TEXT, title,
+			    GPK_UPDATES_COLUMN_ID, NULL,
+			    GPK_UPDATES_COLUMN_INFO, info,
+			    GPK_UPDATES_COLUMN_SELECT, TRUE,
+			    GPK_UPDATES_COLUMN_VISIBLE, FALSE,
+			    GPK_UPDATES_COLUMN_CLICKABLE, FALSE,
+			    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
+			    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
+			    GPK_UPDATES_COLUMN_SIZE, 0,
+			    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
+			    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
+			    GPK_UPDATES_COLUMN_PULSE, -1,
+			    -1);
+	path = gtk_tree_model_get_path (model, parent);
+	header_refs[info] = gtk_tree_row_reference_new (model, path);
+	gtk_tree_path_free (path);
+}
 
-		/* right section? */
-		if (!is_package && info_tmp == info) {
-			*parent = iter;
-			ret = TRUE;
-			break;
-		}
+typedef struct {
+	gchar			*package_id;
+	gchar			*summary;
+	PkRoleEnum		 role;
+	PkInfoEnum		 info;
+	PkInfoEnum		 info_active;
+	gint			 percentage;
+	gboolean		 has_package;
+} GpkUpdateViewerProgressItem;
 
-		valid = gtk_tree_model_iter_next (model, &iter);
+static void
+gpk_update_viewer_progress_item_free (GpkUpdateViewerProgressItem *item)
+{
+	g_free (item->package_id);
+	g_free (item->summary);
+	g_free (item);
+}
+
+static GpkUpdateViewerProgressItem *
+gpk_update_viewer_progress_item_ensure (const gchar *package_id)
+{
+	GpkUpdateViewerProgressItem *item;
+
+	item = g_hash_table_lookup (progress_pending, package_id);
+	if (item != NULL)
+		return item;
+
+	/* keep the arrival order so new rows are appended as before */
+	item = g_new0 (GpkUpdateViewerProgressItem, 1);
+	item->package_id = g_strdup (package_id);
+	item->info = PK_INFO_ENUM_UNKNOWN;
+	item->info_active = PK_INFO_ENUM_UNKNOWN;
+	item->percentage = -1;
+	g_ptr_array_add (progress_pending_order, item);
+	g_hash_table_insert (progress_pending, item->package_id, item);
+	return item;
+}
+
+static GtkTreePath *
+gpk_update_viewer_progress_apply_package (GtkTreeView *treeview,
+					  GtkTreeModel *model,
+					  GpkUpdateViewerProgressItem *item)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	PkInfoEnum info = item->info;
+
+	/* enable or disable the correct spinners */
+	path = gpk_update_viewer_model_get_path (model, item->package_id);
+	if (path != NULL && item->role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
+		if (info == PK_INFO_ENUM_FINISHED)
+			gpk_update_viewer_remove_active_row (model, path, item->package_id);
+		else
+			gpk_update_viewer_add_active_row (model, path, item->package_id);
 	}
 
-	/* create */
-	if (!ret) {
-		title = g_strdup_printf ("<b>%s</b>",
-					 gpk_update_view_get_info_headers (info));
+	/* used for progress */
+	if (g_strcmp0 (package_id_last, item->package_id) != 0) {
+		g_free (package_id_last);
+		package_id_last = g_strdup (item->package_id);
+	}
+
+	/* update icon */
+	if (path == NULL) {
+		g_autofree gchar *text = NULL;
+		text = gpk_package_id_format_twoline (gtk_widget_get_style_context (GTK_WIDGET (treeview)),
+						      item->package_id,
+						      item->summary);
+		g_debug ("adding: id=%s, text=%s", item->package_id, text);
+
+		/* add to model */
 		gtk_tree_store_append (array_store_updates, &iter, NULL);
 		gtk_tree_store_set (array_store_updates, &iter,
-				    GPK_UPDATES_COLUMN_TEXT, title,
-				    GPK_UPDATES_COLUMN_ID, NULL,
+				    GPK_UPDATES_COLUMN_TEXT, text,
+				    GPK_UPDATES_COLUMN_ID, item->package_id,
 				    GPK_UPDATES_COLUMN_INFO, info,
 				    GPK_UPDATES_COLUMN_SELECT, TRUE,
-				    GPK_UPDATES_COLUMN_VISIBLE, FALSE,
+				    GPK_UPDATES_COLUMN_VISIBLE, TRUE,
+				    GPK_UPDATES_COLUMN_SENSITIVE, FALSE,
 				    GPK_UPDATES_COLUMN_CLICKABLE, FALSE,
 				    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
 				    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
@@ -740,148 +971,243 @@ gpk_update_viewer_get_parent_for_info (PkInfoEnum info, GtkTreeIter *parent)
 				    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
 				    GPK_UPDATES_COLUMN_PULSE, -1,
 				    -1);
-		*parent = iter;
+		gpk_update_viewer_index_add (model, &iter, item->package_id);
+		path = gpk_update_viewer_model_get_path (model, item->package_id);
+		if (path == NULL) {
+			g_warning ("found no package %s", item->package_id);
+			return NULL;
+		}
+
+		/* a new row, so the spinner could not be started above */
+		if (item->role == PK_ROLE_ENUM_UPDATE_PACKAGES &&
+		    info != PK_INFO_ENUM_FINISHED)
+			gpk_update_viewer_add_active_row (model, path, item->package_id);
+	}
+
+	gtk_tree_model_get_iter (model, &iter, path);
+
+	/* only change the status when we're doing the actual update */
+	if (item->role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
+		/* if we are adding deps, then select the checkbox */
+		gtk_tree_store_set (array_store_updates, &iter,
+				    GPK_UPDATES_COLUMN_SELECT, TRUE,
+				    -1);
+		gpk_update_viewer_selection_sync_row (model, &iter);
+
+		/* if the info is finished, change the status to past tense */
+		if (info == PK_INFO_ENUM_FINISHED) {
+			/* clear the remaining size */
+			gtk_tree_store_set (array_store_updates, &iter,
+					    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0, -1);
+
+			/* the active state may have been coalesced away */
+			info = item->info_active;
+			if (info == PK_INFO_ENUM_UNKNOWN) {
+				gtk_tree_model_get (model, &iter,
+						    GPK_UPDATES_COLUMN_STATUS, &info, -1);
+			}
+			/* promote to past tense if present tense */
+			if (info < PK_INFO_ENUM_LAST)
+				info += PK_INFO_ENUM_LAST;
+		}
+		gtk_tree_store_set (array_store_updates, &iter,
+				    GPK_UPDATES_COLUMN_STATUS, info, -1);
 	}
+	return path;
 }
 
 static void
-gpk_update_viewer_progress_cb (PkProgress *progress,
-			       PkProgressType type,
-			       gpointer user_data)
+gpk_update_viewer_progress_apply_item_progress (GtkTreeModel *model,
+						GpkUpdateViewerProgressItem *item)
 {
-	gboolean allow_cancel;
-	g_autoptr(PkPackage) package = NULL;
-	gint percentage;
-	GtkWidget *widget;
-	guint64 transaction_flags;
-	PkInfoEnum info;
-	PkRoleEnum role;
-	PkStatusEnum status;
-	g_autofree gchar *package_id = NULL;
-	g_autofree gchar *summary = NULL;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	guint size;
+	guint size_display;
 
-	g_object_get (progress,
-		      "role", &role,
-		      "status", &status,
-		      "percentage", &percentage,
-		      "package", &package,
-		      "allow-cancel", &allow_cancel,
-		      "transaction-flags", &transaction_flags,
-		      NULL);
+	path = gpk_update_viewer_model_get_path (model, item->package_id);
+	if (path == NULL) {
+		g_debug ("not found ID for %s", item->package_id);
+		return;
+	}
 
-	if (type == PK_PROGRESS_TYPE_PACKAGE) {
-
-		GtkTreeView *treeview;
-		GtkTreeIter iter;
-		GtkTreeModel *model;
-		GtkTreeViewColumn *column;
-		GtkTreePath *path;
-		gboolean scroll;
-
-		/* ignore simulation phase */
-		if (pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE))
-			return;
-
-		/* add the results, not the progress */
-		if (role == PK_ROLE_ENUM_GET_UPDATES)
-			return;
+	gtk_tree_model_get_iter (model, &iter, path);
+	gtk_tree_model_get (model, &iter,
+			    GPK_UPDATES_COLUMN_SIZE, &size,
+			    -1);
+	size_display = size - ((size * item->percentage) / 100);
+	gtk_tree_store_set (array_store_updates, &iter,
+			    GPK_UPDATES_COLUMN_PERCENTAGE, item->percentage,
+			    GPK_UPDATES_COLUMN_SIZE_DISPLAY, size_display,
+			    -1);
+	gtk_tree_path_free (path);
+}
 
-		g_object_get (package,
-			      "info", &info,
-			      "package-id", &package_id,
-			      "summary", &summary,
-			      NULL);
+static void
+gpk_update_viewer_progress_flush (void)
+{
+	GpkUpdateViewerProgressItem *item;
+	GtkTreeModel *model;
+	GtkTreePath *path_scroll = NULL;
+	GtkTreeView *treeview;
+	GtkTreeViewColumn *column;
+	guint i;
 
-		/* find model */
-		treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-		model = gtk_tree_view_get_model (treeview);
+	if (progress_pending_order->len == 0)
+		return;
 
-		/* enable or disable the correct spinners */
-		if (role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
-			path = gpk_update_viewer_model_get_path (model, package_id);
+	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
+	model = gtk_tree_view_get_model (treeview);
+	for (i = 0; i < progress_pending_order->len; i++) {
+		item = g_ptr_array_index (progress_pending_order, i);
+		if (item->has_package) {
+			GtkTreePath *path;
+			path = gpk_update_viewer_progress_apply_package (treeview, model, item);
 			if (path != NULL) {
-				if (info == PK_INFO_ENUM_FINISHED)
-					gpk_update_viewer_remove_active_row (model, path);
-				else
-					gpk_update_viewer_add_active_row (model, path);
+				gtk_tree_path_free (path_scroll);
+				path_scroll = path;
 			}
-			gtk_tree_path_free (path);
+			progress_events_applied++;
+		}
+		if (item->percentage > 0) {
+			gpk_update_viewer_progress_apply_item_progress (model, item);
+			progress_events_applied++;
 		}
+	}
+	g_hash_table_remove_all (progress_pending);
+	g_ptr_array_set_size (progress_pending_order, 0);
 
-		/* used for progress */
-		if (g_strcmp0 (package_id_last, package_id) != 0) {
-			g_free (package_id_last);
-			package_id_last = g_strdup (package_id);
+	/* scroll to the active cell, once per flush */
+	if (path_scroll != NULL) {
+		if (g_settings_get_boolean (settings, GPK_SETTINGS_SCROLL_ACTIVE)) {
+			column = gtk_tree_view_get_column (treeview, 3);
+			gtk_tree_view_scroll_to_cell (treeview, path_scroll, column, FALSE, 0.0f, 0.0f);
 		}
+		gtk_tree_path_free (path_scroll);
+	}
+}
 
-		/* update icon */
-		path = gpk_update_viewer_model_get_path (model, package_id);
-		if (path == NULL) {
-			g_autofree gchar *text = NULL;
-			text = gpk_package_id_format_twoline (gtk_widget_get_style_context (GTK_WIDGET (treeview)),
-							      package_id,
-							      summary);
-			g_debug ("adding: id=%s, text=%s", package_id, text);
+static gboolean
+gpk_update_viewer_progress_tick_cb (GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data)
+{
+	progress_tick_id = 0;
+	gpk_update_viewer_progress_flush ();
+	return G_SOURCE_REMOVE;
+}
 
-			/* add to model */
-			gtk_tree_store_append (array_store_updates, &iter, NULL);
-			gtk_tree_store_set (array_store_updates, &iter,
-					    GPK_UPDATES_COLUMN_TEXT, text,
-					    GPK_UPDATES_COLUMN_ID, package_id,
-					    GPK_UPDATES_COLUMN_INFO, info,
-					    GPK_UPDATES_COLUMN_SELECT, TRUE,
-					    GPK_UPDATES_COLUMN_VISIBLE, TRUE,
-					    GPK_UPDATES_COLUMN_SENSITIVE, FALSE,
-					    GPK_UPDATES_COLUMN_CLICKABLE, FALSE,
-					    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
-					    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
-					    GPK_UPDATES_COLUMN_SIZE, 0,
-					    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
-					    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
-					    GPK_UPDATES_COLUMN_PULSE, -1,
-					    -1);
-			path = gpk_update_viewer_model_get_path (model, package_id);
-			if (path == NULL) {
-				g_warning ("found no package %s", package_id);
-				return;
-			}
-		}
+static gboolean
+gpk_update_viewer_progress_timeout_cb (gpointer user_data)
+{
+	progress_timeout_id = 0;
+	gpk_update_viewer_progress_flush ();
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpk_update_viewer_progress_cancel_flush (void)
+{
+	GtkWidget *widget;
 
-		gtk_tree_model_get_iter (model, &iter, path);
+	if (progress_tick_id != 0) {
+		widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
+		gtk_widget_remove_tick_callback (widget, progress_tick_id);
+		progress_tick_id = 0;
+	}
+	if (progress_timeout_id != 0) {
+		g_source_remove (progress_timeout_id);
+		progress_timeout_id = 0;
+	}
+}
 
-		/* if we are adding deps, then select the checkbox */
-		if (role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
-			gtk_tree_store_set (array_store_updates, &iter,
-					    GPK_UPDATES_COLUMN_SELECT, TRUE,
-					    -1);
-		}
+static void
+gpk_update_viewer_progress_schedule_flush (void)
+{
+	GtkWidget *widget;
+	guint interval;
 
-		/* scroll to the active cell */
-		scroll = g_settings_get_boolean (settings, GPK_SETTINGS_SCROLL_ACTIVE);
-		if (scroll) {
-			column = gtk_tree_view_get_column (treeview, 3);
-			gtk_tree_view_scroll_to_cell (treeview, path, column, FALSE, 0.0f, 0.0f);
-		}
+	/* already pending */
+	if (progress_tick_id != 0 || progress_timeout_id != 0)
+		return;
 
-		/* only change the status when we're doing the actual update */
-		if (role == PK_ROLE_ENUM_UPDATE_PACKAGES) {
-			/* if the info is finished, change the status to past tense */
-			if (info == PK_INFO_ENUM_FINISHED) {
-				/* clear the remaining size */
-				gtk_tree_store_set (array_store_updates, &iter,
-						    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0, -1);
+	/* sync to the frame clock unless a fixed rate has been asked for */
+	interval = g_settings_get_uint (settings, GPK_SETTINGS_PROGRESS_UPDATE_INTERVAL);
+	widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
+	if (interval == 0 && gtk_widget_get_realized (widget)) {
+		progress_tick_id = gtk_widget_add_tick_callback (widget,
+								 gpk_update_viewer_progress_tick_cb,
+								 NULL, NULL);
+		return;
+	}
+	if (interval == 0)
+		interval = GPK_UPDATE_VIEWER_PROGRESS_FLUSH_FALLBACK;
+	progress_timeout_id = g_timeout_add (interval, gpk_update_viewer_progress_timeout_cb, NULL);
+	g_source_set_name_by_id (progress_timeout_id, "[GpkUpdateViewer] progress flush");
+}
 
-				gtk_tree_model_get (model, &iter,
-						    GPK_UPDATES_COLUMN_STATUS, &info, -1);
-				/* promote to past tense if present tense */
-				if (info < PK_INFO_ENUM_LAST)
-					info += PK_INFO_ENUM_LAST;
-			}
-			gtk_tree_store_set (array_store_updates, &iter,
-					    GPK_UPDATES_COLUMN_STATUS, info, -1);
-		}
+static void
+gpk_update_viewer_progress_flush_now (void)
+{
+	gpk_update_viewer_progress_cancel_flush ();
+	gpk_update_viewer_progress_flush ();
+	g_debug ("progress events: %u received, %u applied",
+		 progress_events_received, progress_events_applied);
+}
 
-		gtk_tree_path_free (path);
+static void
+gpk_update_viewer_progress_discard (void)
+{
+	gpk_update_viewer_progress_cancel_flush ();
+	g_hash_table_remove_all (progress_pending);
+	g_ptr_array_set_size (progress_pending_order, 0);
+}
+
+static void
+gpk_update_viewer_progress_cb (PkProgress *progress,
+			       PkProgressType type,
+			       gpointer user_data)
+{
+	gint percentage;
+	GtkWidget *widget;
+	guint64 transaction_flags;
+	PkRoleEnum role;
+	PkStatusEnum status;
+
+	if (type == PK_PROGRESS_TYPE_PACKAGE) {
+
+		GpkUpdateViewerProgressItem *item;
+		g_autoptr(PkPackage) package = NULL;
+		PkInfoEnum info;
+
+		g_object_get (progress,
+			      "role", &role,
+			      "package", &package,
+			      "transaction-flags", &transaction_flags,
+			      NULL);
+
+		/* ignore simulation phase */
+		if (pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE))
+			return;
+
+		/* add the results, not the progress */
+		if (role == PK_ROLE_ENUM_GET_UPDATES)
+			return;
+
+		/* only keep the latest state, it is applied on the next frame */
+		progress_events_received++;
+		info = pk_package_get_info (package);
+		item = gpk_update_viewer_progress_item_ensure (pk_package_get_id (package));
+		item->has_package = TRUE;
+		item->role = role;
+		item->info = info;
+		if (info != PK_INFO_ENUM_FINISHED)
+			item->info_active = info;
+
+		/* a finished row must not be overwritten by a stale percentage */
+		if (info == PK_INFO_ENUM_FINISHED)
+			item->percentage = -1;
+		if (item->summary == NULL)
+			item->summary = g_strdup (pk_package_get_summary (package));
+		gpk_update_viewer_progress_schedule_flush ();
 
 	} else if (type == PK_PROGRESS_TYPE_STATUS) {
 
@@ -890,6 +1216,9 @@ gpk_update_viewer_progress_cb (PkProgress *progress,
 		GdkDisplay *display;
 		g_autoptr(GdkCursor) cursor = NULL;
 
+		g_object_get (progress,
+			      "status", &status,
+			      NULL);
 		g_debug ("status %s", pk_status_enum_to_string (status));
 
 		/* use correct status pane */
@@ -937,6 +1266,9 @@ gpk_update_viewer_progress_cb (PkProgress *progress,
 
 	} else if (type == PK_PROGRESS_TYPE_PERCENTAGE) {
 
+		g_object_get (progress,
+			      "percentage", &percentage,
+			      NULL);
 		widget = GTK_WIDGET(gtk_builder_get_object (builder, "progressbar_progress"));
 		gtk_widget_show (widget);
 		if (percentage != -1)
@@ -944,45 +1276,28 @@ gpk_update_viewer_progress_cb (PkProgress *progress,
 
 	} else if (type == PK_PROGRESS_TYPE_ITEM_PROGRESS) {
 
-		GtkTreeView *treeview;
-		GtkTreeModel *model;
-		GtkTreeIter iter;
-		GtkTreePath *path;
-		guint size;
-		guint size_display;
-		PkItemProgress *item_progress;
-
-		/* ignore simulation phase */
-		if (pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE))
-			return;
+		GpkUpdateViewerProgressItem *item;
+		g_autoptr(PkItemProgress) item_progress = NULL;
 
 		g_object_get (progress,
 			      "item-progress", &item_progress,
+			      "transaction-flags", &transaction_flags,
 			      NULL);
 
-		treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-		model = gtk_tree_view_get_model (treeview);
-		path = gpk_update_viewer_model_get_path (model,
-							 pk_item_progress_get_package_id (item_progress));
-		if (path == NULL) {
-			g_debug ("not found ID for %s",
-				 pk_item_progress_get_package_id (item_progress));
+		/* ignore simulation phase */
+		if (pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE))
 			return;
-		}
 
-		gtk_tree_model_get_iter (model, &iter, path);
-		gtk_tree_model_get (model, &iter,
-				    GPK_UPDATES_COLUMN_SIZE, &size,
-				    -1);
+		/* only keep the latest percentage, it is applied on the next frame */
+		progress_events_received++;
 		percentage = pk_item_progress_get_percentage (item_progress);
-		if (percentage > 0) {
-			size_display = size - ((size * percentage) / 100);
-			gtk_tree_store_set (array_store_updates, &iter,
-					    GPK_UPDATES_COLUMN_PERCENTAGE, percentage,
-					    GPK_UPDATES_COLUMN_SIZE_DISPLAY, size_display,
-					    -1);
-		}
-		gtk_tree_path_free (path);
+		if (percentage <= 0)
+			return;
+		item = gpk_update_viewer_progress_item_ensure (pk_item_progress_get_package_id (item_progress));
+		if (item->has_package && item->info == PK_INFO_ENUM_FINISHED)
+			return;
+		item->percentage = percentage;
+		gpk_update_viewer_progress_schedule_flush ();
 	}
 }
 
@@ -996,82 +1311,311 @@ gpk_update_viewer_client_notify_idle_cb (PkClient *client, GParamSpec *pspec, gp
 	g_debug ("client is idle: %i", idle);
 }
 
-static gboolean
-gpk_update_viewer_info_is_update_enum (PkInfoEnum info)
+static GPtrArray *
+gpk_update_viewer_get_install_package_ids (void)
 {
-	gboolean ret = FALSE;
-	switch (info) {
-	case PK_INFO_ENUM_AVAILABLE:
-	case PK_INFO_ENUM_LOW:
-	case PK_INFO_ENUM_NORMAL:
-	case PK_INFO_ENUM_IMPORTANT:
-	case PK_INFO_ENUM_SECURITY:
-	case PK_INFO_ENUM_BUGFIX:
-	case PK_INFO_ENUM_ENHANCEMENT:
-	case PK_INFO_ENUM_BLOCKED:
-		ret = TRUE;
-		break;
-	default:
-		break;
+	GHashTableIter iter;
+	GPtrArray *array;
+	GpkUpdateViewerSelected *item;
+	const gchar *package_id;
+
+	/* if selected, and not added previously because of deps */
+	array = g_ptr_array_new_with_free_func (g_free);
+	g_hash_table_iter_init (&iter, selection_index);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &package_id, (gpointer *) &item)) {
+		if (gpk_update_viewer_info_is_update_enum (item->info))
+			g_ptr_array_add (array, g_strdup (package_id));
 	}
-	return ret;
+	return array;
+}
+
+typedef struct {
+	PkInfoEnum		 info;
+	GPtrArray		*package_ids;
+	gdouble			 elapsed;
+	gboolean		 success;
+	gchar			*error_text;
+} GpkUpdateViewerStage;
+
+static GPtrArray *stages = NULL;
+static guint stage_current = 0;
+static GTimer *stage_timer = NULL;
+static GCancellable *stage_prefetch_cancellable = NULL;
+
+static void gpk_update_viewer_stage_run (void);
+
+static void
+gpk_update_viewer_stage_prefetch_cancel (void)
+{
+	if (stage_prefetch_cancellable == NULL)
+		return;
+	g_cancellable_cancel (stage_prefetch_cancellable);
+	g_clear_object (&stage_prefetch_cancellable);
+}
+
+static void
+gpk_update_viewer_stage_free (GpkUpdateViewerStage *stage)
+{
+	g_ptr_array_unref (stage->package_ids);
+	g_free (stage->error_text);
+	g_free (stage);
 }
 
 static GPtrArray *
-gpk_update_viewer_get_install_package_ids (void)
+gpk_update_viewer_stages_new (void)
 {
-	PkInfoEnum info;
-	gboolean child_valid;
-	gboolean valid;
-	gboolean update;
-	gchar *package_id;
-	GtkTreeIter child_iter;
-	GtkTreeView *treeview;
-	GtkTreeModel *model;
-	GtkTreeIter iter;
+	GHashTableIter iter;
 	GPtrArray *array;
+	GpkUpdateViewerSelected *item;
+	GpkUpdateViewerStage *stage;
+	PkInfoEnum info;
+	const gchar *package_id;
+	guint i;
+	const PkInfoEnum order[] = { PK_INFO_ENUM_SECURITY,
+				     PK_INFO_ENUM_IMPORTANT,
+				     PK_INFO_ENUM_BUGFIX,
+				     PK_INFO_ENUM_NORMAL };
+	GpkUpdateViewerStage *by_order[G_N_ELEMENTS (order)] = { NULL };
+
+	/* one stage per section header, most urgent first; the headers
+	 * that are all called "Other updates" go in the last one */
+	g_hash_table_iter_init (&iter, selection_index);
+	while (g_hash_table_iter_next (&iter, (gpointer *) &package_id, (gpointer *) &item)) {
+		if (!gpk_update_viewer_info_is_update_enum (item->info))
+			continue;
+		info = item->info;
+		if (info == PK_INFO_ENUM_ENHANCEMENT || info == PK_INFO_ENUM_LOW)
+			info = PK_INFO_ENUM_NORMAL;
+		for (i = 0; i < G_N_ELEMENTS (order) - 1; i++) {
+			if (order[i] == info)
+				break;
+		}
+		if (by_order[i] == NULL) {
+			by_order[i] = g_new0 (GpkUpdateViewerStage, 1);
+			by_order[i]->info = order[i];
+			by_order[i]->package_ids = g_ptr_array_new_with_free_func (g_free);
+		}
+		g_ptr_array_add (by_order[i]->package_ids, g_strdup (package_id));
+	}
 
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_update_viewer_stage_free);
+	for (i = 0; i < G_N_ELEMENTS (order); i++) {
+		stage = by_order[i];
+		if (stage != NULL)
+			g_ptr_array_add (array, stage);
+	}
+	return array;
+}
 
-	array = g_ptr_array_new ();
+static void
+gpk_update_viewer_stages_abort (void)
+{
+	GtkWidget *widget;
 
-	/* get the first iter in the array */
-	valid = gtk_tree_model_get_iter_first (model, &iter);
-	while (valid) {
-		gtk_tree_model_get (model, &iter,
-				    GPK_UPDATES_COLUMN_INFO, &info,
-				    GPK_UPDATES_COLUMN_SELECT, &update,
-				    GPK_UPDATES_COLUMN_ID, &package_id, -1);
+	gpk_update_viewer_download_cancel ();
+	gpk_update_viewer_stage_prefetch_cancel ();
+	g_clear_pointer (&stages, g_ptr_array_unref);
+	g_clear_pointer (&stage_timer, g_timer_destroy);
+	ignore_updates_changed = FALSE;
 
-		/* if selected, and not added previously because of deps */
-		if (package_id != NULL &&
-		    update &&
-		    gpk_update_viewer_info_is_update_enum (info))
-			g_ptr_array_add (array, package_id);
-		else
-			g_free (package_id);
+	/* allow clicking again */
+	gpk_update_viewer_packages_set_sensitive (TRUE);
+	widget = GTK_WIDGET(gtk_builder_get_object (builder, "button_install"));
+	gtk_widget_set_sensitive (widget, TRUE);
+}
 
-		/* do for children too */
-		child_valid = gtk_tree_model_iter_children (model, &child_iter, &iter);
-		while (child_valid) {
-			gtk_tree_model_get (model, &child_iter,
-					    GPK_UPDATES_COLUMN_INFO, &info,
-					    GPK_UPDATES_COLUMN_SELECT, &update,
-					    GPK_UPDATES_COLUMN_ID, &package_id, -1);
+static void
+gpk_update_viewer_stages_finished (void)
+{
+	GpkUpdateViewerStage *stage;
+	GtkWidget *dialog;
+	GtkWidget *widget;
+	gboolean all_okay = TRUE;
+	guint i;
+	g_autoptr(GString) summary = g_string_new (NULL);
+	g_autofree gchar *text = NULL;
 
-			/* if selected, and not added previously because of deps */
-			if (update && gpk_update_viewer_info_is_update_enum (info))
-				g_ptr_array_add (array, package_id);
-			else
-				g_free (package_id);
+	/* one line per stage */
+	for (i = 0; i < stages->len; i++) {
+		stage = g_ptr_array_index (stages, i);
+		if (summary->len > 0)
+			g_string_append_c (summary, '\n');
+		if (stage->success) {
+			/* TRANSLATORS: %1 is the type of update, e.g. "Security updates",
+			 * %2 the number of packages and %3 the time taken in seconds */
+			g_string_append_printf (summary, ngettext ("%s: %u package installed in %.0f seconds",
+								   "%s: %u packages installed in %.0f seconds",
+								   stage->package_ids->len),
+						gpk_update_view_get_info_headers (stage->info),
+						stage->package_ids->len,
+						stage->elapsed);
+		} else if (stage->error_text != NULL) {
+			all_okay = FALSE;
+			/* TRANSLATORS: %1 is the type of update, e.g. "Security updates",
+			 * %2 is the error message */
+			g_string_append_printf (summary, _("%s: failed: %s"),
+						gpk_update_view_get_info_headers (stage->info),
+						stage->error_text);
+		} else {
+			all_okay = FALSE;
+			/* TRANSLATORS: %s is the type of update, e.g. "Security updates" */
+			g_string_append_printf (summary, _("%s: not installed"),
+						gpk_update_view_get_info_headers (stage->info));
+		}
+	}
 
-			child_valid = gtk_tree_model_iter_next (model, &child_iter);
+	/* show a new title */
+	widget = GTK_WIDGET(gtk_builder_get_object (builder, "label_header_title"));
+	text = g_strdup_printf ("<big><b>%s</b></big>",
+				/* TRANSLATORS: completed all updates */
+				all_okay ? _("Updates installed") :
+				/* TRANSLATORS: some of the update stages failed */
+				_("Some updates were not installed"));
+	gtk_label_set_label (GTK_LABEL(widget), text);
+
+	/* show modal dialog */
+	widget = GTK_WIDGET(gtk_builder_get_object (builder, "dialog_updates"));
+	dialog = gtk_message_dialog_new (GTK_WINDOW(widget), GTK_DIALOG_MODAL,
+					 all_okay ? GTK_MESSAGE_INFO : GTK_MESSAGE_WARNING,
+					 GTK_BUTTONS_OK,
+					 "%s", all_okay ? _("Updates installed") :
+						_("Some updates were not installed"));
+	gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG(dialog),
+						  "%s", summary->str);
+	gtk_window_set_icon_name (GTK_WINDOW(dialog), GPK_ICON_SOFTWARE_UPDATE);
+	gtk_dialog_run (GTK_DIALOG(dialog));
+	gtk_widget_destroy (dialog);
+
+	g_clear_pointer (&stages, g_ptr_array_unref);
+	g_clear_pointer (&stage_timer, g_timer_destroy);
+	ignore_updates_changed = FALSE;
+
+	/* the system state matters more than what failed */
+	if (restart_update == PK_RESTART_ENUM_SYSTEM ||
+	    restart_update == PK_RESTART_ENUM_SESSION ||
+	    restart_update == PK_RESTART_ENUM_SECURITY_SESSION ||
+	    restart_update == PK_RESTART_ENUM_SECURITY_SYSTEM) {
+		gpk_update_viewer_check_restart ();
+		gpk_update_viewer_quit ();
+		return;
+	}
+
+	/* show what is left so the user can try again */
+	if (!all_okay) {
+		gpk_update_viewer_packages_set_sensitive (TRUE);
+		gpk_update_viewer_get_new_update_array ();
+		return;
+	}
+	gpk_update_viewer_quit ();
+}
+
+static void
+gpk_update_viewer_stage_cb (PkTask *_task, GAsyncResult *res, gpointer user_data)
+{
+	GpkUpdateViewerStage *stage;
+	PkRestartEnum restart;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	g_autoptr(PkResults) results = NULL;
+
+	/* apply any progress that is still queued */
+	gpk_update_viewer_progress_flush_now ();
+
+	stage = g_ptr_array_index (stages, stage_current);
+	stage->elapsed = g_timer_elapsed (stage_timer, NULL);
+
+	/* get the results */
+	results = pk_task_generic_finish (task, res, &error);
+	if (results == NULL) {
+		g_warning ("failed to install %s: %s",
+			   pk_info_enum_to_string (stage->info), error->message);
+
+		/* the user said no, so don't carry on with the next stage */
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) ||
+		    g_error_matches (error, PK_CLIENT_ERROR, PK_CLIENT_ERROR_DECLINED_SIMULATION)) {
+			gpk_update_viewer_stages_abort ();
+			return;
 		}
+		stage->error_text = g_strdup (error->message);
+	} else {
+		error_code = pk_results_get_error_code (results);
+		if (error_code != NULL) {
+			g_warning ("failed to install %s: %s, %s",
+				   pk_info_enum_to_string (stage->info),
+				   pk_error_enum_to_string (pk_error_get_code (error_code)),
+				   pk_error_get_details (error_code));
+			stage->error_text = g_strdup (gpk_error_enum_to_localised_text (pk_error_get_code (error_code)));
+		} else {
+			stage->success = TRUE;
 
-		valid = gtk_tree_model_iter_next (model, &iter);
+			/* get the worst restart case */
+			restart = pk_results_get_require_restart_worst (results);
+			if (restart > restart_update)
+				restart_update = restart;
+
+			/* check blocked */
+			array = pk_results_get_package_array (results);
+			gpk_update_viewer_check_blocked_packages (array);
+		}
+	}
+	g_debug ("stage %u (%s, %u packages) %s after %.1fs",
+		 stage_current, pk_info_enum_to_string (stage->info),
+		 stage->package_ids->len,
+		 stage->success ? "completed" : "failed",
+		 stage->elapsed);
+
+	/* next stage, or done */
+	stage_current++;
+	if (stage_current < stages->len) {
+		gpk_update_viewer_stage_run ();
+		return;
+	}
+	gpk_update_viewer_stages_finished ();
+}
+
+static void
+gpk_update_viewer_stage_run (void)
+{
+	GpkUpdateViewerStage *stage;
+	GpkUpdateViewerStage *stage_next;
+	GtkWidget *widget;
+	g_auto(GStrv) package_ids = NULL;
+	g_autofree gchar *text = NULL;
+	g_autofree gchar *title = NULL;
+
+	stage = g_ptr_array_index (stages, stage_current);
+	g_debug ("starting stage %u: %s, %u packages", stage_current,
+		 pk_info_enum_to_string (stage->info), stage->package_ids->len);
+
+	/* show which stage we're on */
+	widget = GTK_WIDGET(gtk_builder_get_object (builder, "label_header_title"));
+	/* TRANSLATORS: %1 is the type of update, e.g. "Security updates",
+	 * %2 and %3 are the stage number and the number of stages */
+	title = g_strdup_printf (_("Installing %s (%u of %u)"),
+				 gpk_update_view_get_info_headers (stage->info),
+				 stage_current + 1, stages->len);
+	text = g_strdup_printf ("<big><b>%s</b></big>", title);
+	gtk_label_set_label (GTK_LABEL(widget), text);
+
+	/* whatever the prefetch did not get, the install downloads itself */
+	gpk_update_viewer_stage_prefetch_cancel ();
+
+	g_timer_start (stage_timer);
+	package_ids = pk_ptr_array_to_strv (stage->package_ids);
+	pk_task_update_packages_async (task, package_ids, cancellable,
+				       (PkProgressCallback) gpk_update_viewer_progress_cb, NULL,
+				       (GAsyncReadyCallback) gpk_update_viewer_stage_cb, NULL);
+
+	/* fetch the next stage while this one installs */
+	if (stage_current + 1 < stages->len) {
+		g_auto(GStrv) package_ids_next = NULL;
+		stage_next = g_ptr_array_index (stages, stage_current + 1);
+		package_ids_next = pk_ptr_array_to_strv (stage_next->package_ids);
+		stage_prefetch_cancellable = g_cancellable_new ();
+		gpk_update_viewer_download_packages (package_ids_next,
+						     stage_prefetch_cancellable);
 	}
-	return array;
 }
 
 static void
@@ -1103,6 +1647,24 @@ gpk_update_viewer_button_install_cb (GtkWidget *widget, gpointer user_data)
 	selection = gtk_tree_view_get_selection (treeview);
 	gtk_tree_selection_unselect_all (selection);
 
+	/* whatever was downloaded in the background is reused from the cache */
+	gpk_update_viewer_download_cancel ();
+
+	/* from now on ignore updates-changed signals */
+	ignore_updates_changed = TRUE;
+
+	/* install the most urgent updates first, one section at a time */
+	if (g_settings_get_boolean (settings, GPK_SETTINGS_STAGED_UPDATES)) {
+		stages = gpk_update_viewer_stages_new ();
+		if (stages->len > 1) {
+			stage_current = 0;
+			stage_timer = g_timer_new ();
+			gpk_update_viewer_stage_run ();
+			return;
+		}
+		g_clear_pointer (&stages, g_ptr_array_unref);
+	}
+
 	/* get the list of updates */
 	array = gpk_update_viewer_get_install_package_ids ();
 	package_ids = pk_ptr_array_to_strv (array);
@@ -1111,9 +1673,6 @@ gpk_update_viewer_button_install_cb (GtkWidget *widget, gpointer user_data)
 	pk_task_update_packages_async (task, package_ids, cancellable,
 				       (PkProgressCallback) gpk_update_viewer_progress_cb, NULL,
 				       (GAsyncReadyCallback) gpk_update_viewer_update_packages_cb, NULL);
-
-	/* from now on ignore updates-changed signals */
-	ignore_updates_changed = TRUE;
 }
 
 static void
@@ -1161,61 +1720,6 @@ gpk_update_viewer_check_mobile_broadband (void)
 	gtk_widget_show (info_mobile);
 }
 
-static void
-gpk_update_viewer_update_global_state_recursive (GtkTreeModel *model, GtkTreeIter *iter)
-{
-	gboolean selected;
-	PkRestartEnum restart;
-	guint size;
-	g_autofree gchar *package_id = NULL;
-	gboolean child_valid;
-	GtkTreeIter child_iter;
-
-	gtk_tree_model_get (model, iter,
-			    GPK_UPDATES_COLUMN_SELECT, &selected,
-			    GPK_UPDATES_COLUMN_RESTART, &restart,
-			    GPK_UPDATES_COLUMN_SIZE, &size,
-			    GPK_UPDATES_COLUMN_ID, &package_id,
-			    -1);
-	if (selected && package_id != NULL) {
-		size_total += size;
-		number_total++;
-		if (restart > restart_worst)
-			restart_worst = restart;
-	}
-
-	/* child entries */
-	child_valid = gtk_tree_model_iter_children (model, &child_iter, iter);
-	while (child_valid) {
-		gpk_update_viewer_update_global_state_recursive (model, &child_iter);
-		child_valid = gtk_tree_model_iter_next (model, &child_iter);
-	}
-}
-
-static void
-gpk_update_viewer_update_global_state (void)
-{
-	gboolean valid;
-	GtkTreeIter iter;
-	GtkTreeView *treeview;
-	GtkTreeModel *model;
-
-	/* reset to zero */
-	size_total = 0;
-	number_total = 0;
-	restart_worst = PK_RESTART_ENUM_NONE;
-
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
-
-	/* if there are no entries selected, deselect the button */
-	valid = gtk_tree_model_get_iter_first (model, &iter);
-	while (valid) {
-		gpk_update_viewer_update_global_state_recursive (model, &iter);
-		valid = gtk_tree_model_iter_next (model, &iter);
-	}
-}
-
 static void
 gpk_update_viewer_modal_error_with_timeout (const gchar *title, const gchar *message)
 {
@@ -1268,9 +1772,6 @@ gpk_update_viewer_reconsider_info (void)
 	g_autofree gchar *text_markup = NULL;
 	PkNetworkEnum state;
 
-	/* update global state */
-	gpk_update_viewer_update_global_state ();
-
 	/* get network state */
 	g_object_get (control,
 		      "network-state", &state,
@@ -1372,6 +1873,149 @@ out:
 	gpk_update_viewer_check_mobile_broadband ();
 }
 
+static void
+gpk_update_viewer_download_mark_downloaded (const gchar *package_id)
+{
+	GtkTreeIter iter;
+	GtkTreeModel *model = GTK_TREE_MODEL (array_store_updates);
+	GtkTreePath *path;
+
+	path = gpk_update_viewer_model_get_path (model, package_id);
+	if (path == NULL)
+		return;
+	gtk_tree_model_get_iter (model, &iter, path);
+	gtk_tree_path_free (path);
+
+	/* nothing left to download for this one */
+	gtk_tree_store_set (array_store_updates, &iter,
+			    GPK_UPDATES_COLUMN_STATUS, GPK_INFO_ENUM_DOWNLOADED,
+			    GPK_UPDATES_COLUMN_SIZE, 0,
+			    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
+			    -1);
+	gpk_update_viewer_selection_sync_row (model, &iter);
+
+	/* so the next start asks again rather than trusting the old size */
+	gpk_update_cache_set_size (update_cache, package_id, 0);
+	gpk_update_viewer_cache_save_queue ();
+}
+
+static void
+gpk_update_viewer_download_progress_cb (PkProgress *progress,
+					PkProgressType type,
+					gpointer user_data)
+{
+	g_autoptr(PkPackage) package = NULL;
+
+	/* the status bar is left for the foreground transactions */
+	if (type != PK_PROGRESS_TYPE_PACKAGE)
+		return;
+	g_object_get (progress,
+		      "package", &package,
+		      NULL);
+	if (package == NULL)
+		return;
+	if (pk_package_get_info (package) != PK_INFO_ENUM_FINISHED)
+		return;
+	gpk_update_viewer_download_mark_downloaded (pk_package_get_id (package));
+
+	/* a staged update owns the buttons and the header */
+	if (stages == NULL)
+		gpk_update_viewer_reconsider_info ();
+}
+
+static void
+gpk_update_viewer_download_cb (PkClient *client, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	PkPackage *item;
+	guint i;
+
+	/* this is only a head start, so failures are not shown */
+	results = pk_client_generic_finish (client, res, &error);
+	if (results == NULL) {
+		g_debug ("background download stopped: %s", error->message);
+		return;
+	}
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_debug ("background download failed: %s, %s",
+			 pk_error_enum_to_string (pk_error_get_code (error_code)),
+			 pk_error_get_details (error_code));
+		return;
+	}
+
+	array = pk_results_get_package_array (results);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		gpk_update_viewer_download_mark_downloaded (pk_package_get_id (item));
+	}
+	g_debug ("downloaded %u packages in the background", array->len);
+	if (stages == NULL)
+		gpk_update_viewer_reconsider_info ();
+}
+
+static void
+gpk_update_viewer_download_cancel (void)
+{
+	if (download_cancellable == NULL)
+		return;
+	g_debug ("cancelling background download");
+	g_cancellable_cancel (download_cancellable);
+	g_clear_object (&download_cancellable);
+}
+
+static void
+gpk_update_viewer_download_packages (gchar **package_ids, GCancellable *cancellable_download)
+{
+	PkBitfield transaction_flags;
+	PkNetworkEnum state;
+
+	/* never use an expensive connection without asking */
+	g_object_get (control,
+		      "network-state", &state,
+		      NULL);
+	if (state == PK_NETWORK_ENUM_OFFLINE ||
+	    state == PK_NETWORK_ENUM_MOBILE) {
+		g_debug ("not downloading in the background on %s",
+			 pk_network_enum_to_string (state));
+		return;
+	}
+
+	g_debug ("downloading %u updates in the background",
+		 g_strv_length (package_ids));
+	transaction_flags = pk_bitfield_from_enums (PK_TRANSACTION_FLAG_ENUM_ONLY_TRUSTED,
+						    PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD,
+						    -1);
+	pk_client_update_packages_async (download_client, transaction_flags,
+					 package_ids, cancellable_download,
+					 (PkProgressCallback) gpk_update_viewer_download_progress_cb, NULL,
+					 (GAsyncReadyCallback) gpk_update_viewer_download_cb, NULL);
+}
+
+static void
+gpk_update_viewer_download_start (void)
+{
+	g_autoptr(GPtrArray) array = NULL;
+	g_auto(GStrv) package_ids = NULL;
+
+	if (!g_settings_get_boolean (settings, GPK_SETTINGS_DOWNLOAD_IN_BACKGROUND))
+		return;
+	if (!pk_bitfield_contain (roles, PK_ROLE_ENUM_UPDATE_PACKAGES))
+		return;
+
+	/* get what would be installed if the user just clicked install */
+	array = gpk_update_viewer_get_install_package_ids ();
+	if (array->len == 0)
+		return;
+	package_ids = pk_ptr_array_to_strv (array);
+	gpk_update_viewer_download_cancel ();
+	download_cancellable = g_cancellable_new ();
+	gpk_update_viewer_download_packages (package_ids, download_cancellable);
+}
+
 static void
 gpk_update_viewer_treeview_update_toggled (GtkCellRendererToggle *cell, gchar *path_str, gpointer user_data)
 {
@@ -1398,12 +2042,14 @@ gpk_update_viewer_treeview_update_toggled (GtkCellRendererToggle *cell, gchar *p
 
 	/* set new value */
 	gtk_tree_store_set (GTK_TREE_STORE(model), &iter, GPK_UPDATES_COLUMN_SELECT, update, -1);
+	gpk_update_viewer_selection_sync_row (model, &iter);
 
 	/* do the same for any children */
 	child_valid = gtk_tree_model_iter_children (model, &child_iter, &iter);
 	while (child_valid) {
 		gtk_tree_store_set (GTK_TREE_STORE(model), &child_iter,
 				    GPK_UPDATES_COLUMN_SELECT, update, -1);
+		gpk_update_viewer_selection_sync_row (model, &child_iter);
 		child_valid = gtk_tree_model_iter_next (model, &child_iter);
 	}
 
@@ -1820,7 +2466,7 @@ gpk_packages_treeview_clicked_cb (GtkTreeSelection *selection, gpointer user_dat
 	GtkTreeIter iter;
 	GtkTreeModel *model;
 	GtkWidget *widget;
-	PkUpdateDetail *item = NULL;
+	g_autoptr(PkUpdateDetail) item = NULL;
 
 	/* This will only work in single or browse selection mode! */
 	ret = gtk_tree_selection_get_selected (selection, &model, &iter);
@@ -1845,92 +2491,165 @@ gpk_packages_treeview_clicked_cb (GtkTreeSelection *selection, gpointer user_dat
 	}
 }
 
-static void
-gpk_update_viewer_get_details_cb (PkClient *client, GAsyncResult *res, gpointer user_data)
+static gboolean
+gpk_update_viewer_cache_save_cb (gpointer user_data)
 {
-	g_autoptr(PkResults) results = NULL;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) array = NULL;
-	PkDetails *item;
-	guint i;
-	guint64 size;
-	GtkWidget *widget;
+
+	cache_save_id = 0;
+	if (!gpk_update_cache_save (update_cache, package_id_index, &error))
+		g_warning ("failed to save update cache: %s", error->message);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpk_update_viewer_cache_save_queue (void)
+{
+	/* batch up the writes from both queries */
+	if (cache_save_id != 0)
+		return;
+	cache_save_id = g_timeout_add_seconds (2, gpk_update_viewer_cache_save_cb, NULL);
+	g_source_set_name_by_id (cache_save_id, "[GpkUpdateViewer] cache-save");
+}
+
+static void
+gpk_update_viewer_select_first (void)
+{
 	GtkTreePath *path;
-	GtkTreeModel *model;
 	GtkTreeSelection *selection;
 	GtkTreeView *treeview;
+
+	/* leave it alone if the user has already picked a row */
+	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
+	selection = gtk_tree_view_get_selection (treeview);
+	if (gtk_tree_selection_count_selected_rows (selection) > 0)
+		return;
+	path = gtk_tree_path_new_first ();
+	gtk_tree_selection_select_path (selection, path);
+	gtk_tree_path_free (path);
+}
+
+static void
+gpk_update_viewer_apply_details (GtkTreeModel *model, PkDetails *item)
+{
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	guint64 size;
+
+	path = gpk_update_viewer_model_get_path (model, pk_details_get_package_id (item));
+	if (path == NULL) {
+		g_debug ("not found ID for details");
+		return;
+	}
+	gtk_tree_model_get_iter (model, &iter, path);
+	gtk_tree_path_free (path);
+	size = pk_details_get_size (item);
+	gtk_tree_store_set (array_store_updates, &iter,
+			    GPK_UPDATES_COLUMN_DETAILS_OBJ, item,
+			    GPK_UPDATES_COLUMN_SIZE, (gint)size,
+			    GPK_UPDATES_COLUMN_SIZE_DISPLAY, (gint)size,
+			    -1);
+	gpk_update_viewer_selection_sync_row (model, &iter);
+	/* in cache */
+	if (size == 0)
+		gtk_tree_store_set (array_store_updates, &iter,
+				    GPK_UPDATES_COLUMN_STATUS, GPK_INFO_ENUM_DOWNLOADED, -1);
+}
+
+static void
+gpk_update_viewer_apply_update_detail (GtkTreeModel *model, PkUpdateDetail *item)
+{
 	GtkTreeIter iter;
+	GtkTreePath *path;
+	PkRestartEnum restart;
+
+	path = gpk_update_viewer_model_get_path (model, pk_update_detail_get_package_id (item));
+	if (path == NULL) {
+		g_debug ("not found ID for update detail");
+		return;
+	}
+	gtk_tree_model_get_iter (model, &iter, path);
+	gtk_tree_path_free (path);
+	g_object_get (item, "restart", &restart, NULL);
+	gtk_tree_store_set (array_store_updates, &iter,
+			    GPK_UPDATES_COLUMN_UPDATE_DETAIL_OBJ, item,
+			    GPK_UPDATES_COLUMN_RESTART, restart, -1);
+	gpk_update_viewer_selection_sync_row (model, &iter);
+}
+
+/* only the first failed batch gets a dialog, the rest are just logged */
+static gboolean fetch_error_shown = FALSE;
+
+static gboolean
+gpk_update_viewer_fetch_check_results (PkResults *results, const GError *error, const gchar *what)
+{
 	g_autoptr(PkError) error_code = NULL;
-	GtkWindow *window;
 
-	/* get the results */
-	results = pk_client_generic_finish (client, res, &error);
 	if (results == NULL) {
-		/* TRANSLATORS: the PackageKit request did not complete, and it did not send an error */
-		gpk_update_viewer_error_dialog (_("Could not get update details"), NULL, error->message);
-		return;
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return FALSE;
+		g_warning ("failed to get %s: %s", what, error->message);
+		if (!fetch_error_shown) {
+			fetch_error_shown = TRUE;
+			/* TRANSLATORS: the PackageKit request did not complete, and it did not send an error */
+			gpk_update_viewer_error_dialog (_("Could not get update details"), NULL, error->message);
+		}
+		return FALSE;
 	}
 
-	/* check error code */
+	/* the backend refused this batch, skip it and carry on with the rest */
 	error_code = pk_results_get_error_code (results);
 	if (error_code != NULL) {
-		g_warning ("failed to get details: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		g_warning ("failed to get %s: %s, %s", what,
+			   pk_error_enum_to_string (pk_error_get_code (error_code)),
+			   pk_error_get_details (error_code));
+		return FALSE;
+	}
+	return TRUE;
+}
 
-		window = GTK_WINDOW(gtk_builder_get_object (builder, "dialog_updates"));
-		gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-					gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+static void
+gpk_update_viewer_get_details_cb (PkClient *client, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	PkDetails *item;
+	guint i;
+	GtkTreeModel *model;
+
+	/* get the results */
+	fetch_queues[GPK_UPDATE_VIEWER_FETCH_DETAILS].in_flight = FALSE;
+	results = pk_client_generic_finish (client, res, &error);
+	if (!gpk_update_viewer_fetch_check_results (results, error, "details")) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return;
+		gpk_update_viewer_fetch_next (GPK_UPDATE_VIEWER_FETCH_DETAILS);
 		return;
 	}
 
-	/* get data */
+	/* get data, an empty batch is not an error */
 	array = pk_results_get_details_array (results);
-	if (array->len == 0) {
-		/* TRANSLATORS: PackageKit did not send any results for the query... */
-		gpk_update_viewer_error_dialog (_("Could not get package details"), _("No results were returned."), NULL);
-		return;
-	}
+	if (array->len == 0)
+		g_debug ("no details returned for this batch");
 
 	/* set data */
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
+	model = GTK_TREE_MODEL (array_store_updates);
 	for (i = 0; i < array->len; i++) {
-		g_autofree gchar *package_id = NULL;
 		item = g_ptr_array_index (array, i);
-
-		/* get data */
-		g_object_get (item,
-			      "package-id", &package_id,
-			      "size", &size,
-			      NULL);
-
-		path = gpk_update_viewer_model_get_path (model, package_id);
-		if (path == NULL) {
-			g_debug ("not found ID for details");
-		} else {
-			gtk_tree_model_get_iter (model, &iter, path);
-			gtk_tree_path_free (path);
-			gtk_tree_store_set (array_store_updates, &iter,
-					    GPK_UPDATES_COLUMN_DETAILS_OBJ, (gpointer) g_object_ref (item),
-					    GPK_UPDATES_COLUMN_SIZE, (gint)size,
-					    GPK_UPDATES_COLUMN_SIZE_DISPLAY, (gint)size,
-					    -1);
-			/* in cache */
-			if (size == 0)
-				gtk_tree_store_set (array_store_updates, &iter,
-						    GPK_UPDATES_COLUMN_STATUS, GPK_INFO_ENUM_DOWNLOADED, -1);
-		}
+		gpk_update_viewer_apply_details (model, item);
+		gpk_update_cache_add_details (update_cache, item);
 	}
+	gpk_update_viewer_cache_save_queue ();
 
 	/* select the first entry in the updates array now we've got data */
-	widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW(widget));
-	gtk_tree_selection_unselect_all (selection);
-	path = gtk_tree_path_new_first ();
-	gtk_tree_selection_select_path (selection, path);
-	gtk_tree_path_free (path);
+	gpk_update_viewer_select_first ();
 
 	/* set info */
 	gpk_update_viewer_reconsider_info ();
+
+	/* ask for the next batch */
+	gpk_update_viewer_fetch_next (GPK_UPDATE_VIEWER_FETCH_DETAILS);
 }
 
 static void
@@ -1941,71 +2660,42 @@ gpk_update_viewer_get_update_detail_cb (PkClient *client, GAsyncResult *res, gpo
 	g_autoptr(GPtrArray) array = NULL;
 	PkUpdateDetail *item;
 	guint i;
-	GtkTreeView *treeview;
 	GtkTreeModel *model;
-	GtkTreeIter iter;
-	GtkTreePath *path;
-	g_autoptr(PkError) error_code = NULL;
-	GtkWindow *window;
-	PkRestartEnum restart;
 
 	/* get the results */
+	fetch_queues[GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL].in_flight = FALSE;
 	results = pk_client_generic_finish (client, res, &error);
-	if (results == NULL) {
-		/* TRANSLATORS: the PackageKit request did not complete, and it did not send an error */
-		gpk_update_viewer_error_dialog (_("Could not get update details"), NULL, error->message);
-		return;
-	}
-
-	/* check error code */
-	error_code = pk_results_get_error_code (results);
-	if (error_code != NULL) {
-		g_warning ("failed to get update details: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
-
-		window = GTK_WINDOW(gtk_builder_get_object (builder, "dialog_updates"));
-		gpk_error_dialog_modal (window, gpk_error_enum_to_localised_text (pk_error_get_code (error_code)),
-					gpk_error_enum_to_localised_message (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+	if (!gpk_update_viewer_fetch_check_results (results, error, "update details")) {
+		if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			return;
+		gpk_update_viewer_fetch_next (GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL);
 		return;
 	}
 
-	/* get data */
+	/* get data, an empty batch is not an error */
 	array = pk_results_get_update_detail_array (results);
-	if (array->len == 0) {
-		/* TRANSLATORS: PackageKit did not send any results for the query... */
-		gpk_update_viewer_error_dialog (_("Could not get update details"), _("No results were returned."), NULL);
-		return;
-	}
+	if (array->len == 0)
+		g_debug ("no update details returned for this batch");
 
 	/* add data */
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
+	model = GTK_TREE_MODEL (array_store_updates);
 	for (i = 0; i < array->len; i++) {
-		g_autofree gchar *package_id = NULL;
 		item = g_ptr_array_index (array, i);
-
-		/* get data */
-		g_object_get (item,
-			      "package-id", &package_id,
-			      "restart", &restart,
-			      NULL);
-
-		path = gpk_update_viewer_model_get_path (model, package_id);
-		if (path == NULL) {
-			g_warning ("not found ID for update detail");
-		} else {
-			gtk_tree_model_get_iter (model, &iter, path);
-			gtk_tree_path_free (path);
-			gtk_tree_store_set (array_store_updates, &iter,
-					    GPK_UPDATES_COLUMN_UPDATE_DETAIL_OBJ, (gpointer) g_object_ref (item),
-					    GPK_UPDATES_COLUMN_RESTART, restart, -1);
-		}
+		gpk_update_viewer_apply_update_detail (model, item);
+		gpk_update_cache_add_update_detail (update_cache, item);
 	}
+	gpk_update_viewer_cache_save_queue ();
+
+	/* ask for the next batch */
+	gpk_update_viewer_fetch_next (GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL);
 }
 
 static void
 gpk_update_viewer_repo_array_changed_cb (PkClient *client, gpointer user_data)
 {
-	gpk_update_viewer_get_new_update_array ();
+	/* the cached metadata may no longer be true */
+	gpk_update_cache_invalidate (update_cache);
+	gpk_update_viewer_refresh_queue ();
 }
 
 static void
@@ -2025,15 +2715,18 @@ gpk_update_viewer_detail_popup_menu_select_all (GtkWidget *menuitem, gpointer us
 	valid = gtk_tree_model_get_iter_first (model, &iter);
 	while (valid) {
 		gtk_tree_model_get (model, &iter, GPK_UPDATES_COLUMN_INFO, &info, -1);
-		if (info != PK_INFO_ENUM_BLOCKED)
+		if (info != PK_INFO_ENUM_BLOCKED) {
 			gtk_tree_store_set (GTK_TREE_STORE(model), &iter,
 					    GPK_UPDATES_COLUMN_SELECT, TRUE, -1);
+			gpk_update_viewer_selection_sync_row (model, &iter);
+		}
 
 		/* do for children too */
 		child_valid = gtk_tree_model_iter_children (model, &child_iter, &iter);
 		while (child_valid) {
 			gtk_tree_store_set (GTK_TREE_STORE(model), &child_iter,
 					    GPK_UPDATES_COLUMN_SELECT, TRUE, -1);
+			gpk_update_viewer_selection_sync_row (model, &child_iter);
 			child_valid = gtk_tree_model_iter_next (model, &child_iter);
 		}
 
@@ -2065,6 +2758,7 @@ gpk_update_viewer_detail_popup_menu_select_security (GtkWidget *menuitem, gpoint
 		ret = (info == PK_INFO_ENUM_SECURITY);
 		gtk_tree_store_set (GTK_TREE_STORE(model), &iter,
 				    GPK_UPDATES_COLUMN_SELECT, ret, -1);
+		gpk_update_viewer_selection_sync_row (model, &iter);
 
 		/* do for children too */
 		child_valid = gtk_tree_model_iter_children (model, &child_iter, &iter);
@@ -2073,6 +2767,7 @@ gpk_update_viewer_detail_popup_menu_select_security (GtkWidget *menuitem, gpoint
 			ret = (info == PK_INFO_ENUM_SECURITY);
 			gtk_tree_store_set (GTK_TREE_STORE(model), &child_iter,
 					    GPK_UPDATES_COLUMN_SELECT, ret, -1);
+			gpk_update_viewer_selection_sync_row (model, &child_iter);
 			child_valid = gtk_tree_model_iter_next (model, &child_iter);
 		}
 
@@ -2098,7 +2793,6 @@ gpk_update_viewer_detail_popup_menu_select_none (GtkWidget *menuitem, gpointer u
 	model = gtk_tree_view_get_model (treeview);
 	valid = gtk_tree_model_get_iter_first (model, &iter);
 	while (valid) {
-		gtk_tree_model_get (model, &iter, -1);
 		gtk_tree_store_set (GTK_TREE_STORE(model), &iter,
 				    GPK_UPDATES_COLUMN_SELECT, FALSE, -1);
 
@@ -2113,6 +2807,9 @@ gpk_update_viewer_detail_popup_menu_select_none (GtkWidget *menuitem, gpointer u
 		valid = gtk_tree_model_iter_next (model, &iter);
 	}
 
+	/* nothing is selected any more */
+	gpk_update_viewer_selection_clear ();
+
 	/* if there are no entries selected, deselect the button */
 	gpk_update_viewer_reconsider_info ();
 }
@@ -2219,54 +2916,306 @@ gpk_update_viewer_detail_button_pressed (GtkWidget *treeview, GdkEventButton *ev
 	GtkTreeSelection *selection;
 	GtkTreePath *path;
 
-	/* single click with the right mouse button? */
-	if (event->type != GDK_BUTTON_PRESS || event->button != 3) {
-		/* we did not handle this */
-		return FALSE;
-	}
+	/* single click with the right mouse button? */
+	if (event->type != GDK_BUTTON_PRESS || event->button != 3) {
+		/* we did not handle this */
+		return FALSE;
+	}
+
+	g_debug ("Single right click on the tree view");
+
+	/* select the row */
+	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW(treeview));
+	if (gtk_tree_selection_count_selected_rows (selection) <= 1) {
+		/* Get tree path for row that was clicked */
+		if (gtk_tree_view_get_path_at_pos (GTK_TREE_VIEW(treeview),
+						   (gint) event->x, (gint) event->y, &path,
+						   NULL, NULL, NULL)) {
+			gtk_tree_selection_unselect_all (selection);
+			gtk_tree_selection_select_path (selection, path);
+			gtk_tree_path_free (path);
+		}
+	}
+
+	/* create */
+	gpk_update_viewer_detail_popup_menu_create (treeview, event, NULL);
+	return TRUE;
+}
+
+static gboolean
+gpk_update_viewer_detail_popup_menu (GtkWidget *treeview, gpointer user_data)
+{
+	gpk_update_viewer_detail_popup_menu_create (treeview, NULL, NULL);
+	return TRUE;
+}
+
+static gchar **
+gpk_update_viewer_packages_to_ids (GPtrArray *array)
+{
+	guint i;
+	gchar **value;
+	PkPackage *item;
+	const gchar *package_id;
+
+	value = g_new0 (gchar *, array->len + 1);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		package_id = pk_package_get_id (item);
+		value[i] = g_strdup (package_id);
+	}
+	return value;
+}
+
+static void
+gpk_update_viewer_fetch_queue_add (GpkUpdateViewerFetchKind kind, const gchar *package_id)
+{
+	GpkUpdateViewerFetchQueue *queue = &fetch_queues[kind];
+	gchar *tmp;
+
+	if (g_hash_table_contains (queue->pending, package_id))
+		return;
+	tmp = g_strdup (package_id);
+	g_ptr_array_add (queue->order, tmp);
+	g_hash_table_add (queue->pending, tmp);
+}
+
+static void
+gpk_update_viewer_fetch_queue_clear (void)
+{
+	guint i;
+
+	/* any request in flight still chains on to whatever is queued next */
+	for (i = 0; i < GPK_UPDATE_VIEWER_FETCH_LAST; i++) {
+		g_hash_table_remove_all (fetch_queues[i].pending);
+		g_ptr_array_set_size (fetch_queues[i].order, 0);
+		fetch_queues[i].cursor = 0;
+	}
+}
+
+static void
+gpk_update_viewer_fetch_queue_take (GpkUpdateViewerFetchQueue *queue,
+				    GPtrArray *batch,
+				    const gchar *package_id)
+{
+	if (batch->len >= GPK_UPDATE_VIEWER_FETCH_BATCH_SIZE)
+		return;
+	if (package_id == NULL)
+		return;
+	if (!g_hash_table_remove (queue->pending, package_id))
+		return;
+	g_ptr_array_add (batch, g_strdup (package_id));
+}
+
+static gboolean
+gpk_update_viewer_iter_next_displayed (GtkTreeModel *model, GtkTreeIter *iter)
+{
+	GtkTreeIter tmp;
+
+	/* the update list is always fully expanded */
+	if (gtk_tree_model_iter_children (model, &tmp, iter)) {
+		*iter = tmp;
+		return TRUE;
+	}
+	for (;;) {
+		tmp = *iter;
+		if (gtk_tree_model_iter_next (model, &tmp)) {
+			*iter = tmp;
+			return TRUE;
+		}
+		if (!gtk_tree_model_iter_parent (model, &tmp, iter))
+			return FALSE;
+		*iter = tmp;
+	}
+}
+
+static GPtrArray *
+gpk_update_viewer_fetch_queue_next_batch (GpkUpdateViewerFetchQueue *queue)
+{
+	GPtrArray *batch;
+	GtkTreeIter iter;
+	GtkTreeModel *model;
+	GtkTreePath *end = NULL;
+	GtkTreePath *path;
+	GtkTreePath *start = NULL;
+	GtkTreeSelection *selection;
+	GtkTreeView *treeview;
+	gboolean valid;
+
+	batch = g_ptr_array_new_with_free_func (g_free);
+	if (g_hash_table_size (queue->pending) == 0)
+		return batch;
 
-	g_debug ("Single right click on the tree view");
+	/* the selected row is the one the user is looking at */
+	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
+	selection = gtk_tree_view_get_selection (treeview);
+	if (gtk_tree_selection_get_selected (selection, &model, &iter)) {
+		g_autofree gchar *package_id = NULL;
+		gtk_tree_model_get (model, &iter, GPK_UPDATES_COLUMN_ID, &package_id, -1);
+		gpk_update_viewer_fetch_queue_take (queue, batch, package_id);
+	}
 
-	/* select the row */
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW(treeview));
-	if (gtk_tree_selection_count_selected_rows (selection) <= 1) {
-		/* Get tree path for row that was clicked */
-		if (gtk_tree_view_get_path_at_pos (GTK_TREE_VIEW(treeview),
-						   (gint) event->x, (gint) event->y, &path,
-						   NULL, NULL, NULL)) {
-			gtk_tree_selection_unselect_all (selection);
-			gtk_tree_selection_select_path (selection, path);
+	/* then the rows in the viewport, as they are on screen right now */
+	model = gtk_tree_view_get_model (treeview);
+	if (model != NULL &&
+	    gtk_tree_view_get_visible_range (treeview, &start, &end)) {
+		valid = gtk_tree_model_get_iter (model, &iter, start);
+		while (valid && batch->len < GPK_UPDATE_VIEWER_FETCH_BATCH_SIZE) {
+			g_autofree gchar *package_id = NULL;
+			gtk_tree_model_get (model, &iter, GPK_UPDATES_COLUMN_ID, &package_id, -1);
+			gpk_update_viewer_fetch_queue_take (queue, batch, package_id);
+			path = gtk_tree_model_get_path (model, &iter);
+			valid = gtk_tree_path_compare (path, end) < 0;
 			gtk_tree_path_free (path);
+			if (valid)
+				valid = gpk_update_viewer_iter_next_displayed (model, &iter);
 		}
 	}
-
-	/* create */
-	gpk_update_viewer_detail_popup_menu_create (treeview, event, NULL);
-	return TRUE;
+	gtk_tree_path_free (start);
+	gtk_tree_path_free (end);
+
+	/* then everything else in order */
+	while (queue->cursor < queue->order->len &&
+	       batch->len < GPK_UPDATE_VIEWER_FETCH_BATCH_SIZE) {
+		gpk_update_viewer_fetch_queue_take (queue, batch,
+						    g_ptr_array_index (queue->order, queue->cursor));
+		queue->cursor++;
+	}
+	if (queue->cursor == queue->order->len) {
+		g_ptr_array_set_size (queue->order, 0);
+		queue->cursor = 0;
+	}
+	return batch;
 }
 
-static gboolean
-gpk_update_viewer_detail_popup_menu (GtkWidget *treeview, gpointer user_data)
+static void
+gpk_update_viewer_fetch_next (GpkUpdateViewerFetchKind kind)
 {
-	gpk_update_viewer_detail_popup_menu_create (treeview, NULL, NULL);
-	return TRUE;
+	GpkUpdateViewerFetchQueue *queue = &fetch_queues[kind];
+	g_autoptr(GPtrArray) batch = NULL;
+	g_auto(GStrv) package_ids = NULL;
+
+	/* one request of each kind at a time, so batches land in priority order */
+	if (queue->in_flight)
+		return;
+	batch = gpk_update_viewer_fetch_queue_next_batch (queue);
+	if (batch->len == 0)
+		return;
+	g_debug ("fetching %s for %u packages, %u left",
+		 kind == GPK_UPDATE_VIEWER_FETCH_DETAILS ? "details" : "update details",
+		 batch->len, g_hash_table_size (queue->pending));
+
+	package_ids = pk_ptr_array_to_strv (batch);
+	queue->in_flight = TRUE;
+	switch (kind) {
+	case GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL:
+		pk_client_get_update_detail_async (PK_CLIENT(task), package_ids, cancellable,
+						   (PkProgressCallback) gpk_update_viewer_progress_cb, NULL,
+						   (GAsyncReadyCallback) gpk_update_viewer_get_update_detail_cb, NULL);
+		break;
+	case GPK_UPDATE_VIEWER_FETCH_DETAILS:
+		pk_client_get_details_async (PK_CLIENT(task), package_ids, cancellable,
+					     (PkProgressCallback) gpk_update_viewer_progress_cb, NULL,
+					     (GAsyncReadyCallback) gpk_update_viewer_get_details_cb, NULL);
+		break;
+	default:
+		g_assert_not_reached ();
+	}
 }
 
-static gchar **
-gpk_update_viewer_packages_to_ids (GPtrArray *array)
+static void
+gpk_update_viewer_fetch_metadata (gchar **package_ids)
 {
+	GtkTreeModel *model = GTK_TREE_MODEL (array_store_updates);
+	PkDetails *details;
+	PkUpdateDetail *update_detail;
 	guint i;
-	gchar **value;
-	PkPackage *item;
-	const gchar *package_id;
 
-	value = g_new0 (gchar *, array->len + 1);
-	for (i = 0; i < array->len; i++) {
-		item = g_ptr_array_index (array, i);
-		package_id = pk_package_get_id (item);
-		value[i] = g_strdup (package_id);
+	/* show what we already know straight away */
+	for (i = 0; package_ids[i] != NULL; i++) {
+		update_detail = gpk_update_cache_get_update_detail (update_cache, package_ids[i]);
+		if (update_detail != NULL)
+			gpk_update_viewer_apply_update_detail (model, update_detail);
+		else
+			gpk_update_viewer_fetch_queue_add (GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL, package_ids[i]);
+
+		/* a cached size of zero only says it was downloaded back then,
+		 * and the download may have been cleaned up since */
+		details = gpk_update_cache_get_details (update_cache, package_ids[i]);
+		if (details != NULL && pk_details_get_size (details) > 0)
+			gpk_update_viewer_apply_details (model, details);
+		else
+			gpk_update_viewer_fetch_queue_add (GPK_UPDATE_VIEWER_FETCH_DETAILS, package_ids[i]);
 	}
-	return value;
+	g_debug ("%u update details and %u details not cached (of %u)",
+		 g_hash_table_size (fetch_queues[GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL].pending),
+		 g_hash_table_size (fetch_queues[GPK_UPDATE_VIEWER_FETCH_DETAILS].pending),
+		 i);
+
+	/* get the rest in batches, visible rows first */
+	gpk_update_viewer_fetch_next (GPK_UPDATE_VIEWER_FETCH_UPDATE_DETAIL);
+	gpk_update_viewer_fetch_next (GPK_UPDATE_VIEWER_FETCH_DETAILS);
+	if (g_hash_table_size (fetch_queues[GPK_UPDATE_VIEWER_FETCH_DETAILS].pending) == 0 &&
+	    !fetch_queues[GPK_UPDATE_VIEWER_FETCH_DETAILS].in_flight)
+		gpk_update_viewer_select_first ();
+}
+
+static void
+gpk_update_viewer_add_package (GtkWidget *widget, PkPackage *item, GtkTreeIter *iter)
+{
+	gboolean selected;
+	gboolean sensitive;
+	g_autofree gchar *text = NULL;
+	g_autofree gchar *package_id = NULL;
+	g_autofree gchar *summary = NULL;
+	GtkTreeIter parent;
+	PkInfoEnum info;
+
+	/* get data */
+	g_object_get (item,
+		      "info", &info,
+		      "package-id", &package_id,
+		      "summary", &summary,
+		      NULL);
+
+	/* find our parent */
+	gpk_update_viewer_get_parent_for_info (info, &parent);
+
+	/* add to array store */
+	text = gpk_package_id_format_twoline (gtk_widget_get_style_context (widget),
+					      package_id,
+					      summary);
+	g_debug ("adding: id=%s, text=%s", package_id, text);
+	selected = (info != PK_INFO_ENUM_BLOCKED);
+
+	/* only make the checkbox selectable if:
+	 *  - we can do UpdatePackages rather than just UpdateSystem
+	 *  - the update is not blocked
+	 */
+	sensitive = selected;
+	if (!pk_bitfield_contain (roles, PK_ROLE_ENUM_UPDATE_PACKAGES))
+		sensitive = FALSE;
+
+	/* add to model */
+	gtk_tree_store_append (array_store_updates, iter, &parent);
+	gtk_tree_store_set (array_store_updates, iter,
+			    GPK_UPDATES_COLUMN_TEXT, text,
+			    GPK_UPDATES_COLUMN_ID, package_id,
+			    GPK_UPDATES_COLUMN_INFO, info,
+			    GPK_UPDATES_COLUMN_SELECT, selected,
+			    GPK_UPDATES_COLUMN_SENSITIVE, sensitive,
+			    GPK_UPDATES_COLUMN_VISIBLE, TRUE,
+			    GPK_UPDATES_COLUMN_CLICKABLE, selected,
+			    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
+			    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
+			    GPK_UPDATES_COLUMN_SIZE, 0,
+			    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
+			    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
+			    GPK_UPDATES_COLUMN_PULSE, -1,
+			    -1);
+	gpk_update_viewer_index_add (GTK_TREE_MODEL (array_store_updates), iter, package_id);
+	gpk_update_viewer_selection_sync_row (GTK_TREE_MODEL (array_store_updates), iter);
+	if (gpk_update_viewer_row_is_selectable (GTK_TREE_MODEL (array_store_updates), iter, info))
+		number_updates++;
 }
 
 static void
@@ -2278,17 +3227,13 @@ gpk_update_viewer_get_updates_cb (PkClient *client, GAsyncResult *res, gpointer
 	g_autoptr(GPtrArray) array = NULL;
 	g_autoptr(GPtrArray) array_messages = NULL;
 	PkPackage *item;
-	gboolean selected;
-	gboolean sensitive;
 	GtkTreeIter iter;
-	GtkTreeIter parent;
 	guint i;
 	GtkTreeView *treeview;
 	GtkTreeModel *model;
 	GtkWidget *widget;
 	g_autoptr(PkError) error_code = NULL;
 	GtkWindow *window;
-	PkInfoEnum info;
 
 	/* get the results */
 	results = pk_client_generic_finish (client, res, &error);
@@ -2314,54 +3259,18 @@ gpk_update_viewer_get_updates_cb (PkClient *client, GAsyncResult *res, gpointer
 	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_NAME);
 	array = pk_package_sack_get_array (sack);
 	widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
+
+	/* build the store detached from the view and unsorted, so each
+	 * append doesn't trigger a re-sort and a redraw of the treeview */
+	treeview = GTK_TREE_VIEW (widget);
+	model = GTK_TREE_MODEL (array_store_updates);
+	gtk_tree_view_set_model (treeview, NULL);
+	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
+					      GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID,
+					      GTK_SORT_DESCENDING);
 	for (i = 0; i < array->len; i++) {
-		g_autofree gchar *text = NULL;
-		g_autofree gchar *package_id = NULL;
-		g_autofree gchar *summary = NULL;
 		item = g_ptr_array_index (array, i);
-
-		/* get data */
-		g_object_get (item,
-			      "info", &info,
-			      "package-id", &package_id,
-			      "summary", &summary,
-			      NULL);
-
-		/* find our parent */
-		gpk_update_viewer_get_parent_for_info (info, &parent);
-
-		/* add to array store */
-		text = gpk_package_id_format_twoline (gtk_widget_get_style_context (widget),
-						      package_id,
-						      summary);
-		g_debug ("adding: id=%s, text=%s", package_id, text);
-		selected = (info != PK_INFO_ENUM_BLOCKED);
-
-		/* only make the checkbox selectable if:
-		 *  - we can do UpdatePackages rather than just UpdateSystem
-		 *  - the update is not blocked
-		 */
-		sensitive = selected;
-		if (!pk_bitfield_contain (roles, PK_ROLE_ENUM_UPDATE_PACKAGES))
-			sensitive = FALSE;
-
-		/* add to model */
-		gtk_tree_store_append (array_store_updates, &iter, &parent);
-		gtk_tree_store_set (array_store_updates, &iter,
-				    GPK_UPDATES_COLUMN_TEXT, text,
-				    GPK_UPDATES_COLUMN_ID, package_id,
-				    GPK_UPDATES_COLUMN_INFO, info,
-				    GPK_UPDATES_COLUMN_SELECT, selected,
-				    GPK_UPDATES_COLUMN_SENSITIVE, sensitive,
-				    GPK_UPDATES_COLUMN_VISIBLE, TRUE,
-				    GPK_UPDATES_COLUMN_CLICKABLE, selected,
-				    GPK_UPDATES_COLUMN_RESTART, PK_RESTART_ENUM_NONE,
-				    GPK_UPDATES_COLUMN_STATUS, PK_INFO_ENUM_UNKNOWN,
-				    GPK_UPDATES_COLUMN_SIZE, 0,
-				    GPK_UPDATES_COLUMN_SIZE_DISPLAY, 0,
-				    GPK_UPDATES_COLUMN_PERCENTAGE, 0,
-				    GPK_UPDATES_COLUMN_PULSE, -1,
-				    -1);
+		gpk_update_viewer_add_package (widget, item, &iter);
 	}
 
 	/* get the download sizes */
@@ -2369,28 +3278,18 @@ gpk_update_viewer_get_updates_cb (PkClient *client, GAsyncResult *res, gpointer
 		g_ptr_array_unref (update_array);
 	update_array = pk_results_get_package_array (results);
 
-	/* sort by name */
-	treeview = GTK_TREE_VIEW(gtk_builder_get_object (builder, "treeview_updates"));
-	model = gtk_tree_view_get_model (treeview);
+	/* sort once, then give the model back to the view */
 	gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (model),
 					      GPK_UPDATES_COLUMN_INFO,
 					      GTK_SORT_DESCENDING);
+	gtk_tree_view_set_model (treeview, model);
 	gtk_tree_view_expand_all (treeview);
 
 	/* get the download sizes */
 	if (update_array->len > 0) {
 		g_auto(GStrv) package_ids = NULL;
 		package_ids = gpk_update_viewer_packages_to_ids (array);
-
-		/* get the details of all the packages */
-		pk_client_get_update_detail_async (PK_CLIENT(task), package_ids, cancellable,
-						   (PkProgressCallback) gpk_update_viewer_progress_cb, NULL,
-						   (GAsyncReadyCallback) gpk_update_viewer_get_update_detail_cb, NULL);
-
-		/* get the details of all the packages */
-		pk_client_get_details_async (PK_CLIENT(task), package_ids, cancellable,
-					     (PkProgressCallback) gpk_update_viewer_progress_cb, NULL,
-					     (GAsyncReadyCallback) gpk_update_viewer_get_details_cb, NULL);
+		gpk_update_viewer_fetch_metadata (package_ids);
 	}
 
 	/* are now able to do action */
@@ -2399,6 +3298,206 @@ gpk_update_viewer_get_updates_cb (PkClient *client, GAsyncResult *res, gpointer
 
 	/* set info */
 	gpk_update_viewer_reconsider_info ();
+
+	/* make a start on the downloads while the user reviews the list */
+	gpk_update_viewer_download_start ();
+}
+
+static void
+gpk_update_viewer_remove_package (GtkTreeModel *model, const gchar *package_id)
+{
+	gboolean has_parent;
+	GtkTreeIter iter;
+	GtkTreeIter parent;
+	GtkTreePath *path;
+	PkInfoEnum info;
+
+	path = gpk_update_viewer_model_get_path (model, package_id);
+	if (path == NULL)
+		return;
+	if (!gtk_tree_model_get_iter (model, &iter, path)) {
+		gtk_tree_path_free (path);
+		return;
+	}
+	gtk_tree_path_free (path);
+
+	gtk_tree_model_get (model, &iter,
+			    GPK_UPDATES_COLUMN_INFO, &info,
+			    -1);
+	if (gpk_update_viewer_row_is_selectable (model, &iter, info))
+		number_updates--;
+
+	g_debug ("removing: id=%s", package_id);
+	gpk_update_viewer_selection_set (package_id, FALSE, PK_INFO_ENUM_UNKNOWN,
+					 0, PK_RESTART_ENUM_NONE, FALSE);
+	g_hash_table_remove (package_id_index, package_id);
+	has_parent = gtk_tree_model_iter_parent (model, &parent, &iter);
+	gtk_tree_store_remove (array_store_updates, &iter);
+
+	/* drop the section header once it is empty */
+	if (has_parent && !gtk_tree_model_iter_has_child (model, &parent))
+		gtk_tree_store_remove (array_store_updates, &parent);
+}
+
+static void
+gpk_update_viewer_refresh_updates_cb (PkClient *client, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(PkResults) results = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) added = NULL;
+	g_autoptr(GPtrArray) removed = NULL;
+	g_autoptr(GHashTable) new_ids = NULL;
+	g_autoptr(PkError) error_code = NULL;
+	GHashTableIter hash_iter;
+	GtkTreeIter iter;
+	GtkTreeModel *model;
+	GtkTreePath *path;
+	GtkWidget *widget;
+	PkPackage *item;
+	PkInfoEnum info;
+	gboolean selected;
+	const gchar *package_id;
+	gpointer key;
+	guint i;
+
+	/* get the results */
+	results = pk_client_generic_finish (client, res, &error);
+	if (results == NULL) {
+		g_warning ("failed to refresh updates: %s", error->message);
+		return;
+	}
+
+	/* the list was rebuilt from scratch while we were waiting */
+	if (GPOINTER_TO_UINT (user_data) != refresh_generation) {
+		g_debug ("ignoring stale refresh");
+		return;
+	}
+
+	/* check error code */
+	error_code = pk_results_get_error_code (results);
+	if (error_code != NULL) {
+		g_warning ("failed to refresh updates: %s, %s", pk_error_enum_to_string (pk_error_get_code (error_code)), pk_error_get_details (error_code));
+		return;
+	}
+
+	/* get data */
+	sack = pk_results_get_package_sack (results);
+	pk_package_sack_sort (sack, PK_PACKAGE_SACK_SORT_TYPE_NAME);
+	array = pk_package_sack_get_array (sack);
+	new_ids = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		g_hash_table_insert (new_ids, (gpointer) pk_package_get_id (item), item);
+	}
+
+	/* remove the rows that are no longer updates */
+	widget = GTK_WIDGET(gtk_builder_get_object (builder, "treeview_updates"));
+	model = GTK_TREE_MODEL (array_store_updates);
+	removed = g_ptr_array_new_with_free_func (g_free);
+	g_hash_table_iter_init (&hash_iter, package_id_index);
+	while (g_hash_table_iter_next (&hash_iter, &key, NULL)) {
+		if (!g_hash_table_contains (new_ids, key))
+			g_ptr_array_add (removed, g_strdup (key));
+	}
+	for (i = 0; i < removed->len; i++)
+		gpk_update_viewer_remove_package (model, g_ptr_array_index (removed, i));
+
+	/* add the new updates, keeping existing rows as they are unless
+	 * the update type changed and they need to move section */
+	added = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < array->len; i++) {
+		item = g_ptr_array_index (array, i);
+		package_id = pk_package_get_id (item);
+		selected = TRUE;
+		path = gpk_update_viewer_model_get_path (model, package_id);
+		if (path != NULL) {
+			gtk_tree_model_get_iter (model, &iter, path);
+			gtk_tree_path_free (path);
+			gtk_tree_model_get (model, &iter,
+					    GPK_UPDATES_COLUMN_INFO, &info,
+					    GPK_UPDATES_COLUMN_SELECT, &selected,
+					    -1);
+			if (info == pk_package_get_info (item))
+				continue;
+			gpk_update_viewer_remove_package (model, package_id);
+		}
+		gpk_update_viewer_add_package (widget, item, &iter);
+
+		/* preserve what the user unticked */
+		if (!selected) {
+			gtk_tree_store_set (array_store_updates, &iter,
+					    GPK_UPDATES_COLUMN_SELECT, FALSE, -1);
+			gpk_update_viewer_selection_sync_row (model, &iter);
+		}
+		g_ptr_array_add (added, g_strdup (package_id));
+	}
+	g_debug ("refreshed updates: %u added, %u removed", added->len, removed->len);
+
+	/* get the download sizes */
+	if (update_array != NULL)
+		g_ptr_array_unref (update_array);
+	update_array = pk_results_get_package_array (results);
+
+	/* only ask about the packages we've not seen before */
+	if (added->len > 0) {
+		g_auto(GStrv) package_ids = NULL;
+		package_ids = pk_ptr_array_to_strv (added);
+		gtk_tree_view_expand_all (GTK_TREE_VIEW (widget));
+		gpk_update_viewer_fetch_metadata (package_ids);
+	}
+
+	/* pick up the new updates in the background download */
+	if (added->len > 0 || removed->len > 0)
+		gpk_update_viewer_download_start ();
+
+	/* set info */
+	gpk_update_viewer_reconsider_info ();
+}
+
+static gboolean
+gpk_update_viewer_refresh_timeout_cb (gpointer user_data)
+{
+	refresh_id = 0;
+
+	/* the list is re-fetched once the update has finished */
+	if (ignore_updates_changed) {
+		g_debug ("not refreshing while updating");
+		return G_SOURCE_REMOVE;
+	}
+
+	/* nothing to diff against */
+	if (g_hash_table_size (package_id_index) == 0) {
+		gpk_update_viewer_get_new_update_array ();
+		return G_SOURCE_REMOVE;
+	}
+
+	g_debug ("refreshing update list");
+	pk_client_get_updates_async (PK_CLIENT(task), PK_FILTER_ENUM_NONE, cancellable,
+				     (PkProgressCallback) gpk_update_viewer_progress_cb, NULL,
+				     (GAsyncReadyCallback) gpk_update_viewer_refresh_updates_cb,
+				     GUINT_TO_POINTER (refresh_generation));
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gpk_update_viewer_refresh_cancel (void)
+{
+	if (refresh_id != 0) {
+		g_source_remove (refresh_id);
+		refresh_id = 0;
+	}
+}
+
+static void
+gpk_update_viewer_refresh_queue (void)
+{
+	/* these signals arrive in bursts, so only act on the last one */
+	gpk_update_viewer_refresh_cancel ();
+	refresh_id = g_timeout_add (GPK_UPDATE_VIEWER_REFRESH_DELAY,
+				    gpk_update_viewer_refresh_timeout_cb, NULL);
+	g_source_set_name_by_id (refresh_id, "[GpkUpdateViewer] refresh");
 }
 
 static void
@@ -2409,7 +3508,17 @@ gpk_update_viewer_get_new_update_array (void)
 	PkBitfield filter = PK_FILTER_ENUM_NONE;
 
 	/* clear all widgets */
+	gpk_update_viewer_refresh_cancel ();
+	gpk_update_viewer_download_cancel ();
+	refresh_generation++;
+	gpk_update_viewer_fetch_queue_clear ();
+	gpk_update_viewer_progress_discard ();
+	g_hash_table_remove_all (active_rows);
+	gpk_update_viewer_active_rows_stop ();
 	gtk_tree_store_clear (array_store_updates);
+	gpk_update_viewer_headers_clear ();
+	gpk_update_viewer_index_clear ();
+	gpk_update_viewer_selection_clear ();
 	gtk_text_buffer_set_text (text_buffer, "", -1);
 
 	widget = GTK_WIDGET(gtk_builder_get_object (builder, "label_header_title"));
@@ -2626,7 +3735,7 @@ gpk_update_viewer_updates_changed_cb (PkControl *_control, gpointer user_data)
 		g_debug ("ignoring");
 		return;
 	}
-	gpk_update_viewer_get_new_update_array ();
+	gpk_update_viewer_refresh_queue ();
 }
 
 static gboolean
@@ -2763,8 +3872,25 @@ gpk_update_viewer_get_properties_cb (PkControl *_control, GAsyncResult *res, gpo
 static void
 gpk_update_viewer_notify_network_state_cb (PkControl *_control, GParamSpec *pspec, gpointer user_data)
 {
+	PkNetworkEnum state;
+
+	/* stop downloading if we've moved to an expensive connection */
+	g_object_get (control,
+		      "network-state", &state,
+		      NULL);
+	if (state == PK_NETWORK_ENUM_OFFLINE ||
+	    state == PK_NETWORK_ENUM_MOBILE)
+		gpk_update_viewer_download_cancel ();
+
 	gpk_update_viewer_check_mobile_broadband ();
-	gpk_update_viewer_get_new_update_array ();
+
+	/* this is how the first load starts, so do not make it wait */
+	if (g_hash_table_size (package_id_index) == 0 && !ignore_updates_changed) {
+		gpk_update_viewer_refresh_cancel ();
+		gpk_update_viewer_get_new_update_array ();
+		return;
+	}
+	gpk_update_viewer_refresh_queue ();
 }
 
 static void
@@ -2783,6 +3909,7 @@ gpk_update_viewer_application_startup_cb (GtkApplication *_application, gpointer
 	GtkWidget *label;
 	GtkTreeSelection *selection;
 	gboolean ret;
+	guint i;
 	guint retval;
 	g_autoptr(GError) error = NULL;
 
@@ -2796,6 +3923,25 @@ gpk_update_viewer_application_startup_cb (GtkApplication *_application, gpointer
 	proxy = systemd_proxy_new ();
 #endif
 	cancellable = g_cancellable_new ();
+	package_id_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						  (GDestroyNotify) gtk_tree_row_reference_free);
+	selection_index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	progress_pending = g_hash_table_new (g_str_hash, g_str_equal);
+	active_rows = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					     (GDestroyNotify) gtk_tree_row_reference_free);
+	progress_pending_order = g_ptr_array_new_with_free_func ((GDestroyNotify) gpk_update_viewer_progress_item_free);
+	for (i = 0; i < GPK_UPDATE_VIEWER_FETCH_LAST; i++) {
+		fetch_queues[i].order = g_ptr_array_new_with_free_func (g_free);
+		fetch_queues[i].pending = g_hash_table_new (g_str_hash, g_str_equal);
+	}
+
+	/* load metadata from the last run */
+	update_cache = gpk_update_cache_new (NULL);
+	if (!gpk_update_cache_load (update_cache, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_warning ("failed to load update cache: %s", error->message);
+		g_clear_error (&error);
+	}
 
 	control = pk_control_new ();
 	g_signal_connect (control, "repo-list-changed",
@@ -2813,6 +3959,13 @@ gpk_update_viewer_application_startup_cb (GtkApplication *_application, gpointer
 		      "background", FALSE,
 		      NULL);
 
+	/* pre-downloads run at a lower priority and never ask questions */
+	download_client = pk_client_new ();
+	g_object_set (download_client,
+		      "background", TRUE,
+		      "interactive", FALSE,
+		      NULL);
+
 	/* get properties */
 	pk_control_get_properties_async (control, NULL, (GAsyncReadyCallback) gpk_update_viewer_get_properties_cb, NULL);
 
@@ -2834,7 +3987,7 @@ gpk_update_viewer_application_startup_cb (GtkApplication *_application, gpointer
 	array_store_updates = gtk_tree_store_new (GPK_UPDATES_COLUMN_LAST, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_INT,
 						 G_TYPE_BOOLEAN, G_TYPE_BOOLEAN, G_TYPE_BOOLEAN,
 						 G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT, G_TYPE_UINT,
-						 G_TYPE_UINT, G_TYPE_POINTER, G_TYPE_POINTER, G_TYPE_INT, G_TYPE_BOOLEAN);
+						 G_TYPE_UINT, G_TYPE_OBJECT, G_TYPE_OBJECT, G_TYPE_INT, G_TYPE_BOOLEAN);
 	text_buffer = gtk_text_buffer_new (NULL);
 	gtk_text_buffer_create_tag (text_buffer, "para",
 				    "pixels_above_lines", 5,
@@ -2953,6 +4106,7 @@ main (int argc, char *argv[])
 	GOptionContext *context;
 	gboolean ret;
 	gint status = 0;
+	guint i;
 
 	const GOptionEntry options[] = {
 		{ "version", '\0', 0, G_OPTION_ARG_NONE, &program_version,
@@ -3009,10 +4163,38 @@ main (int argc, char *argv[])
 	/* remove auto-shutdown */
 	if (auto_shutdown_id != 0)
 		g_source_remove (auto_shutdown_id);
+	if (progress_timeout_id != 0)
+		g_source_remove (progress_timeout_id);
+	if (cache_save_id != 0)
+		g_source_remove (cache_save_id);
 
 	if (update_array != NULL)
 		g_ptr_array_unref (update_array);
 	g_free (package_id_last);
+	gpk_update_viewer_headers_clear ();
+	for (i = 0; i < GPK_UPDATE_VIEWER_FETCH_LAST; i++) {
+		if (fetch_queues[i].order != NULL)
+			g_ptr_array_unref (fetch_queues[i].order);
+		if (fetch_queues[i].pending != NULL)
+			g_hash_table_unref (fetch_queues[i].pending);
+	}
+	if (update_cache != NULL) {
+		g_autoptr(GError) error = NULL;
+		if (gpk_update_cache_is_dirty (update_cache) &&
+		    !gpk_update_cache_save (update_cache, package_id_index, &error))
+			g_warning ("failed to save update cache: %s", error->message);
+		g_object_unref (update_cache);
+	}
+	if (package_id_index != NULL)
+		g_hash_table_unref (package_id_index);
+	if (selection_index != NULL)
+		g_hash_table_unref (selection_index);
+	if (active_rows != NULL)
+		g_hash_table_unref (active_rows);
+	if (progress_pending != NULL)
+		g_hash_table_unref (progress_pending);
+	if (progress_pending_order != NULL)
+		g_ptr_array_unref (progress_pending_order);
 	if (array_store_updates != NULL)
 		g_object_unref (array_store_updates);
 	if (builder != NULL)
@@ -3029,6 +4211,12 @@ main (int argc, char *argv[])
 		g_object_unref (settings);
 	if (task != NULL)
 		g_object_unref (task);
+	if (download_client != NULL)
+		g_object_unref (download_client);
+	if (download_cancellable != NULL)
+		g_object_unref (download_cancellable);
+	if (stage_prefetch_cancellable != NULL)
+		g_object_unref (stage_prefetch_cancellable);
 	if (text_buffer != NULL)
 		g_object_unref (text_buffer);
 